@@ -0,0 +1,975 @@
+#include "glfw-utils.hpp"
+#include "filesystem-utils.hpp"
+#include "renderer.hpp"
+#include "shader-program.hpp"
+#include "shader-preprocessor.hpp"
+#include "framebuffer.hpp"
+#include "profiler.hpp"
+#include "gl-state-cache.hpp"
+#include "render-queue.hpp"
+#include "uniform-buffer.hpp"
+#include "mesh-streams.hpp"
+#include "mesh-simplifier.hpp"
+#include "geometry-pool.hpp"
+#include "multi-draw.hpp"
+#include "culling.hpp"
+#include "texture-manager.hpp"
+#include "ktx2-file.hpp"
+#include "texture-array.hpp"
+#include "job-system.hpp"
+#include "geometry/vertex-packing.hpp"
+#include <nlohmann-json/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+
+/* Frame-time benchmark. Renders a fixed number of frames of one scene (offscreen by default) and reports
+CPU submission time and GPU execution time percentiles, so regressions in draw() or getVertexArrayData() show up as numbers.
+Usage: ENginger_bench [--scene quad|quad-grid|upload|mesh|packed-mesh|multi-stream-mesh|position-only-mesh|lod|stream|instanced|queue|pooled-queue|draw-data|multi-draw|culling|cpu-culling|textures|compressed-textures|texture-units|texture-array] [--frames N] [--warmup N] [--objects N]
+                      [--width W] [--height H] [--visible] [--output result.json] [--trace trace.json] */
+
+struct BenchOptions
+{
+    std::string scene = "quad";
+    int frameCount = 1000;
+    int warmupFrameCount = 60;
+    int objectCount = 256;
+    int width = 1280;
+    int height = 720;
+    bool isVisible = false;
+    std::string outputPath;
+    std::string tracePath;
+};
+
+struct BenchScene
+{
+    std::function<void()> render;
+    std::function<void()> clean;
+};
+
+struct FrameTimeStats
+{
+    double p50;
+    double p95;
+    double p99;
+    double mean;
+};
+
+const int gpuQueryRingSize = 4;                                                                                          // Results are read back gpuQueryRingSize - 1 frames late, so reading them never stalls the pipeline.
+
+class GpuFrameTimer                                                                                                      // Measures GPU time of each frame with GL_TIME_ELAPSED queries.
+{
+private:
+    GLuint queries[gpuQueryRingSize];
+    bool isPending[gpuQueryRingSize] = {};
+    bool isMeasured[gpuQueryRingSize] = {};
+    int frameIndex = 0;
+
+    void collect(int slot)
+    {
+        if (!isPending[slot])
+            return;
+        GLuint64 elapsedNanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsedNanoseconds);
+        if (isMeasured[slot])
+            frameTimes.push_back(elapsedNanoseconds / 1.0e6);
+        isPending[slot] = false;
+    }
+public:
+    std::vector<double> frameTimes;
+
+    GpuFrameTimer() { glGenQueries(gpuQueryRingSize, queries); }
+
+    void begin(bool isMeasuredFrame)
+    {
+        int slot = frameIndex % gpuQueryRingSize;
+        collect(slot);
+        isMeasured[slot] = isMeasuredFrame;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+    }
+
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        isPending[frameIndex % gpuQueryRingSize] = true;
+        frameIndex++;
+    }
+
+    void collectAll()
+    {
+        for (int i = 0; i < gpuQueryRingSize; i++)
+            collect((frameIndex + i) % gpuQueryRingSize);
+    }
+
+    void deleteQueries() { glDeleteQueries(gpuQueryRingSize, queries); }
+};
+
+std::vector<Vertex> getQuadVertices(GLfloat left, GLfloat bottom, GLfloat right, GLfloat top)
+{
+    return std::vector<Vertex> {
+        Vertex(Position(left, bottom), Color::magenta(), UV(0.0f, 0.0f), Position()),
+        Vertex(Position(right, bottom), Color::cyan(), UV(1.0f, 0.0f), Position()),
+        Vertex(Position(left, top), Color::yellow(), UV(0.0f, 1.0f), Position()),
+        Vertex(Position(right, top), Color::white(), UV(1.0f, 1.0f), Position())
+    };
+}
+
+std::vector<GLuint> getQuadIndices(GLuint firstVertex = 0)
+{
+    return std::vector<GLuint> {
+        firstVertex + 0, firstVertex + 1, firstVertex + 2,
+        firstVertex + 1, firstVertex + 2, firstVertex + 3
+    };
+}
+
+BenchScene createQuadScene(GLuint shaderProgram, int drawCount)                                                          // The quad from main(), drawn drawCount times per frame with one draw() each.
+{
+    std::vector<GLuint> indices = getQuadIndices();
+    VertexArrayData vertexArrayData = getVertexArrayData(getQuadVertices(-0.8f, -0.8f, 0.8f, 0.8f), indices);
+    int elementsCount = indices.size();
+
+    BenchScene scene;
+    scene.render = [=]() {
+        for (int i = 0; i < drawCount; i++)
+            draw(shaderProgram, *vertexArrayData.boundVAO, elementsCount, vertexArrayData.indexType);
+    };
+    scene.clean = [=]() { cleanVertexArrayData(vertexArrayData); };
+    return scene;
+}
+
+void getQuadGridMesh(int quadCount, std::vector<Vertex>& vertices, std::vector<GLuint>& indices)                        // quadCount quads covering the viewport, in one mesh.
+{
+    int gridSize = (int)std::ceil(std::sqrt((double)quadCount));
+    GLfloat cellSize = 2.0f / gridSize;
+    for (int i = 0; i < quadCount; i++) {
+        GLfloat left = -1.0f + (i % gridSize) * cellSize;
+        GLfloat bottom = -1.0f + (i / gridSize) * cellSize;
+        std::vector<Vertex> quadVertices = getQuadVertices(left, bottom, left + cellSize * 0.9f, bottom + cellSize * 0.9f);
+        std::vector<GLuint> quadIndices = getQuadIndices(vertices.size());
+        vertices.insert(vertices.end(), quadVertices.begin(), quadVertices.end());
+        indices.insert(indices.end(), quadIndices.begin(), quadIndices.end());
+    }
+}
+
+BenchScene createUploadScene(GLuint shaderProgram, int quadCount)                                                        // Rebuilds a mesh of quadCount quads with getVertexArrayData() every frame.
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    getQuadGridMesh(quadCount, vertices, indices);
+
+    BenchScene scene;
+    scene.render = [=]() {
+        VertexArrayData vertexArrayData = getVertexArrayData(vertices, indices);
+        draw(shaderProgram, *vertexArrayData.boundVAO, indices.size(), vertexArrayData.indexType);
+        cleanVertexArrayData(vertexArrayData);
+    };
+    scene.clean = []() {};
+    return scene;
+}
+
+BenchScene createMeshScene(GLuint shaderProgram, int quadCount)                                                          // quadCount quads in one static mesh of 48-byte Vertex, drawn with one draw().
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    getQuadGridMesh(quadCount, vertices, indices);
+    VertexArrayData vertexArrayData = getVertexArrayData(vertices, indices);
+    int elementsCount = indices.size();
+
+    BenchScene scene;
+    scene.render = [=]() { draw(shaderProgram, *vertexArrayData.boundVAO, elementsCount, vertexArrayData.indexType); };
+    scene.clean = [=]() { cleanVertexArrayData(vertexArrayData); };
+    return scene;
+}
+
+BenchScene createPackedMeshScene(int quadCount)                                                                          // The mesh scene with 20-byte PackedVertex, decoded by the QUANTIZED_POSITION shader variant.
+{
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader),
+                                                              { { "QUANTIZED_POSITION", "" } });
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create quantized shader program.");
+
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    getQuadGridMesh(quadCount, vertices, indices);
+    MeshBounds bounds = getMeshBounds(vertices);
+    VertexArrayData vertexArrayData = getVertexArrayData(packVertices(vertices, bounds), indices);
+    int elementsCount = indices.size();
+    shaderProgram->setVec3("positionScale", bounds.getExtent());
+    shaderProgram->setVec3("positionOffset", bounds.min);
+
+    BenchScene scene;
+    scene.render = [=]() { draw(shaderProgram->ID, *vertexArrayData.boundVAO, elementsCount, vertexArrayData.indexType); };
+    scene.clean = [=]() {
+        cleanVertexArrayData(vertexArrayData);
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+    };
+    return scene;
+}
+
+BenchScene createMultiStreamMeshScene(GLuint shaderProgram, int quadCount, bool isPositionOnly)                           // The mesh scene with one VBO per attribute, optionally drawn through the position-only VAO like a depth pass.
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    getQuadGridMesh(quadCount, vertices, indices);
+    MultiStreamMesh multiStreamMesh = getMultiStreamMesh(MeshStreams::fromVertices(vertices, indices));
+    GLuint VAO = isPositionOnly ? multiStreamMesh.positionOnlyVAO : multiStreamMesh.VAO;
+
+    BenchScene scene;
+    scene.render = [=]() { draw(shaderProgram, VAO, multiStreamMesh.elementsCount, multiStreamMesh.indexType); };
+    scene.clean = [=]() { cleanMultiStreamMesh(multiStreamMesh); };
+    return scene;
+}
+
+BenchScene createStreamScene(GLuint shaderProgram, int quadCount)                                                        // Writes quadCount moving quads into stream buffers every frame.
+{
+    const int verticesPerQuad = 4, indicesPerQuad = 6;
+    StreamBuffer* vertexBuffer = new StreamBuffer(GL_ARRAY_BUFFER, quadCount * verticesPerQuad * sizeof(Vertex) + sizeof(Vertex));
+    StreamBuffer* indexBuffer = new StreamBuffer(GL_ELEMENT_ARRAY_BUFFER, quadCount * indicesPerQuad * sizeof(GLuint));
+    GLuint VAO = createStreamVertexArray(*vertexBuffer, *indexBuffer);
+    int gridSize = (int)std::ceil(std::sqrt((double)quadCount));
+    GLfloat cellSize = 2.0f / gridSize;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        StreamAllocation vertices = vertexBuffer->allocate(quadCount * verticesPerQuad * sizeof(Vertex), sizeof(Vertex));
+        StreamAllocation indices = indexBuffer->allocate(quadCount * indicesPerQuad * sizeof(GLuint));
+        GLfloat offset = cellSize * 0.1f * std::sin((GLfloat)glfwGetTime());
+        for (int i = 0; i < quadCount; i++) {
+            GLfloat left = -1.0f + (i % gridSize) * cellSize + offset;
+            GLfloat bottom = -1.0f + (i / gridSize) * cellSize;
+            std::vector<Vertex> quadVertices = getQuadVertices(left, bottom, left + cellSize * 0.8f, bottom + cellSize * 0.8f);
+            std::vector<GLuint> quadIndices = getQuadIndices(i * verticesPerQuad);
+            memcpy((Vertex*)vertices.data + i * verticesPerQuad, quadVertices.data(), verticesPerQuad * sizeof(Vertex));
+            memcpy((GLuint*)indices.data + i * indicesPerQuad, quadIndices.data(), indicesPerQuad * sizeof(GLuint));
+        }
+        vertexBuffer->flush();
+        indexBuffer->flush();
+        drawStream(shaderProgram, VAO, vertices, indices, quadCount * indicesPerQuad);
+        vertexBuffer->endFrame();
+        indexBuffer->endFrame();
+    };
+    scene.clean = [=]() {
+        getGlStateCache().onVertexArrayDeleted(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        vertexBuffer->deleteStreamBuffer();
+        indexBuffer->deleteStreamBuffer();
+        delete vertexBuffer;
+        delete indexBuffer;
+    };
+    return scene;
+}
+
+void getHeightfieldMesh(int gridSize, std::vector<Vertex>& vertices, std::vector<GLuint>& indices)                         // gridSize x gridSize cells of rolling terrain filling the viewport.
+{
+    for (int y = 0; y <= gridSize; y++) {
+        for (int x = 0; x <= gridSize; x++) {
+            GLfloat height = 0.1f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+            vertices.push_back(Vertex(Position(-1.0f + 2.0f * x / gridSize, -1.0f + 2.0f * y / gridSize, height),
+                                      Color(0.5f + height * 4.0f, 0.6f, 0.4f), UV((GLfloat)x / gridSize, (GLfloat)y / gridSize), Position()));
+        }
+    }
+    for (int y = 0; y < gridSize; y++) {
+        for (int x = 0; x < gridSize; x++) {
+            GLuint corner = y * (gridSize + 1) + x;
+            indices.insert(indices.end(), { corner, corner + 1, corner + gridSize + 1, corner + 1, corner + gridSize + 2, corner + gridSize + 1 });
+        }
+    }
+}
+
+BenchScene createLodScene(GLuint shaderProgram, int objectCount, int viewportHeight)                                     // objectCount terrains at increasing distances, each drawn with the LOD selectLod() picks for its distance.
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    getHeightfieldMesh(128, vertices, indices);
+    LodMesh lodMesh = getLodMesh(vertices, indices);
+    std::vector<int> lods(objectCount);
+    for (int i = 0; i < objectCount; i++)
+        lods[i] = selectLod(lodMesh, 1.0f + i * 0.5f, 1.0f, viewportHeight);
+
+    BenchScene scene;
+    scene.render = [=]() {
+        for (int lod : lods)
+            drawLod(shaderProgram, lodMesh, lod);
+    };
+    scene.clean = [=]() { cleanLodMesh(lodMesh); };
+    return scene;
+}
+
+BenchScene createInstancedScene(int instanceCount)                                                                       // instanceCount spinning quads submitted with one drawInstanced() call.
+{
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader),
+                                                              { { "INSTANCED", "" } });
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create instanced shader program.");
+
+    std::vector<GLuint> indices = getQuadIndices();
+    VertexArrayData vertexArrayData = getVertexArrayData(getQuadVertices(-0.5f, -0.5f, 0.5f, 0.5f), indices);
+    InstanceBuffer instanceBuffer = getInstanceBuffer(vertexArrayData, instanceCount);
+    int elementsCount = indices.size();
+    int gridSize = (int)std::ceil(std::sqrt((double)instanceCount));
+    GLfloat cellSize = 2.0f / gridSize;
+    GLuint programID = shaderProgram->ID;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        std::vector<InstanceData> instances(instanceCount);
+        Matrix4 rotation = Matrix4::rotation((GLfloat)glfwGetTime(), Position(0.0f, 0.0f, 1.0f));
+        Matrix4 scale = Matrix4::scale(Position(cellSize * 0.8f, cellSize * 0.8f, 1.0f));
+        for (int i = 0; i < instanceCount; i++) {
+            Position center(-1.0f + (i % gridSize + 0.5f) * cellSize, -1.0f + (i / gridSize + 0.5f) * cellSize);
+            instances[i].model = Matrix4::translation(center) * rotation * scale;
+            instances[i].color = (i % 2) ? Color::white() : Color::cyan();
+        }
+        drawInstanced(programID, *vertexArrayData.boundVAO, elementsCount, vertexArrayData.indexType, instanceBuffer, instances);
+    };
+    scene.clean = [=]() {
+        cleanInstanceBuffer(instanceBuffer);
+        cleanVertexArrayData(vertexArrayData);
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+    };
+    return scene;
+}
+
+BenchScene createQueueScene(ShaderProgram& shaderProgram, int drawCount, bool isPooled)                                         // drawCount draws over two programs, four meshes and eight materials, submitted in the worst order and sorted by RenderQueue.
+{
+    const int meshCount = 4, materialCount = 8;
+    std::string yellowShaderPath = getShaderFileAbsolutePath("fragmentShaderYellow.glsl");
+    ShaderProgram* yellowProgram = new ShaderProgram(getAbsolutePath(PathNodeType::vertexShader), yellowShaderPath);
+    ShaderProgram* programs[] = { &shaderProgram, yellowProgram };
+    std::vector<VertexArrayData> meshes;
+    GeometryPool* geometryPool = isPooled ? new GeometryPool(createGeometryPool<Vertex>(1, 1)) : nullptr;               // Starts too small on purpose, so the scene also covers growing the pool.
+    std::vector<MeshAllocation> allocations;
+    std::vector<GLuint> indices = getQuadIndices();
+    for (int i = 0; i < meshCount; i++) {
+        GLfloat left = -1.0f + i * 0.5f;
+        if (isPooled)
+            allocations.push_back(geometryPool->allocate(getQuadVertices(left, -0.5f, left + 0.4f, 0.5f), indices));      // Every mesh shares the pool's VAO, the queue never switches VAOs.
+        else
+            meshes.push_back(getVertexArrayData(getQuadVertices(left, -0.5f, left + 0.4f, 0.5f), indices));
+    }
+    int elementsCount = indices.size();
+
+    UniformBlockArena* materialArena = new UniformBlockArena(sizeof(MaterialUniforms), materialCount);
+    for (int i = 0; i < materialCount; i++) {
+        GLfloat shade = (GLfloat)(i + 1) / materialCount;
+        MaterialUniforms material = { Color(shade, shade, shade, 1.0f), {} };
+        materialArena->allocate(&material);                                                                             // Handles are handed out in order, material id i + 1 is handle i.
+    }
+
+    RenderQueue* renderQueue = new RenderQueue();
+    renderQueue->setMaterialBinder([=](GLuint, uint16_t material) {
+        materialArena->bind(material - 1, materialUniformBinding);                                                      // One range bind per material change instead of a glUniform call per parameter.
+    });
+
+    BenchScene scene;
+    scene.render = [=]() {
+        for (int i = 0; i < drawCount; i++) {
+            RenderCommand command = {};
+            command.shaderProgram = programs[i % 2]->ID;
+            command.material = 1 + i % materialCount;
+            command.depth = (GLfloat)(drawCount - i) / drawCount;
+            command.elementsCount = elementsCount;
+            if (isPooled) {
+                const MeshAllocation& allocation = allocations[i % meshCount];
+                command.VAO = geometryPool->VAO;
+                command.indexType = geometryPool->indexType;
+                command.indexOffset = geometryPool->getIndexOffset(allocation);
+                command.baseVertex = allocation.baseVertex;
+            }
+            else {
+                command.VAO = *meshes[i % meshCount].boundVAO;
+                command.indexType = meshes[i % meshCount].indexType;
+            }
+            renderQueue->submit(command);
+        }
+        renderQueue->execute();
+    };
+    scene.clean = [=]() {
+        for (const VertexArrayData& mesh : meshes)
+            cleanVertexArrayData(mesh);
+        if (geometryPool)
+            geometryPool->deleteGeometryPool();
+        delete geometryPool;
+        getGlStateCache().onProgramDeleted(programs[1]->ID);
+        glDeleteProgram(programs[1]->ID);
+        delete programs[1];
+        renderQueue->deleteRenderQueue();
+        delete renderQueue;
+        materialArena->deleteUniformBlockArena();
+        delete materialArena;
+    };
+    return scene;
+}
+
+BenchScene createMultiDrawScene(int drawCount, bool isMultiDraw)                                                         // drawCount spinning quads of four pooled meshes with per-draw data, merged into one call per run when isMultiDraw.
+{
+    const int meshCount = 4;
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader),
+                                                              { { "DRAW_DATA", "" } });
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create draw data shader program.");
+    shaderProgram->setInt("drawData", drawDataTextureUnit);
+
+    GeometryPool* geometryPool = new GeometryPool(createGeometryPool<Vertex>(meshCount * 4, meshCount * 6));
+    std::vector<MeshAllocation> allocations;
+    for (int i = 0; i < meshCount; i++) {
+        GLfloat halfWidth = 0.2f + 0.1f * i;
+        allocations.push_back(geometryPool->allocate(getQuadVertices(-halfWidth, -0.5f, halfWidth, 0.5f), getQuadIndices()));
+    }
+    DrawDataBuffer* drawDataBuffer = new DrawDataBuffer(drawCount);
+    drawDataBuffer->attach(geometryPool->VAO);
+
+    UniformBlockArena* materialArena = new UniformBlockArena(sizeof(MaterialUniforms), 1);
+    MaterialUniforms material = { Color::white(), {} };
+    materialArena->allocate(&material);
+    RenderQueue* renderQueue = new RenderQueue();
+    renderQueue->setMaterialBinder([=](GLuint, uint16_t) { materialArena->bind(0, materialUniformBinding); });
+    renderQueue->setMultiDrawEnabled(isMultiDraw);
+    int gridSize = (int)std::ceil(std::sqrt((double)drawCount));
+    GLfloat cellSize = 2.0f / gridSize;
+    GLuint programID = shaderProgram->ID;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        std::vector<InstanceData> drawData(drawCount);
+        Matrix4 rotation = Matrix4::rotation((GLfloat)glfwGetTime(), Position(0.0f, 0.0f, 1.0f));
+        Matrix4 scale = Matrix4::scale(Position(cellSize * 0.8f, cellSize * 0.8f, 1.0f));
+        for (int i = 0; i < drawCount; i++) {
+            Position center(-1.0f + (i % gridSize + 0.5f) * cellSize, -1.0f + (i / gridSize + 0.5f) * cellSize);
+            drawData[i].model = Matrix4::translation(center) * rotation * scale;
+            drawData[i].color = (i % 2) ? Color::white() : Color::cyan();
+        }
+        drawDataBuffer->update(drawData);
+        drawDataBuffer->bind();
+
+        for (int i = 0; i < drawCount; i++) {
+            const MeshAllocation& allocation = allocations[i % meshCount];
+            RenderCommand command = {};
+            command.shaderProgram = programID;
+            command.VAO = geometryPool->VAO;
+            command.material = 1;
+            command.depth = 0.5f;
+            command.elementsCount = allocation.elementsCount;
+            command.indexType = geometryPool->indexType;
+            command.indexOffset = geometryPool->getIndexOffset(allocation);
+            command.baseVertex = allocation.baseVertex;
+            command.drawId = i;
+            renderQueue->submit(command);
+        }
+        renderQueue->execute();
+    };
+    scene.clean = [=]() {
+        renderQueue->deleteRenderQueue();
+        delete renderQueue;
+        materialArena->deleteUniformBlockArena();
+        delete materialArena;
+        drawDataBuffer->deleteDrawDataBuffer();
+        delete drawDataBuffer;
+        geometryPool->deleteGeometryPool();
+        delete geometryPool;
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+    };
+    return scene;
+}
+
+BenchScene createCullingScene(int instanceCount, int width, int height, bool isGpuPreferred)                                // instanceCount quads around a turning camera, a few of them walls close to it, culled before drawing.
+{
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader),
+                                                              { { "DRAW_DATA", "" } });
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create draw data shader program.");
+    shaderProgram->setInt("drawData", drawDataTextureUnit);
+
+    std::vector<std::vector<Vertex>> meshVertices = { getQuadVertices(-1.0f, -1.0f, 1.0f, 1.0f), getQuadVertices(-0.5f, -0.5f, 0.5f, 0.5f) };
+    GeometryPool* geometryPool = new GeometryPool(createGeometryPool<Vertex>(8, 12));
+    std::vector<MeshAllocation> meshes;
+    for (const std::vector<Vertex>& vertices : meshVertices)
+        meshes.push_back(geometryPool->allocate(vertices, getQuadIndices()));
+
+    std::vector<InstanceData> instances(instanceCount);
+    std::vector<BoundingSphere> boundingSpheres(instanceCount);
+    std::vector<GLuint> meshIndices(instanceCount);
+    const int wallCount = 8;
+    for (int i = 0; i < instanceCount; i++) {
+        GLfloat angle = i * 2.39996f;                                                                                    // Golden angle, spreads the quads evenly around the camera.
+        GLfloat distance = i < wallCount ? 4.0f : 6.0f + 44.0f * (GLfloat)i / instanceCount;
+        Position center(distance * std::sin(angle), std::sin(i * 0.7f) * 3.0f, -distance * std::cos(angle));
+        Matrix4 scale = i < wallCount ? Matrix4::scale(Position(2.0f, 3.0f, 1.0f)) : Matrix4::identity();
+        instances[i].model = Matrix4::translation(center) * Matrix4::rotation(-angle, Position(0.0f, 1.0f, 0.0f)) * scale;   // Facing the camera.
+        instances[i].color = i < wallCount ? Color::grey() : ((i % 2) ? Color::white() : Color::cyan());
+        meshIndices[i] = i < wallCount ? 0 : i % 2;
+        boundingSpheres[i] = transformBoundingSphere(getBoundingSphere(meshVertices[meshIndices[i]]), instances[i].model);
+    }
+    CullingPass* cullingPass = new CullingPass(geometryPool, meshes, instanceCount, isGpuPreferred);
+    cullingPass->setInstances(instances, boundingSpheres, meshIndices);
+
+    GLint targetFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+    Framebuffer* sceneFramebuffer = new Framebuffer(width, height);                                                     // Its depth texture feeds the depth pyramid, the color is copied to the bench's target.
+    getGlStateCache().bindFramebuffer(targetFramebuffer);
+    DepthPyramid* depthPyramid = cullingPass->isGpuCulling() ? new DepthPyramid(width, height) : nullptr;
+    FrameUniformBuffer* frameUniformBuffer = new FrameUniformBuffer();
+    Matrix4 projection = Matrix4::perspective(1.0f, (GLfloat)width / height, 0.1f, 100.0f);
+    Matrix4* pyramidViewProjection = new Matrix4(Matrix4::identity());
+    bool* hasDepthPyramid = new bool(false);
+    GLuint programID = shaderProgram->ID;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        GLfloat yaw = (GLfloat)glfwGetTime() * 0.5f;
+        Matrix4 view = Matrix4::lookAt(Position(0.0f, 0.0f, 0.0f), Position(std::sin(yaw), 0.0f, -std::cos(yaw)), Position(0.0f, 1.0f, 0.0f));
+        sceneFramebuffer->bind();
+        glEnable(GL_DEPTH_TEST);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        frameUniformBuffer->update(getFrameUniforms(view, projection, width, height, glfwGetTime(), 0.0f));
+
+        cullingPass->cull(projection * view, *hasDepthPyramid ? depthPyramid : nullptr, *pyramidViewProjection);
+        cullingPass->draw(programID);
+        if (depthPyramid != nullptr) {
+            depthPyramid->build(sceneFramebuffer->depthTexture);
+            *pyramidViewProjection = projection * view;
+            *hasDepthPyramid = true;
+        }
+
+        glDisable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        getGlStateCache().bindFramebuffer(targetFramebuffer);                                                           // Rebinds both targets and brings the cache back in line.
+        frameUniformBuffer->endFrame();
+    };
+    scene.clean = [=]() {
+        frameUniformBuffer->deleteFrameUniformBuffer();
+        delete frameUniformBuffer;
+        if (depthPyramid != nullptr)
+            depthPyramid->deleteDepthPyramid();
+        delete depthPyramid;
+        sceneFramebuffer->deleteFramebuffer();
+        delete sceneFramebuffer;
+        cullingPass->deleteCullingPass();
+        delete cullingPass;
+        geometryPool->deleteGeometryPool();
+        delete geometryPool;
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+        delete pyramidViewProjection;
+        delete hasDepthPyramid;
+    };
+    return scene;
+}
+
+BenchScene createTextureScene(int textureCount, GLsizeiptr memoryBudget, const std::string& texturePath)                // A grid of textured quads, one more texture loaded every textureLoadInterval frames while they are drawn.
+{
+    const int textureLoadInterval = 4;
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader),
+                                                              { { "TEXTURED", "" } });
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create textured shader program.");
+    shaderProgram->setInt("albedo", 0);
+
+    int gridSize = (int)std::ceil(std::sqrt((double)textureCount));
+    GLfloat cellSize = 2.0f / gridSize;
+    GeometryPool* geometryPool = new GeometryPool(createGeometryPool<Vertex>(textureCount * 4, textureCount * 6));
+    std::vector<MeshAllocation> allocations;
+    for (int i = 0; i < textureCount; i++) {
+        GLfloat left = -1.0f + (i % gridSize) * cellSize, bottom = -1.0f + (i / gridSize) * cellSize;
+        allocations.push_back(geometryPool->allocate(getQuadVertices(left, bottom, left + cellSize * 0.9f, bottom + cellSize * 0.9f), getQuadIndices()));
+    }
+    TextureManager* textureManager = new TextureManager(2, memoryBudget);
+    std::vector<TextureHandle>* textures = new std::vector<TextureHandle>();
+    int* frame = new int(0);
+    GLuint programID = shaderProgram->ID;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        if (*frame % textureLoadInterval == 0 && (int)textures->size() < textureCount)
+            textures->push_back(textureManager->load(texturePath));                                                      // Same file, but every load is decoded and streamed on its own.
+        (*frame)++;
+        textureManager->update();
+        for (int i = 0; i < (int)textures->size(); i++) {
+            textureManager->bind((*textures)[i], 0);
+            geometryPool->draw(programID, allocations[i]);
+        }
+    };
+    scene.clean = [=]() {
+        TextureManagerStats stats = textureManager->getStats();
+        std::cout << stats.decodedCount << " textures decoded, " << stats.uploadedLevelCount << " levels uploaded, " << stats.evictedLevelCount
+                  << " evicted, " << (textureManager->getResidentBytes() >> 20) << " MB resident" << std::endl;
+        textureManager->deleteTextureManager();
+        delete textureManager;
+        geometryPool->deleteGeometryPool();
+        delete geometryPool;
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+        delete textures;
+        delete frame;
+    };
+    return scene;
+}
+
+std::vector<ImageLevel> getTintedLevels(const std::vector<ImageLevel>& levels, Color tint)                                // Every texel multiplied by tint, so the textures of a scene differ.
+{
+    std::vector<ImageLevel> tintedLevels = levels;
+    for (ImageLevel& level : tintedLevels)
+        for (size_t i = 0; i < level.pixels.size(); i += 4) {
+            level.pixels[i] = (unsigned char)(level.pixels[i] * tint.r);
+            level.pixels[i + 1] = (unsigned char)(level.pixels[i + 1] * tint.g);
+            level.pixels[i + 2] = (unsigned char)(level.pixels[i + 2] * tint.b);
+        }
+    return tintedLevels;
+}
+
+BenchScene createMaterialTextureScene(int drawCount, bool isTextureArray)                                               // drawCount quads over materialTextureCount textures through the render queue: one material per 2D texture, or one material and a texture array layer per draw.
+{
+    const int materialTextureCount = 8;
+    const Color tints[materialTextureCount] = { Color::white(), Color::red(), Color::green(), Color::blue(), Color::yellow(), Color::magenta(),
+                                                Color::cyan(), Color::grey() };
+    ShaderDefines defines = { { "DRAW_DATA", "" }, { isTextureArray ? "TEXTURE_ARRAY" : "TEXTURED", "" } };
+    if (isTextureArray && isBindlessTextureSupported())
+        defines.push_back({ "BINDLESS_TEXTURE", "" });
+    ShaderVariantCache* shaderVariants = new ShaderVariantCache();
+    ShaderProgram* shaderProgram = shaderVariants->getVariant(getAbsolutePath(PathNodeType::vertexShader), getAbsolutePath(PathNodeType::fragmentShader), defines);
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram != nullptr, errorHandler, "Failed to create material texture shader program.");
+    shaderProgram->setInt("drawData", drawDataTextureUnit);
+    if (isTextureArray)
+        shaderProgram->setInt("drawTextureReferences", drawTextureReferencesTextureUnit);
+    shaderProgram->setInt(isTextureArray ? "albedoArray" : "albedo", 0);
+
+    ImageLevel image;
+    checkCondition(decodeImageFile(getTextureAbsolutePath("seamless.jpg"), image), errorHandler, "Failed to decode seamless.jpg.");
+    std::vector<ImageLevel> levels = generateMipChain(std::move(image));
+    TextureArray* textureArray = isTextureArray ? new TextureArray(levels[0].width, levels[0].height, blockFormatRGBA8, materialTextureCount) : nullptr;
+    std::vector<GLuint>* textures = new std::vector<GLuint>();
+    for (const Color& tint : tints) {
+        std::vector<ImageLevel> tintedLevels = getTintedLevels(levels, tint);
+        if (isTextureArray) {
+            textureArray->addLayer(tintedLevels);
+            continue;
+        }
+        GLuint texture;
+        glGenTextures(1, &texture);
+        getGlStateCache().selectTexture(0, GL_TEXTURE_2D, texture);
+        for (int level = 0; level < (int)tintedLevels.size(); level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, tintedLevels[level].width, tintedLevels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         tintedLevels[level].pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        textures->push_back(texture);
+    }
+
+    GeometryPool* geometryPool = new GeometryPool(createGeometryPool<Vertex>(4, 6));
+    MeshAllocation allocation = geometryPool->allocate(getQuadVertices(-0.5f, -0.5f, 0.5f, 0.5f), getQuadIndices());
+    DrawDataBuffer* drawDataBuffer = new DrawDataBuffer(drawCount, isTextureArray);
+    drawDataBuffer->attach(geometryPool->VAO);
+    UniformBlockArena* materialArena = new UniformBlockArena(sizeof(MaterialUniforms), 1);
+    MaterialUniforms material = { Color::white(), {} };
+    materialArena->allocate(&material);
+    RenderQueue* renderQueue = new RenderQueue();
+    renderQueue->setMaterialBinder([=](GLuint, uint16_t materialId) {                                                  // Materials 1.. differ only in their texture.
+        materialArena->bind(0, materialUniformBinding);
+        if (isTextureArray)
+            textureArray->bind(0);
+        else
+            getGlStateCache().bindTexture(0, GL_TEXTURE_2D, (*textures)[materialId - 1]);
+    });
+    renderQueue->setMultiDrawEnabled(true);
+    RenderQueueStats* stats = new RenderQueueStats();
+    int gridSize = (int)std::ceil(std::sqrt((double)drawCount));
+    GLfloat cellSize = 2.0f / gridSize;
+    GLuint programID = shaderProgram->ID;
+
+    BenchScene scene;
+    scene.render = [=]() {
+        std::vector<InstanceData> drawData(drawCount);
+        std::vector<TextureReference> textureReferences(isTextureArray ? drawCount : 0);
+        Matrix4 scale = Matrix4::scale(Position(cellSize * 0.9f, cellSize * 0.9f, 1.0f));
+        for (int i = 0; i < drawCount; i++) {
+            Position center(-1.0f + (i % gridSize + 0.5f) * cellSize, -1.0f + (i / gridSize + 0.5f) * cellSize);
+            drawData[i].model = Matrix4::translation(center) * scale;
+            drawData[i].color = Color::white();
+            if (isTextureArray)
+                textureReferences[i] = textureArray->getReference(i % materialTextureCount);
+        }
+        drawDataBuffer->update(drawData);
+        if (isTextureArray)
+            drawDataBuffer->updateTextureReferences(textureReferences);
+        drawDataBuffer->bind();
+
+        for (int i = 0; i < drawCount; i++) {
+            RenderCommand command = {};
+            command.shaderProgram = programID;
+            command.VAO = geometryPool->VAO;
+            command.material = isTextureArray ? 1 : 1 + i % materialTextureCount;
+            command.depth = 0.5f;
+            command.elementsCount = allocation.elementsCount;
+            command.indexType = geometryPool->indexType;
+            command.indexOffset = geometryPool->getIndexOffset(allocation);
+            command.baseVertex = allocation.baseVertex;
+            command.drawId = i;
+            renderQueue->submit(command);
+        }
+        renderQueue->execute();
+        *stats = renderQueue->getStats();
+    };
+    scene.clean = [=]() {
+        std::cout << stats->drawCount << " draws in " << stats->drawCallCount << " calls, " << stats->materialBindCount << " material binds" << std::endl;
+        renderQueue->deleteRenderQueue();
+        delete renderQueue;
+        delete stats;
+        materialArena->deleteUniformBlockArena();
+        delete materialArena;
+        drawDataBuffer->deleteDrawDataBuffer();
+        delete drawDataBuffer;
+        geometryPool->deleteGeometryPool();
+        delete geometryPool;
+        if (textureArray != nullptr) {
+            textureArray->deleteTextureArray();
+            delete textureArray;
+        }
+        for (GLuint texture : *textures) {
+            getGlStateCache().onTextureDeleted(texture);
+            glDeleteTextures(1, &texture);
+        }
+        delete textures;
+        shaderVariants->deleteShaderVariants();
+        delete shaderVariants;
+    };
+    return scene;
+}
+
+std::string getCompressedTexturePath(BlockFormat format)                                                                 // seamless.jpg converted as ENginger_texconv would, into the temporary directory.
+{
+    std::string path = (std::filesystem::temp_directory_path() / (std::string("enginger-bench-seamless-") + getBlockFormatInfo(format).name + ".ktx2")).string();
+    auto errorHandler = []() { glfwTerminate(); };
+    ImageLevel image;
+    checkCondition(decodeImageFile(getTextureAbsolutePath("seamless.jpg"), image), errorHandler, "Failed to decode seamless.jpg.");
+    std::vector<ImageLevel> levels = generateMipChain(std::move(image));
+    for (ImageLevel& level : levels)
+        level.pixels = compressImage(level, format);
+    checkCondition(writeKtx2File(path, format, levels), errorHandler, "Failed to write the compressed texture.");
+    return path;
+}
+
+std::map<std::string, std::function<BenchScene(ShaderProgram&, const BenchOptions&)>> benchScenes
+{
+    { "quad", [](ShaderProgram& shaderProgram, const BenchOptions&) { return createQuadScene(shaderProgram.ID, 1); } },
+    { "quad-grid", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createQuadScene(shaderProgram.ID, options.objectCount); } },
+    { "upload", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createUploadScene(shaderProgram.ID, options.objectCount); } },
+    { "mesh", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createMeshScene(shaderProgram.ID, options.objectCount); } },
+    { "packed-mesh", [](ShaderProgram&, const BenchOptions& options) { return createPackedMeshScene(options.objectCount); } },
+    { "multi-stream-mesh", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createMultiStreamMeshScene(shaderProgram.ID, options.objectCount, false); } },
+    { "position-only-mesh", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createMultiStreamMeshScene(shaderProgram.ID, options.objectCount, true); } },
+    { "lod", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createLodScene(shaderProgram.ID, options.objectCount, options.height); } },
+    { "stream", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createStreamScene(shaderProgram.ID, options.objectCount); } },
+    { "instanced", [](ShaderProgram&, const BenchOptions& options) { return createInstancedScene(options.objectCount); } },
+    { "queue", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createQueueScene(shaderProgram, options.objectCount, false); } },
+    { "pooled-queue", [](ShaderProgram& shaderProgram, const BenchOptions& options) { return createQueueScene(shaderProgram, options.objectCount, true); } },
+    { "draw-data", [](ShaderProgram&, const BenchOptions& options) { return createMultiDrawScene(options.objectCount, false); } },
+    { "multi-draw", [](ShaderProgram&, const BenchOptions& options) { return createMultiDrawScene(options.objectCount, true); } },
+    { "culling", [](ShaderProgram&, const BenchOptions& options) { return createCullingScene(options.objectCount, options.width, options.height, true); } },
+    { "cpu-culling", [](ShaderProgram&, const BenchOptions& options) { return createCullingScene(options.objectCount, options.width, options.height, false); } },
+    { "textures", [](ShaderProgram&, const BenchOptions& options) {
+        return createTextureScene(options.objectCount, (GLsizeiptr)getConfig().textureMemoryBudgetMB << 20, getTextureAbsolutePath("seamless.jpg"));
+    } },
+    { "compressed-textures", [](ShaderProgram&, const BenchOptions& options) {
+        return createTextureScene(options.objectCount, (GLsizeiptr)getConfig().textureMemoryBudgetMB << 20, getCompressedTexturePath(blockFormatBC1));
+    } },
+    { "texture-units", [](ShaderProgram&, const BenchOptions& options) { return createMaterialTextureScene(options.objectCount, false); } },
+    { "texture-array", [](ShaderProgram&, const BenchOptions& options) { return createMaterialTextureScene(options.objectCount, true); } }
+};
+
+BenchOptions parseOptions(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--visible")
+            options.isVisible = true;
+        else if (argument == "--scene" && hasValue)
+            options.scene = argv[++i];
+        else if (argument == "--frames" && hasValue)
+            options.frameCount = std::max(1, atoi(argv[++i]));
+        else if (argument == "--warmup" && hasValue)
+            options.warmupFrameCount = std::max(0, atoi(argv[++i]));
+        else if (argument == "--objects" && hasValue)
+            options.objectCount = std::max(1, atoi(argv[++i]));
+        else if (argument == "--width" && hasValue)
+            options.width = std::max(1, atoi(argv[++i]));
+        else if (argument == "--height" && hasValue)
+            options.height = std::max(1, atoi(argv[++i]));
+        else if (argument == "--output" && hasValue)
+            options.outputPath = argv[++i];
+        else if (argument == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else {
+            std::cout << "::Error: unknown or incomplete argument " << argument << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (benchScenes.find(options.scene) == benchScenes.end()) {
+        std::cout << "::Error: unknown scene " << options.scene << ". Available scenes:";
+        for (const auto& scene : benchScenes)
+            std::cout << " " << scene.first;
+        std::cout << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return options;
+}
+
+FrameTimeStats getFrameTimeStats(std::vector<double> frameTimes)
+{
+    FrameTimeStats stats = {};
+    if (frameTimes.empty())
+        return stats;
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    auto percentile = [&frameTimes](double p) {                                                                          // Nearest-rank percentile.
+        size_t rank = (size_t)std::ceil(p / 100.0 * frameTimes.size());
+        return frameTimes[std::min(std::max<size_t>(rank, 1), frameTimes.size()) - 1];
+    };
+    stats.p50 = percentile(50.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+    for (double frameTime : frameTimes)
+        stats.mean += frameTime;
+    stats.mean /= frameTimes.size();
+    return stats;
+}
+
+void printFrameTimeStats(const char* name, const FrameTimeStats& stats)
+{
+    printf("%-6s %10.4f %10.4f %10.4f %10.4f\n", name, stats.p50, stats.p95, stats.p99, stats.mean);
+}
+
+nlohmann::json toJson(const FrameTimeStats& stats)
+{
+    return { { "p50", stats.p50 }, { "p95", stats.p95 }, { "p99", stats.p99 }, { "mean", stats.mean } };
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = parseOptions(argc, argv);
+
+    initGLFW(!options.isVisible);
+    ConfigData configData = getConfig();
+    initJobSystem(configData.workerThreadCount);
+    GLFWwindow* window = options.isVisible
+            ? createWindow("enGinger bench", false, false, options.width, options.height)
+            : createHeadlessWindow("enGinger bench", options.width, options.height);
+    glfwSwapInterval(0);                                                                                                 // Vsync would clamp every frame time to the refresh interval.
+
+    Framebuffer* framebuffer = nullptr;
+    if (!options.isVisible) {
+        framebuffer = new Framebuffer(options.width, options.height);
+        framebuffer->bind();
+    }
+
+    std::string vertexShaderPath = getShaderAbsolutePath(GL_VERTEX_SHADER, configData.vertexShader);
+    std::string fragmentShaderPath = getShaderAbsolutePath(GL_FRAGMENT_SHADER, configData.fragmentShader);
+    ShaderProgram shaderProgram = ShaderProgram(vertexShaderPath, fragmentShaderPath);
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(shaderProgram.ID != 0, errorHandler, "Failed to create shader program.");
+
+    FrameUniformBuffer frameUniformBuffer;
+    UniformBlockArena defaultMaterialArena(sizeof(MaterialUniforms), 1);
+    MaterialUniforms defaultMaterial = { Color::white(), {} };
+    defaultMaterialArena.bind(defaultMaterialArena.allocate(&defaultMaterial), materialUniformBinding);
+
+    BenchScene scene = benchScenes[options.scene](shaderProgram, options);
+    if (!options.tracePath.empty())
+        initProfiler();
+    GpuFrameTimer gpuFrameTimer;
+    std::vector<double> cpuFrameTimes;
+    int totalFrameCount = options.warmupFrameCount + options.frameCount;
+    for (int frame = 0; frame < totalFrameCount && !glfwWindowShouldClose(window); frame++) {
+        bool isMeasuredFrame = frame >= options.warmupFrameCount;
+        auto frameStart = std::chrono::steady_clock::now();
+
+        beginProfilerFrame();
+        gpuFrameTimer.begin(isMeasuredFrame);
+        {
+            PROFILE_ZONE("clearAllBuffers");
+            clearAllBuffers();
+        }
+        {
+            PROFILE_ZONE("scene");
+            frameUniformBuffer.update(getFrameUniforms(Matrix4::identity(), Matrix4::identity(), options.width, options.height, glfwGetTime(), 0.0f));
+            scene.render();
+        }
+        frameUniformBuffer.endFrame();
+        gpuFrameTimer.end();
+        endProfilerFrame();
+        if (isProfilerEnabled()) {
+            getGlStateCache().reportStats();
+            getGlStateCache().resetStats();
+        }
+        if (options.isVisible) {
+            glfwPollEvents();
+            glfwSwapBuffers(window);
+        }
+        else
+            glFlush();                                                                                                   // Offscreen frames are never presented, flushing keeps the submission cost comparable to a swap.
+
+        std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+        if (isMeasuredFrame)
+            cpuFrameTimes.push_back(frameTime.count());
+    }
+    gpuFrameTimer.collectAll();
+
+    FrameTimeStats cpuStats = getFrameTimeStats(cpuFrameTimes);
+    FrameTimeStats gpuStats = getFrameTimeStats(gpuFrameTimer.frameTimes);
+    std::cout << "scene " << options.scene << ", " << cpuFrameTimes.size() << " frames (" << options.warmupFrameCount
+              << " warm-up), " << options.width << "x" << options.height << (options.isVisible ? ", window" : ", offscreen")
+              << ", " << glGetString(GL_RENDERER) << std::endl;
+    printf("%-6s %10s %10s %10s %10s\n", "ms", "p50", "p95", "p99", "mean");
+    printFrameTimeStats("cpu", cpuStats);
+    printFrameTimeStats("gpu", gpuStats);
+
+    if (!options.outputPath.empty()) {
+        nlohmann::json result = {
+            { "scene", options.scene },
+            { "frames", cpuFrameTimes.size() },
+            { "objects", options.objectCount },
+            { "width", options.width },
+            { "height", options.height },
+            { "renderer", (const char*)glGetString(GL_RENDERER) },
+            { "cpu", toJson(cpuStats) },
+            { "gpu", toJson(gpuStats) }
+        };
+        std::ofstream(options.outputPath) << result.dump(4) << std::endl;
+    }
+
+    writeChromeTrace(options.tracePath);
+    deleteProfiler();
+    scene.clean();
+    deleteJobSystem();
+    gpuFrameTimer.deleteQueries();
+    frameUniformBuffer.deleteFrameUniformBuffer();
+    defaultMaterialArena.deleteUniformBlockArena();
+    if (framebuffer) {
+        framebuffer->deleteFramebuffer();
+        delete framebuffer;
+    }
+    getGlStateCache().onProgramDeleted(shaderProgram.ID);
+    glDeleteProgram(shaderProgram.ID);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    deletePath();
+
+    return EXIT_SUCCESS;
+}
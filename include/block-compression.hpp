@@ -0,0 +1,37 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include "image-decoder.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* BCn block compression of RGBA8 images, the formats GPUs sample directly at 4-8x less memory and bandwidth than
+RGBA8. Every 4x4 texel block becomes 8 bytes (BC1: opaque RGB) or 16 bytes (BC3: BC1 color plus separate alpha,
+BC5: two independent channels, e.g. normal map XY, BC7: RGBA at higher quality). The encoders fit the endpoints to
+the principal axis of the block's colors and refine them once by least squares: fast enough to convert at load time,
+worse than an exhaustive offline encoder. BC7 only uses mode 6 (one subset, 4-bit indices). Decoding back to RGBA8
+is the fallback for contexts that cannot sample a format, it reads every BC1/BC3/BC5 block but only mode 6 BC7
+blocks, the ones compressImage writes. Blocks hold the texels in the row order of the image, bottom row first like
+ImageLevel, so they upload as they are. No GL calls, everything here may run on worker threads. */
+
+enum BlockFormat { blockFormatRGBA8, blockFormatBC1, blockFormatBC3, blockFormatBC5, blockFormatBC7, blockFormatCount };
+
+struct BlockFormatInfo
+{
+    const char* name;
+    int blockSize;                                                                                                       // Texels per block side, 1 for RGBA8.
+    int blockBytes;
+};
+
+const BlockFormatInfo& getBlockFormatInfo(BlockFormat format);
+
+bool findBlockFormat(const std::string& name, BlockFormat& result);                                                     // By getBlockFormatInfo().name, e.g. "bc7".
+
+size_t getCompressedSize(BlockFormat format, int width, int height);                                                    // Partial blocks at the edges count as whole ones.
+
+std::vector<unsigned char> compressImage(const ImageLevel& image, BlockFormat format);                                 // Edge blocks repeat the last row and column.
+
+bool decompressImage(BlockFormat format, const unsigned char* data, size_t size, int width, int height, ImageLevel& result); // false (and an error) when data is too short or has a BC7 mode other than 6.
+
+#endif
@@ -1,8 +1,10 @@
+#include <stdexcept>
+
 template<class F>
 void checkCondition(bool condition, F errorHandler, const char* errorMessage)
 {
     if (!condition) {
         errorHandler();
-        throw std::exception(errorMessage);
+        throw std::runtime_error(errorMessage);
     }
 }
\ No newline at end of file
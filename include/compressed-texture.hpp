@@ -0,0 +1,20 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include "block-compression.hpp"
+#include <glad/glad.h>
+#include <string>
+
+/* The GL side of BlockFormats: the internal format each one is stored as and whether the context can sample it
+(BC1/BC3 need GL_EXT_texture_compression_s3tc, BC7 GL_ARB_texture_compression_bptc, BC5 is core since 3.0). Formats
+the context lacks are decoded to RGBA8 on the CPU instead, larger in memory but never a missing texture.
+loadKtx2Texture is the synchronous path for textures needed right away: glCompressedTexImage2D reads the levels
+straight out of the file mapping, without a copy in between. TextureManager streams KTX2 files asynchronously. */
+
+GLenum getGlInternalFormat(BlockFormat format);
+
+bool isBlockFormatSupported(BlockFormat format);                                                                         // Only reads the extension flags glad loaded, so workers may call it too.
+
+GLuint loadKtx2Texture(const std::string& absolutePath);                                                                 // The whole mip chain, 0 (and an error) when the file cannot be loaded.
+
+#endif
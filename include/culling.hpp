@@ -0,0 +1,102 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "geometry-pool.hpp"
+#include "multi-draw.hpp"
+#include "shader-program.hpp"
+#include <vector>
+
+/* Visibility culling of mesh instances by their bounding spheres. With compute shaders (GL_ARB_compute_shader,
+GL_ARB_shader_storage_buffer_object, GL_ARB_shading_language_420pack and indirect draws, which a 3.3 context may
+expose: the shader is GLSL 3.30 with those extensions), CullingPass tests every instance on the GPU against the
+frustum and against a Hi-Z depth pyramid of the previous frame, and appends the survivors to their mesh's range of a
+DrawDataBuffer while counting them in the indirect commands: the CPU never reads the result, and one
+glMultiDrawElementsIndirect draws every visible instance of every mesh. Without compute shaders the frustum test runs
+on the CPU, split over the job system, and each mesh is drawn with one instanced call; occlusion culling needs the
+GPU and is skipped.
+Occlusion uses last frame's depth, so an object that becomes visible from behind an occluder shows up one frame late. */
+
+struct BoundingSphere
+{
+    Position center;
+    GLfloat radius;
+};
+
+struct Frustum
+{
+    GLfloat planes[6][4];                                                                                                // Normal (pointing inside) and distance, normalized.
+};
+
+Frustum getFrustum(const Matrix4& viewProjection);
+
+bool isSphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere);
+
+BoundingSphere getBoundingSphere(const std::vector<Vertex>& vertices);                                                   // Centered on the bounding box, not minimal but cheap.
+
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const Matrix4& model);                              // The radius grows with the largest axis scale.
+
+class DepthPyramid                                                                                                       // Mip chain of the depth buffer where every texel holds the farthest depth under it.
+{
+private:
+    int width;
+    int height;
+    int levelCount;
+    GLuint framebuffer;
+    GLuint emptyVAO;                                                                                                     // Core profile draws need a VAO, even without attributes.
+    ShaderProgram* reduceProgram;
+public:
+    GLuint texture;                                                                                                      // R32F, full size at level 0.
+
+    DepthPyramid(int width, int height);
+
+    void build(GLuint depthTexture);                                                                                     // From a depth texture of the same size, after the frame was rendered. Restores framebuffer and viewport.
+
+    int getWidth() const { return width; }
+
+    int getHeight() const { return height; }
+
+    int getLevelCount() const { return levelCount; }
+
+    void deleteDepthPyramid();
+};
+
+class CullingPass
+{
+private:
+    GeometryPool* geometryPool;
+    std::vector<MeshAllocation> meshes;
+    std::vector<DrawElementsIndirectCommand> drawCommands;                                                               // One per mesh, baseInstance is the first slot of the mesh's range.
+    std::vector<InstanceData> instances;
+    std::vector<BoundingSphere> boundingSpheres;
+    std::vector<GLuint> meshIndices;
+    std::vector<InstanceData> visibleInstances;                                                                          // CPU path only.
+    std::vector<unsigned char> instanceVisibility;                                                                       // CPU path only, one flag per instance.
+    DrawDataBuffer drawDataBuffer;
+    int instanceCapacity;
+    bool isGpu;
+    ShaderProgram* cullProgram;
+    GLuint sphereBuffer;
+    GLuint meshIndexBuffer;
+    GLuint instanceBuffer;
+    GLuint drawCommandBuffer;
+
+    void cullOnCpu(const Matrix4& viewProjection);
+public:
+    CullingPass(GeometryPool* geometryPool, const std::vector<MeshAllocation>& meshes, int instanceCapacity, bool isGpuPreferred = true);
+
+    void setInstances(const std::vector<InstanceData>& newInstances, const std::vector<BoundingSphere>& newBoundingSpheres,
+                      const std::vector<GLuint>& newMeshIndices);                                                       // World-space spheres, meshIndices index the meshes given to the constructor.
+
+    void cull(const Matrix4& viewProjection, const DepthPyramid* depthPyramid = nullptr,
+              const Matrix4& pyramidViewProjection = Matrix4::identity());                                               // pyramidViewProjection is the camera the pyramid was rendered with.
+
+    void draw(GLuint shaderProgram);                                                                                     // With the DRAW_DATA variant, whose drawData sampler is set to drawDataTextureUnit.
+
+    int getVisibleCount();                                                                                               // On the GPU path this reads the counts back and waits for the GPU, for tests and debugging only.
+
+    bool isGpuCulling() const { return isGpu; }
+
+    void deleteCullingPass();
+};
+
+#endif
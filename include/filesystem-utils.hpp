@@ -9,15 +9,25 @@ struct ConfigData
     bool isBorderless;
     int width;
     int height;
+    std::string profilerTracePath;                                                                                       // Chrome trace JSON written on exit, profiling is disabled when empty.
+    bool isShaderHotReloadEnabled;                                                                                       // Recompiles shaders whose files change while running.
+    int textureMemoryBudgetMB;                                                                                           // Video memory the texture manager may keep resident.
+    int workerThreadCount;                                                                                               // Of the job system, 0 for one per core besides the main thread.
 };
 
-enum PathNodeType { configJson, vertexShader, fragmentShader };
+enum PathNodeType { configJson, vertexShader, fragmentShader, shaderCache, shadersDirectory, texturesDirectory };
 
 void addShaderPath(GLenum shaderType, const std::string& shaderName);
 
 std::string getAbsolutePath(PathNodeType type);
 
-std::string getShaderAbsolutePath(GLenum shaderType, const std::string& jsonKey);
+std::string getShaderAbsolutePath(GLenum shaderType, const std::string& jsonKey);                                       // Also makes it the vertex or fragment shader of getAbsolutePath().
+
+std::string getShaderFileAbsolutePath(const std::string& shaderName);                                                    // resources/shaders/shaderName, leaves the configured shader paths alone.
+
+std::string getTextureAbsolutePath(const std::string& textureName);                                                       // resources/textures/textureName.
+
+std::string getShaderCacheDirectory();                                                                                  // resources/shader-cache, created on first use.
 
 void deletePath();
 
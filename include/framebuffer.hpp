@@ -0,0 +1,29 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h>
+
+class Framebuffer                                                                                                        // Offscreen render target: a color texture and a depth texture attached to one framebuffer object (FBO).
+{
+private:
+    int width;
+    int height;
+public:
+    GLuint ID;
+    GLuint colorTexture;
+    GLuint depthTexture;
+
+    Framebuffer(int width, int height);
+
+    int getWidth() const { return width; }
+
+    int getHeight() const { return height; }
+
+    void bind() const;
+
+    void unbind() const;
+
+    void deleteFramebuffer();
+};
+
+#endif
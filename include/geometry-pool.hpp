@@ -0,0 +1,102 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include "geometry/vertex-layout.hpp"
+#include <map>
+#include <vector>
+
+/* Shared vertex and index buffers for static meshes of one vertex format. Instead of a VAO, VBO and EBO per mesh, a
+mesh is a range of vertices and a range of indices in the pool, and is drawn with glDrawElementsBaseVertex: indices
+stay relative to the mesh's first vertex, so 16-bit indices work no matter where in the pool the mesh lives. Every
+mesh of the pool shares one VAO, so the render queue never rebinds between them, and they can be merged into
+multi-draw calls. Ranges come from a free list that merges neighbouring free ranges on release; when a range does
+not fit, the buffers grow to twice their size on the GPU (glCopyBufferSubData). */
+
+class RangeAllocator                                                                                                     // Best fit over [0, capacity), in elements.
+{
+private:
+    std::map<int, int> freeRanges;                                                                                       // Offset to size, ordered so neighbours can be merged.
+    int capacity;
+    int freeSize;
+public:
+    explicit RangeAllocator(int capacity = 0);
+
+    int allocate(int size);                                                                                              // Offset of the range, -1 when no free range is large enough.
+
+    void release(int offset, int size);
+
+    void grow(int newCapacity);
+
+    int getCapacity() const { return capacity; }
+
+    int getFreeSize() const { return freeSize; }
+
+    int getFreeRangeCount() const { return freeRanges.size(); }                                                          // More ranges for the same free size means more fragmentation.
+};
+
+struct MeshAllocation
+{
+    GLint baseVertex = 0;
+    int vertexCount = 0;
+    int firstIndex = 0;
+    int elementsCount = 0;
+    bool isValid = false;                                                                                                // False for a failed allocation, which holds no space in the pool.
+};
+
+class GeometryPool
+{
+private:
+    const VertexAttribute* attributes;
+    int attributeCount;
+    GLsizei stride;
+    RangeAllocator vertexAllocator;
+    RangeAllocator indexAllocator;
+
+    void createBuffers(int vertexCapacity, int indexCapacity);
+    void growBuffers(int minVertexCapacity, int minIndexCapacity);
+public:
+    GLuint VAO;
+    GLuint VBO;
+    GLuint EBO;
+    GLenum indexType;
+
+    GeometryPool(const VertexAttribute* attributes, int attributeCount, GLsizei stride, int vertexCapacity, int indexCapacity,
+                 GLenum indexType = GL_UNSIGNED_SHORT);                                                                  // GL_UNSIGNED_SHORT limits meshes to 65536 vertices each, not the pool.
+
+    MeshAllocation allocate(const void* vertices, int vertexCount, const std::vector<GLuint>& indices);
+
+    template<class VertexType>
+    MeshAllocation allocate(const std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)
+    {
+        static_assert(isVertexLayoutValid<VertexType>(), "invalid vertex layout");
+        if (VertexLayout<VertexType>::attributes != attributes)
+            return MeshAllocation();                                                                                     // Another vertex format, it needs a pool of its own.
+        return allocate(vertices.data(), vertices.size(), indices);
+    }
+
+    void release(const MeshAllocation& allocation);
+
+    GLintptr getIndexOffset(const MeshAllocation& allocation) const;                                                     // Byte offset of the mesh's first index, for draw calls and RenderCommand::indexOffset.
+
+    void draw(GLuint shaderProgram, const MeshAllocation& allocation) const;
+
+    int getVertexCapacity() const { return vertexAllocator.getCapacity(); }
+
+    int getIndexCapacity() const { return indexAllocator.getCapacity(); }
+
+    int getUsedVertexCount() const { return vertexAllocator.getCapacity() - vertexAllocator.getFreeSize(); }
+
+    int getUsedIndexCount() const { return indexAllocator.getCapacity() - indexAllocator.getFreeSize(); }
+
+    void deleteGeometryPool();
+};
+
+template<class VertexType>
+GeometryPool createGeometryPool(int vertexCapacity, int indexCapacity, GLenum indexType = GL_UNSIGNED_SHORT)
+{
+    static_assert(isVertexLayoutValid<VertexType>(), "invalid vertex layout");
+    return GeometryPool(VertexLayout<VertexType>::attributes, getVertexAttributeCount<VertexType>(), sizeof(VertexType),
+                        vertexCapacity, indexCapacity, indexType);
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef MATRIX_UTILS_H
+#define MATRIX_UTILS_H
+
+#include "vertex-utils.hpp"
+#include <cmath>
+
+struct Matrix4                                                                                                           // Column-major 4x4 matrix, the memory layout GLSL mat4 attributes and uniforms expect.
+{
+    GLfloat m[16];
+
+    GLfloat& at(int column, int row) { return m[column * 4 + row]; }
+    GLfloat at(int column, int row) const { return m[column * 4 + row]; }
+
+    static Matrix4 identity()
+    {
+        Matrix4 result = {};
+        result.at(0, 0) = result.at(1, 1) = result.at(2, 2) = result.at(3, 3) = 1.0f;
+        return result;
+    }
+
+    static Matrix4 translation(const Position& offset)
+    {
+        Matrix4 result = identity();
+        result.at(3, 0) = offset.x;
+        result.at(3, 1) = offset.y;
+        result.at(3, 2) = offset.z;
+        return result;
+    }
+
+    static Matrix4 scale(const Position& factor)
+    {
+        Matrix4 result = identity();
+        result.at(0, 0) = factor.x;
+        result.at(1, 1) = factor.y;
+        result.at(2, 2) = factor.z;
+        return result;
+    }
+
+    static Matrix4 rotation(GLfloat angle, Position axis)                                                                // Rotation by angle radians around axis (Rodrigues' formula).
+    {
+        GLfloat length = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+        if (length == 0.0f)
+            return identity();
+        GLfloat x = axis.x / length, y = axis.y / length, z = axis.z / length;
+        GLfloat c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+
+        Matrix4 result = identity();
+        result.at(0, 0) = t * x * x + c;     result.at(1, 0) = t * x * y - s * z; result.at(2, 0) = t * x * z + s * y;
+        result.at(0, 1) = t * x * y + s * z; result.at(1, 1) = t * y * y + c;     result.at(2, 1) = t * y * z - s * x;
+        result.at(0, 2) = t * x * z - s * y; result.at(1, 2) = t * y * z + s * x; result.at(2, 2) = t * z * z + c;
+        return result;
+    }
+
+    static Matrix4 perspective(GLfloat fovY, GLfloat aspect, GLfloat zNear, GLfloat zFar)                                // Right-handed projection into OpenGL's [-1, 1] clip depth range.
+    {
+        GLfloat f = 1.0f / std::tan(fovY / 2.0f);
+        Matrix4 result = {};
+        result.at(0, 0) = f / aspect;
+        result.at(1, 1) = f;
+        result.at(2, 2) = (zFar + zNear) / (zNear - zFar);
+        result.at(2, 3) = -1.0f;
+        result.at(3, 2) = 2.0f * zFar * zNear / (zNear - zFar);
+        return result;
+    }
+
+    static Matrix4 lookAt(const Position& eye, const Position& target, const Position& up)
+    {
+        Position forward = normalize(Position(target.x - eye.x, target.y - eye.y, target.z - eye.z));
+        Position side = normalize(cross(forward, up));
+        Position upward = cross(side, forward);
+
+        Matrix4 result = identity();
+        result.at(0, 0) = side.x;     result.at(1, 0) = side.y;     result.at(2, 0) = side.z;
+        result.at(0, 1) = upward.x;   result.at(1, 1) = upward.y;   result.at(2, 1) = upward.z;
+        result.at(0, 2) = -forward.x; result.at(1, 2) = -forward.y; result.at(2, 2) = -forward.z;
+        result.at(3, 0) = -(side.x * eye.x + side.y * eye.y + side.z * eye.z);
+        result.at(3, 1) = -(upward.x * eye.x + upward.y * eye.y + upward.z * eye.z);
+        result.at(3, 2) = forward.x * eye.x + forward.y * eye.y + forward.z * eye.z;
+        return result;
+    }
+
+    static Position cross(const Position& a, const Position& b)
+    {
+        return Position(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+
+    static Position normalize(const Position& v)
+    {
+        GLfloat length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return length == 0.0f ? v : Position(v.x / length, v.y / length, v.z / length);
+    }
+
+    Matrix4 operator*(const Matrix4& other) const
+    {
+        Matrix4 result = {};
+        for (int column = 0; column < 4; column++)
+            for (int row = 0; row < 4; row++)
+                for (int k = 0; k < 4; k++)
+                    result.at(column, row) += at(k, row) * other.at(column, k);
+        return result;
+    }
+
+    Position transformPoint(const Position& point) const                                                                 // Applies the matrix to (point, 1) and drops w, for affine matrices.
+    {
+        return Position(at(0, 0) * point.x + at(1, 0) * point.y + at(2, 0) * point.z + at(3, 0),
+                        at(0, 1) * point.x + at(1, 1) * point.y + at(2, 1) * point.z + at(3, 1),
+                        at(0, 2) * point.x + at(1, 2) * point.y + at(2, 2) * point.z + at(3, 2));
+    }
+};
+
+#endif
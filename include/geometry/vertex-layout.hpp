@@ -0,0 +1,82 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+/* Compile-time description of an interleaved vertex struct. A vertex type specializes VertexLayout with a constexpr
+array of attributes built by VERTEX_ATTRIBUTE, which takes the component count and GL type from the member's type and
+the offset from offsetof, so the attribute setup always matches the struct in memory. enableVertexLayout() (see
+renderer.hpp) turns that array into glVertexAttribPointer calls, so meshes with tighter formats need no new code in
+the renderer, only a layout. */
+
+template<class AttributeType>
+struct VertexAttributeFormat;                                                                                            // Specialized per member type: componentCount, type, isNormalized and isInteger.
+
+template<GLint count, GLenum glType, GLboolean normalized = GL_FALSE, bool integer = false>
+struct VertexAttributeFormatOf
+{
+    static constexpr GLint componentCount = count;
+    static constexpr GLenum type = glType;
+    static constexpr GLboolean isNormalized = normalized;
+    static constexpr bool isInteger = integer;                                                                           // Read with glVertexAttribIPointer, the shader sees an ivec/uvec instead of a float.
+};
+
+template<> struct VertexAttributeFormat<GLfloat> : VertexAttributeFormatOf<1, GL_FLOAT> {};
+template<> struct VertexAttributeFormat<GLint> : VertexAttributeFormatOf<1, GL_INT, GL_FALSE, true> {};
+template<> struct VertexAttributeFormat<GLuint> : VertexAttributeFormatOf<1, GL_UNSIGNED_INT, GL_FALSE, true> {};
+
+struct VertexAttribute
+{
+    GLuint location;
+    GLint componentCount;
+    GLenum type;
+    GLboolean isNormalized;
+    bool isInteger;
+    size_t offset;
+    size_t size;                                                                                                         // Bytes taken by the member, only used to validate the layout.
+};
+
+#define VERTEX_ATTRIBUTE(vertexType, member, location)                                                                  \
+    VertexAttribute{ location, VertexAttributeFormat<decltype(vertexType::member)>::componentCount,                      \
+                     VertexAttributeFormat<decltype(vertexType::member)>::type,                                          \
+                     VertexAttributeFormat<decltype(vertexType::member)>::isNormalized,                                  \
+                     VertexAttributeFormat<decltype(vertexType::member)>::isInteger,                                     \
+                     offsetof(vertexType, member), sizeof(vertexType::member) }
+
+template<class AttributeType>
+constexpr VertexAttribute getStreamAttribute(GLuint location)                                                            // The only attribute of a tightly packed stream of AttributeType (see mesh-streams.hpp).
+{
+    return VertexAttribute{ location, VertexAttributeFormat<AttributeType>::componentCount, VertexAttributeFormat<AttributeType>::type,
+                            VertexAttributeFormat<AttributeType>::isNormalized, VertexAttributeFormat<AttributeType>::isInteger,
+                            0, sizeof(AttributeType) };
+}
+
+template<class VertexType>
+struct VertexLayout;                                                                                                     // Specialized per vertex type with: static constexpr VertexAttribute attributes[] = { VERTEX_ATTRIBUTE(...), ... };
+
+template<class VertexType>
+constexpr int getVertexAttributeCount()
+{
+    return sizeof(VertexLayout<VertexType>::attributes) / sizeof(VertexAttribute);
+}
+
+template<class VertexType>
+constexpr bool isVertexLayoutValid()                                                                                     // Attributes inside the struct, without overlaps or repeated locations.
+{
+    constexpr int count = getVertexAttributeCount<VertexType>();
+    for (int i = 0; i < count; i++) {
+        const VertexAttribute& attribute = VertexLayout<VertexType>::attributes[i];
+        if (attribute.offset + attribute.size > sizeof(VertexType))
+            return false;
+        for (int j = i + 1; j < count; j++) {
+            const VertexAttribute& other = VertexLayout<VertexType>::attributes[j];
+            if (attribute.location == other.location
+                    || (attribute.offset < other.offset + other.size && other.offset < attribute.offset + attribute.size))
+                return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include "vertex-utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/* Compact vertex formats. Vertex takes 48 bytes; PackedVertex takes 20: positions as 16-bit unorm relative to the mesh
+bounds (HalfPackedVertex uses half floats instead and needs no bounds), normals octahedral-encoded into the x and y of
+a GL_INT_2_10_10_10_REV, colors as normalized bytes and UVs as half floats. Quantized positions are decoded in the
+vertex shader by the QUANTIZED_POSITION variant of vertexShader.glsl, with positionScale = bounds extent and
+positionOffset = bounds min. A shader reading packed normals decodes them like decodeOctahedral() below.
+Precision: unorm16 positions are within about extent / 131070 of the source, half floats keep 11 significant bits,
+octahedral normals in 10 bits are within about 0.25 degrees, colors within 1 / 510. tests/vertex-packing-test.cpp
+checks the position, half float and normal bounds. */
+
+inline GLhalf floatToHalf(GLfloat value)                                                                                 // Rounds to nearest even, overflows to infinity and keeps half subnormals.
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    GLhalf sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude >= 0x7F800000)                                                                                         // Infinity or NaN.
+        return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+    if (magnitude >= 0x477FF000)                                                                                         // Rounds above 65504, the largest half.
+        return sign | 0x7C00;
+    if (magnitude < 0x38800000) {                                                                                        // Below 2^-14, a half subnormal in steps of 2^-24.
+        GLfloat absolute;
+        memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | (GLhalf)std::nearbyint(absolute * 16777216.0f);
+    }
+    uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+    return sign | (GLhalf)((rounded - 0x38000000) >> 13);                                                                // Rebiases the exponent from 127 to 15.
+}
+
+inline GLfloat halfToFloat(GLhalf value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    if (exponent == 0) {
+        GLfloat result = std::ldexp((GLfloat)mantissa, -24);
+        return sign ? -result : result;
+    }
+    uint32_t bits = exponent == 31 ? sign | 0x7F800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    GLfloat result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline GLushort packUnorm16(GLfloat value) { return (GLushort)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f); }
+
+inline GLfloat unpackUnorm16(GLushort value) { return value / 65535.0f; }
+
+inline GLubyte packUnorm8(GLfloat value) { return (GLubyte)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f); }
+
+inline GLfloat unpackUnorm8(GLubyte value) { return value / 255.0f; }
+
+inline GLuint packInt2101010Rev(GLfloat x, GLfloat y, GLfloat z, GLint w = 0)                                          // Signed normalized x, y, z in 10 bits each (x lowest), w in the top 2 bits.
+{
+    auto packSnorm10 = [](GLfloat value) { return (GLuint)std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f) & 0x3FF; };
+    return packSnorm10(x) | (packSnorm10(y) << 10) | (packSnorm10(z) << 20) | (((GLuint)w & 0x3) << 30);
+}
+
+inline GLfloat unpackSnorm10(GLuint packed, int component)                                                               // The GL 4.2+ rule, max(c / 511, -1), which is what current drivers use.
+{
+    GLint value = (GLint)(packed << (22 - component * 10)) >> 22;                                                        // Sign-extends the 10-bit field.
+    return std::max(value / 511.0f, -1.0f);
+}
+
+inline void encodeOctahedral(const Position& normal, GLfloat& u, GLfloat& v)                                           // Projects the unit sphere onto an octahedron unfolded into [-1, 1]^2.
+{
+    GLfloat length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (length == 0.0f) {
+        u = v = 0.0f;
+        return;
+    }
+    GLfloat x = normal.x / length, y = normal.y / length;
+    if (normal.z < 0.0f) {                                                                                               // Folds the lower hemisphere over the diagonals.
+        GLfloat foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+    }
+    u = x;
+    v = y;
+}
+
+inline Position decodeOctahedral(GLfloat u, GLfloat v)
+{
+    Position normal(u, v, 1.0f - std::fabs(u) - std::fabs(v));
+    if (normal.z < 0.0f) {
+        normal.x = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        normal.y = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    }
+    GLfloat length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+    return Position(normal.x / length, normal.y / length, normal.z / length);
+}
+
+struct MeshBounds
+{
+    Position min;
+    Position max;
+
+    Position getExtent() const { return Position(max.x - min.x, max.y - min.y, max.z - min.z); }
+};
+
+inline MeshBounds getMeshBounds(const std::vector<Vertex>& vertices)
+{
+    if (vertices.empty())
+        return MeshBounds();
+    MeshBounds bounds = { vertices[0].position, vertices[0].position };
+    for (const Vertex& vertex : vertices) {
+        bounds.min = Position(std::min(bounds.min.x, vertex.position.x), std::min(bounds.min.y, vertex.position.y), std::min(bounds.min.z, vertex.position.z));
+        bounds.max = Position(std::max(bounds.max.x, vertex.position.x), std::max(bounds.max.y, vertex.position.y), std::max(bounds.max.z, vertex.position.z));
+    }
+    return bounds;
+}
+
+struct QuantizedPosition
+{
+    GLushort x, y, z;
+    GLushort padding;                                                                                                    // Keeps the next attribute 4-byte aligned.
+};
+
+struct HalfPosition
+{
+    GLhalf x, y, z;
+    GLhalf padding;
+};
+
+struct PackedNormal
+{
+    GLuint bits;                                                                                                         // Octahedral u and v in the first two 10-bit fields.
+};
+
+struct PackedColor
+{
+    GLubyte r, g, b, a;
+};
+
+struct HalfUV
+{
+    GLhalf u, v;
+};
+
+template<> struct VertexAttributeFormat<QuantizedPosition> : VertexAttributeFormatOf<3, GL_UNSIGNED_SHORT, GL_TRUE> {};
+template<> struct VertexAttributeFormat<HalfPosition> : VertexAttributeFormatOf<3, GL_HALF_FLOAT> {};
+template<> struct VertexAttributeFormat<PackedNormal> : VertexAttributeFormatOf<4, GL_INT_2_10_10_10_REV, GL_TRUE> {};
+template<> struct VertexAttributeFormat<PackedColor> : VertexAttributeFormatOf<4, GL_UNSIGNED_BYTE, GL_TRUE> {};
+template<> struct VertexAttributeFormat<HalfUV> : VertexAttributeFormatOf<2, GL_HALF_FLOAT> {};
+
+template<class PositionType>
+struct PackedVertexOf
+{
+    PositionType position;
+    PackedNormal normal;
+    PackedColor color;
+    HalfUV uv;
+};
+
+typedef PackedVertexOf<QuantizedPosition> PackedVertex;
+typedef PackedVertexOf<HalfPosition> HalfPackedVertex;
+
+template<class PositionType>
+struct VertexLayout<PackedVertexOf<PositionType>>                                                                        // Same locations as Vertex, the vertex shader reads both.
+{
+    static constexpr VertexAttribute attributes[] = {
+        VERTEX_ATTRIBUTE(PackedVertexOf<PositionType>, position, 0),
+        VERTEX_ATTRIBUTE(PackedVertexOf<PositionType>, color, 1),
+        VERTEX_ATTRIBUTE(PackedVertexOf<PositionType>, uv, 2),
+        VERTEX_ATTRIBUTE(PackedVertexOf<PositionType>, normal, 3)
+    };
+};
+
+static_assert(sizeof(PackedVertex) == 20 && sizeof(HalfPackedVertex) == 20, "packed vertices are expected to take 20 bytes");
+
+inline GLushort quantizePosition(GLfloat value, GLfloat min, GLfloat extent)
+{
+    return extent > 0.0f ? packUnorm16((value - min) / extent) : 0;
+}
+
+template<class PositionType>
+void packVertexAttributes(const Vertex& vertex, PackedVertexOf<PositionType>& packed)                                   // Everything but the position, which depends on the format.
+{
+    GLfloat u, v;
+    encodeOctahedral(vertex.normals, u, v);
+    packed.normal.bits = packInt2101010Rev(u, v, 0.0f);
+    packed.color = { packUnorm8(vertex.color.r), packUnorm8(vertex.color.g), packUnorm8(vertex.color.b), packUnorm8(vertex.color.a) };
+    packed.uv = { floatToHalf(vertex.uv.u), floatToHalf(vertex.uv.v) };
+}
+
+inline PackedVertex packVertex(const Vertex& vertex, const MeshBounds& bounds)
+{
+    PackedVertex packed;
+    Position extent = bounds.getExtent();
+    packed.position = { quantizePosition(vertex.position.x, bounds.min.x, extent.x), quantizePosition(vertex.position.y, bounds.min.y, extent.y),
+                        quantizePosition(vertex.position.z, bounds.min.z, extent.z), 0 };
+    packVertexAttributes(vertex, packed);
+    return packed;
+}
+
+inline HalfPackedVertex packVertexHalf(const Vertex& vertex)
+{
+    HalfPackedVertex packed;
+    packed.position = { floatToHalf(vertex.position.x), floatToHalf(vertex.position.y), floatToHalf(vertex.position.z), 0 };
+    packVertexAttributes(vertex, packed);
+    return packed;
+}
+
+inline std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const MeshBounds& bounds)
+{
+    std::vector<PackedVertex> packedVertices;
+    packedVertices.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        packedVertices.push_back(packVertex(vertex, bounds));
+    return packedVertices;
+}
+
+inline std::vector<HalfPackedVertex> packVerticesHalf(const std::vector<Vertex>& vertices)
+{
+    std::vector<HalfPackedVertex> packedVertices;
+    packedVertices.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        packedVertices.push_back(packVertexHalf(vertex));
+    return packedVertices;
+}
+
+template<class PositionType>
+Vertex unpackVertexAttributes(const PackedVertexOf<PositionType>& packed, const Position& position)
+{
+    return Vertex(position,
+                  Color(unpackUnorm8(packed.color.r), unpackUnorm8(packed.color.g), unpackUnorm8(packed.color.b), unpackUnorm8(packed.color.a)),
+                  UV(halfToFloat(packed.uv.u), halfToFloat(packed.uv.v)),
+                  decodeOctahedral(unpackSnorm10(packed.normal.bits, 0), unpackSnorm10(packed.normal.bits, 1)));
+}
+
+inline Vertex unpackVertex(const PackedVertex& packed, const MeshBounds& bounds)                                        // What the vertex shader sees, e.g. to measure the quantization error of a mesh.
+{
+    Position extent = bounds.getExtent();
+    return unpackVertexAttributes(packed, Position(bounds.min.x + unpackUnorm16(packed.position.x) * extent.x,
+                                                   bounds.min.y + unpackUnorm16(packed.position.y) * extent.y,
+                                                   bounds.min.z + unpackUnorm16(packed.position.z) * extent.z));
+}
+
+inline Vertex unpackVertex(const HalfPackedVertex& packed)
+{
+    return unpackVertexAttributes(packed, Position(halfToFloat(packed.position.x), halfToFloat(packed.position.y), halfToFloat(packed.position.z)));
+}
+
+#endif
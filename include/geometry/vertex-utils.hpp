@@ -1,3 +1,7 @@
+#ifndef VERTEX_UTILS_H
+#define VERTEX_UTILS_H
+
+#include "vertex-layout.hpp"
 #include <glad/glad.h>
 
 struct Position
@@ -45,9 +49,23 @@ struct Vertex
 
     Vertex(Position _position, Color _color, UV _uv, Position _normals)
         : position{ _position } , color{ _color }, uv{ _uv }, normals{ _normals } {}
-    //static Layout[] getLayout() {
-    //    retun Layout[] = {
-    //        {3, GL_FLOAT, false}
-    //    }
-    //}
-};
\ No newline at end of file
+};
+
+template<> struct VertexAttributeFormat<Position> : VertexAttributeFormatOf<3, GL_FLOAT> {};
+template<> struct VertexAttributeFormat<Color> : VertexAttributeFormatOf<4, GL_FLOAT> {};
+template<> struct VertexAttributeFormat<UV> : VertexAttributeFormatOf<2, GL_FLOAT> {};
+
+template<>
+struct VertexLayout<Vertex>                                                                                              // Locations match the inputs of vertexShader.glsl.
+{
+    static constexpr VertexAttribute attributes[] = {
+        VERTEX_ATTRIBUTE(Vertex, position, 0),
+        VERTEX_ATTRIBUTE(Vertex, color, 1),
+        VERTEX_ATTRIBUTE(Vertex, uv, 2),
+        VERTEX_ATTRIBUTE(Vertex, normals, 3)
+    };
+};
+
+static_assert(isVertexLayoutValid<Vertex>(), "Vertex layout does not match the struct");
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "geometry/vertex-utils.hpp"
+#include <vector>
+
+/* Shadow copy of the GL state the renderer changes. Setters only call into GL when the value differs from the last
+one set through the cache, and count what they issued and what they elided. Code that changes the same state
+directly, or deletes objects that may still be bound, has to tell the cache (invalidate() / on...Deleted()). */
+
+enum GlStateCall { programCall, vertexArrayCall, bufferCall, bufferRangeCall, textureCall, activeTextureCall, clearColorCall, polygonModeCall, framebufferCall, glStateCallCount };
+
+struct GlStateCacheStats
+{
+    int issuedCallCount[glStateCallCount] = {};
+    int elidedCallCount[glStateCallCount] = {};
+
+    int getIssuedCallCount() const;
+    int getElidedCallCount() const;
+};
+
+const int cachedUniformBindingCount = 16;
+
+class GlStateCache
+{
+private:
+    static constexpr GLuint unknownName = 0xFFFFFFFF;
+    static const int cachedBufferTargetCount = 10;
+
+    GLuint program = unknownName;
+    GLuint vertexArray = unknownName;
+    GLuint framebuffer = unknownName;
+    GLuint buffers[cachedBufferTargetCount];
+    struct BufferRange { GLuint buffer; GLintptr offset; GLsizeiptr size; } uniformRanges[cachedUniformBindingCount];
+    std::vector<GLuint> textures;                                                                                        // Per texture unit, grown to the highest unit bound so far, so every unit GL accepts is cached.
+    std::vector<GLenum> textureTargets;
+    GLuint activeTextureUnit = unknownName;
+    Color clearColor = Color(-1.0f, -1.0f, -1.0f, -1.0f);
+    GLenum polygonMode = 0;
+    GlStateCacheStats stats;
+
+    bool isChanged(GlStateCall call, bool isChanged);
+    static int getBufferTargetSlot(GLenum target);
+public:
+    GlStateCache();
+
+    void useProgram(GLuint newProgram);
+
+    void bindVertexArray(GLuint newVertexArray);
+
+    void bindBuffer(GLenum target, GLuint buffer);
+
+    void bindUniformBufferRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void selectTexture(GLuint unit, GLenum target, GLuint texture);                                                      // bindTexture() that also makes unit active, for glTex* calls on the texture.
+
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);                                                     // Indexed bindings are not cached, only the generic binding they also change.
+
+    void bindFramebuffer(GLuint newFramebuffer);
+
+    void setClearColor(const Color& color);
+
+    void setPolygonMode(GLenum mode);
+
+    GLuint getProgram() const { return program; }
+
+    GLuint getVertexArray() const { return vertexArray; }
+
+    GLuint getFramebuffer() const { return framebuffer; }
+
+    void onProgramDeleted(GLuint deletedProgram);
+
+    void onVertexArrayDeleted(GLuint deletedVertexArray);
+
+    void onBufferDeleted(GLuint deletedBuffer);
+
+    void onTextureDeleted(GLuint deletedTexture);
+
+    void onFramebufferDeleted(GLuint deletedFramebuffer);
+
+    void invalidate();
+
+    const GlStateCacheStats& getStats() const { return stats; }
+
+    void reportStats();
+
+    void resetStats() { stats = GlStateCacheStats(); }
+};
+
+GlStateCache& getGlStateCache();
+
+#endif
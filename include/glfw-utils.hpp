@@ -2,10 +2,12 @@
 #include <GLFW/glfw3.h>
 #include <string>
 
-void initGLFW();
+void initGLFW(bool isHeadless = false);
 
 GLFWwindow* createWindow(const char* windowName, bool isFullscreen, bool isBorderless, int width, int height);
 
+GLFWwindow* createHeadlessWindow(const char* windowName, int width, int height);
+
 template<class F>
 void checkCondition(bool condition, F errorHandler = {}, std::string errorMessage = "");
 
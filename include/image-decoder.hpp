@@ -0,0 +1,34 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Decoding of source images into RGBA8 and CPU mip chains for them, with no image library dependency. JPEG decoding
+(jpeg-decoder.cpp) covers baseline and progressive Huffman coded 8-bit grayscale and YCbCr/RGB images, PNG decoding
+(png-decoder.cpp, with its own inflate) covers every color type, bit depth and interlacing; 16-bit samples keep their
+high byte. Rows are stored bottom row first, the order glTexImage2D expects for v = 0 at the bottom. No GL calls and
+no shared state, everything here may run on worker threads. tests/image-decoder-test.cpp checks both decoders against
+libjpeg and libpng output and feeds them truncated and corrupt files. */
+
+struct ImageLevel
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;                                                                                   // RGBA8, width * 4 bytes per row, empty once handed to GL.
+};
+
+bool decodeImage(const char* data, size_t size, ImageLevel& result);                                                     // The format is detected from the signature, false (and an error) when it cannot be decoded.
+
+bool decodeJpeg(const char* data, size_t size, ImageLevel& result);
+
+bool decodePng(const char* data, size_t size, ImageLevel& result);
+
+bool decodeImageFile(const std::string& absolutePath, ImageLevel& result);
+
+int getMipLevelCount(int width, int height);                                                                             // Down to 1x1.
+
+std::vector<ImageLevel> generateMipChain(ImageLevel&& image);                                                            // Level 0 is image, every further level a 2x2 box filter of the previous one.
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/* Work-stealing job system. Every worker thread owns a lock-free deque (Chase-Lev): it pushes and pops its own jobs at
+the bottom, newest first while their data is still in cache, and when it runs dry steals the oldest job from the top
+of another deque. The thread that called initJobSystem (the main thread) owns a deque too but only runs jobs while it
+waits on a counter, so a frame that waits for its culling or animation jobs helps with them instead of blocking.
+Other threads (TextureManager workers, for example) submit through a shared queue under a mutex.
+A JobCounter counts unfinished jobs: runJob increments it, the finished job decrements it, waitForCounter runs jobs
+until it reaches zero, and runJobAfter queues a job that starts once a counter reaches zero (a dependency), without a
+thread blocking on it. A counter can be reused once it reached zero and every runJobAfter on it has started.
+Idle workers sleep on a condition variable and never spin. waitForCounter yields a few times when it finds no job to
+run, then sleeps too, until a job is queued or a job of the counter finishes. Before initJobSystem (and after
+deleteJobSystem), jobs run right away on the submitting thread, so code using jobs works without workers, for example
+in tools. */
+
+struct Job;
+
+class JobCounter
+{
+private:
+    std::atomic<int> value{ 0 };
+    std::mutex continuationMutex;
+    std::vector<Job*> continuations;                                                                                     // Jobs queued by runJobAfter, submitted once value reaches zero.
+
+    friend void runJob(std::function<void()> function, JobCounter* counter);
+    friend void runJobAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter);
+    friend void finishJob(Job* job);
+    friend void waitForCounter(JobCounter& counter);
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return value.load() == 0; }
+};
+
+const int defaultParallelForBatchSize = 256;
+
+void initJobSystem(int workerCount);                                                                                     // workerCount <= 0 picks std::thread::hardware_concurrency() - 1 (the main thread is the last core), at least 1.
+
+int getJobWorkerCount();                                                                                                 // 0 without a job system.
+
+void runJob(std::function<void()> function, JobCounter* counter = nullptr);
+
+void runJobAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);                // counter counts the job from now on, not only once it starts.
+
+void waitForCounter(JobCounter& counter);                                                                                // Runs queued jobs on this thread meanwhile.
+
+void parallelFor(int count, int batchSize, const std::function<void(int begin, int end)>& function);                     // function over [begin, end) batches of [0, count) on all threads, returns when every batch is done.
+
+void deleteJobSystem();                                                                                                  // Runs the queued jobs and stops the workers.
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef KTX2_FILE_H
+#define KTX2_FILE_H
+
+#include "block-compression.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Reading and writing of KTX2 containers (Khronos texture format 2) holding a 2D texture and its mip chain in one of
+the BlockFormats. Only what the engine writes is read back: a single face and layer, no supercompression (Basis,
+zstd), Vulkan formats of the BlockFormats only. writeKtx2File stores the levels as they are given, bottom row
+first, and records that as "KTXorientation" = "ru" (KTX2 defaults to the top row first), so they upload unchanged;
+files of other tools without the key come out upside down. No GL calls. */
+
+struct Ktx2Level
+{
+    int width;
+    int height;
+    const unsigned char* data;                                                                                           // Points into the buffer given to readKtx2.
+    size_t size;
+};
+
+struct Ktx2Image
+{
+    BlockFormat format;
+    std::vector<Ktx2Level> levels;                                                                                       // Largest first.
+};
+
+bool readKtx2(const char* data, size_t size, Ktx2Image& result);                                                         // false (and an error) when the container is malformed or uses what is not supported.
+
+bool writeKtx2File(const std::string& path, BlockFormat format, const std::vector<ImageLevel>& levels);                // levels[i].pixels holds the level in format, largest level first.
+
+bool isKtx2Path(const std::string& path);                                                                               // By the .ktx2 extension.
+
+#endif
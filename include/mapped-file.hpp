@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/* Read-only memory mapping of a whole file (mmap on POSIX, MapViewOfFile on Windows). The contents are paged in by the
+OS on first access and never copied into the process heap, so shader sources and large assets can be handed to GL
+straight from the mapping. Not null-terminated: always use getData() together with getSize(). Keep mappings of files
+that may be rewritten (e.g. shaders during hot reload) short-lived, reading a mapped file that was truncated faults. */
+
+class MappedFile
+{
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path);                                                                                  // false (and an error) when the file cannot be opened or mapped.
+
+    bool isOpen() const { return data != nullptr; }
+
+    const char* getData() const { return data; }
+
+    size_t getSize() const { return size; }
+
+    void close();
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "geometry/vertex-utils.hpp"
+#include <vector>
+
+/* Load-time mesh optimization, meant to run once before getVertexArrayData(). optimizeMesh() applies the stages in the
+order they depend on each other:
+1. deduplicateVertices: merges bitwise identical vertices, so shared corners are transformed once.
+2. optimizeVertexCache: reorders triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm),
+   cutting vertex shader invocations to close to one per vertex.
+3. optimizeOverdraw: splits the cache-optimized order into clusters and sorts them outward-facing first (Sander et al.,
+   "Fast triangle reordering for vertex locality and reduced overdraw"), giving up at most threshold times the ACMR.
+4. optimizeVertexFetch: renumbers vertices in the order the index buffer first uses them, so vertex fetch reads memory
+   linearly, and drops unreferenced vertices.
+getVertexArrayData() then stores the indices as GL_UNSIGNED_SHORT when the mesh has at most 65536 vertices. */
+
+const int vertexCacheSize = 32;                                                                                          // Cache model used by the optimizer, larger than any real FIFO so it suits all of them.
+
+int deduplicateVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);                                  // Returns the new vertex count.
+
+void optimizeVertexCache(std::vector<GLuint>& indices, int vertexCount);
+
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, GLfloat threshold = 1.05f);
+
+int optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);                                  // Returns the new vertex count.
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+GLfloat getAverageCacheMissRatio(const std::vector<GLuint>& indices, int vertexCount, int cacheSize = 16);               // ACMR, vertex shader invocations per triangle with a FIFO cache: 3 is the worst, about 0.5 the best for regular grids.
+
+#endif
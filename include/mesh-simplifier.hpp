@@ -0,0 +1,45 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "renderer.hpp"
+#include <vector>
+
+/* Level of detail through quadric error metric simplification (Garland & Heckbert). Edges collapse into one of their
+endpoints, so every LOD indexes the same vertex buffer: a LodMesh is one VertexArrayData whose element buffer holds the
+index ranges of all LODs back to back. Vertices on attribute seams (same position, different color/UV/normal) and
+border corners never move, and other border vertices only slide along their straight stretch of the border, so LODs
+keep the silhouette and do not tear textures. Each LOD records an estimate of its geometric error in mesh units: the
+root of the quadric error, an area-weighted mean squared distance to the original faces, not a bound on the largest
+distance. selectLod() projects that error to pixels and picks the coarsest LOD that stays under the threshold, so
+distant or small objects draw a fraction of the triangles. */
+
+struct MeshLod
+{
+    int firstIndex;
+    int elementsCount;
+    GLfloat error;                                                                                                       // Root mean squared distance to the original faces at the worst collapse, summed over the LODs before. 0 for LOD 0.
+};
+
+struct LodMesh
+{
+    VertexArrayData vertexArrayData;
+    std::vector<MeshLod> lods;                                                                                           // From the full mesh down to the coarsest.
+    Position center;
+    GLfloat radius;
+};
+
+std::vector<GLuint> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int targetIndexCount,
+                                 GLfloat maxError, GLfloat* resultError = nullptr);                                      // Indices into the same vertices, with at least targetIndexCount indices unless maxError is reached first.
+
+LodMesh getLodMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int maxLodCount = 5,
+                   GLfloat reduction = 0.5f);                                                                            // Each LOD keeps about reduction times the triangles of the previous one.
+
+GLfloat getProjectedSize(GLfloat size, GLfloat distance, GLfloat verticalFov, int viewportHeight);                      // Pixels covered by size mesh units at distance under a perspective projection.
+
+int selectLod(const LodMesh& lodMesh, GLfloat distance, GLfloat verticalFov, int viewportHeight, GLfloat maxPixelError = 1.0f);
+
+void drawLod(GLuint shaderProgram, const LodMesh& lodMesh, int lod);
+
+void cleanLodMesh(LodMesh lodMesh);
+
+#endif
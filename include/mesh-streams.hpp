@@ -0,0 +1,57 @@
+#ifndef MESH_STREAMS_H
+#define MESH_STREAMS_H
+
+#include "geometry/vertex-packing.hpp"
+#include "geometry/matrix-utils.hpp"
+#include <vector>
+
+/* Structure-of-arrays meshes, next to the interleaved VertexArrayData. Every attribute lives in its own contiguous array
+on the CPU and in its own VBO on the GPU, so passes that only need positions (depth prepass, shadow maps) fetch only
+the position stream through positionOnlyVAO, and CPU-side processing (bounds, transforms, skinning) walks one tightly
+packed array the compiler can vectorize. Streams left empty get no VBO, their attribute stays disabled. */
+
+enum VertexStream
+{
+    positionStream,                                                                                                      // Stream index is also the attribute location, the same as in Vertex.
+    colorStream,
+    uvStream,
+    normalStream,
+    vertexStreamCount
+};
+
+struct MeshStreams
+{
+    std::vector<Position> positions;
+    std::vector<Color> colors;
+    std::vector<UV> uvs;
+    std::vector<Position> normals;
+    std::vector<GLuint> indices;
+
+    int getVertexCount() const { return positions.size(); }
+
+    void append(const Vertex& vertex);
+
+    static MeshStreams fromVertices(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+
+    std::vector<Vertex> toVertices() const;                                                                              // Interleaved again, missing streams take default values.
+};
+
+MeshBounds getMeshBounds(const MeshStreams& meshStreams);
+
+void transformMeshStreams(MeshStreams& meshStreams, const Matrix4& transform);                                          // Positions by transform, normals by its upper 3x3 (renormalized), for uniform scales.
+
+struct MultiStreamMesh
+{
+    GLuint VAO;                                                                                                          // All present streams.
+    GLuint positionOnlyVAO;                                                                                              // Only the position stream, for depth-only passes.
+    GLuint VBO[vertexStreamCount];                                                                                       // 0 for streams the mesh does not have.
+    GLuint EBO;
+    int elementsCount;
+    GLenum indexType;
+};
+
+MultiStreamMesh getMultiStreamMesh(const MeshStreams& meshStreams);
+
+void cleanMultiStreamMesh(MultiStreamMesh multiStreamMesh);
+
+#endif
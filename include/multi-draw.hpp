@@ -0,0 +1,58 @@
+#ifndef MULTI_DRAW_H
+#define MULTI_DRAW_H
+
+#include "renderer.hpp"
+#include <vector>
+
+/* Per-draw data for draws merged into one multi-draw call. Every draw has a draw ID, and the DRAW_DATA variant of
+vertexShader.glsl reads its InstanceData (model matrix and color) from a texture buffer at slot drawId + gl_InstanceID.
+GLSL 330 has no gl_DrawID, so the ID comes in through an attribute instead: with GL_ARB_multi_draw_indirect and
+GL_ARB_base_instance it is an array of 0, 1, 2, ... whose divisor is so large that every instance reads the element
+at the command's base instance, which the render queue sets to the draw ID. Without them (plain 3.3 contexts) the
+attribute stays disabled and reads its constant value, which the render queue sets once per merged call, so only
+draws sharing a draw ID can be merged into glMultiDrawElementsBaseVertex. A buffer created with texture references
+also holds a TextureReference per slot in a second texture buffer, which only the TEXTURE_ARRAY variants read. */
+
+struct DrawElementsIndirectCommand                                                                                       // Layout fixed by GL for GL_DRAW_INDIRECT_BUFFER.
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+const GLuint drawIdAttributeLocation = 9;                                                                                // First location after the instance attributes (4..8).
+const GLuint drawDataTextureUnit = 15;                                                                                   // Last texture unit GL 3.3 guarantees to vertex shaders.
+const GLuint drawTextureReferencesTextureUnit = 14;                                                                      // TextureReference per slot as one RGBA32UI texel, the layer as float bits.
+const int drawDataTexelCount = sizeof(InstanceData) / (4 * sizeof(GLfloat));                                            // RGBA32F texels per slot.
+
+bool isMultiDrawIndirectSupported();
+
+class DrawDataBuffer
+{
+private:
+    int capacity;
+    GLuint drawIdVBO;                                                                                                    // 0 without base instances.
+    GLuint textureReferenceBuffer;                                                                                       // 0 without texture references.
+    GLuint textureReferenceTexture;
+public:
+    GLuint ID;
+    GLuint texture;
+
+    explicit DrawDataBuffer(int capacity, bool hasTextureReferences = false);
+
+    void update(const std::vector<InstanceData>& drawData);                                                              // Replaces the contents, slot i is drawData[i].
+
+    void updateTextureReferences(const std::vector<TextureReference>& textureReferences);                                // The same for the texture references, slot i is textureReferences[i].
+
+    void bind(GLuint textureUnit = drawDataTextureUnit);                                                                 // The program's drawData sampler has to be set to the same unit, drawTextureReferences to drawTextureReferencesTextureUnit.
+
+    void attach(GLuint VAO);                                                                                             // Adds the draw ID attribute to a VAO drawn with per-draw data.
+
+    int getCapacity() const { return capacity; }
+
+    void deleteDrawDataBuffer();
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <string>
+
+/* Frame profiler. Each ProfileZone measures the CPU time of its scope and, through a pair of GL_TIMESTAMP queries,
+the GPU time of the commands issued inside it. Query results are read back profilerFrameLatency frames later, so
+the profiler never waits for the GPU. Recorded zones are written as Chrome trace JSON (chrome://tracing, Perfetto).
+Only the last profilerTraceFrameCount frames are kept for the trace, so memory stays bounded in long sessions. */
+
+const int profilerFrameLatency = 4;
+const int profilerTraceFrameCount = 2000;                                                                                // About 30 s at 60 fps, a few MB of events.
+
+void initProfiler();
+
+bool isProfilerEnabled();
+
+void beginProfilerFrame();
+
+void endProfilerFrame();
+
+void addProfilerCounter(const char* name, double value);
+
+void writeChromeTrace(const std::string& tracePath);
+
+void deleteProfiler();
+
+class ProfileZone
+{
+private:
+    int zoneIndex;
+public:
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_ZONE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+
+#endif
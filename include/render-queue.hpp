@@ -0,0 +1,100 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "multi-draw.hpp"
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/* Collects a frame's draw calls, sorts them by a 64-bit key so that draws sharing a shader program, material and VAO
+end up next to each other, and then issues them skipping every bind that would not change anything.
+Opaque key:      | 0 | program 12 | material 16 | VAO 11 | depth 24 (front to back) |
+Translucent key: | 1 | depth 24 (back to front) | program 12 | material 16 | VAO 11 |
+With multi-draw enabled, neighbouring draws that also share the index type become one call: one
+glMultiDrawElementsIndirect per run when indirect draws are supported, else glMultiDrawElementsBaseVertex per run of
+single-instance draws with the same draw ID (see multi-draw.hpp). That fallback cannot tell merged draws apart in the
+shader (GLSL 330 has no gl_DrawID, and gl_InstanceID is 0 in every draw), so on plain 3.3 contexts draws with per-draw
+data, which have distinct draw IDs, are issued one call per draw. Draws whose materials differ only in their texture
+should share one material and name the texture in a TextureReference next to their per-draw data (a TextureArray
+layer, see texture-array.hpp), so the texture does not split the run. */
+
+struct RenderCommand
+{
+    GLuint shaderProgram;
+    GLuint VAO;
+    uint16_t material;                                                                                                   // Passed to the material binder when it changes, 0 means no material.
+    GLfloat depth;                                                                                                       // Normalized view depth in [0, 1], 0 is closest to the camera.
+    int elementsCount;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLintptr indexOffset = 0;                                                                                            // Byte offset of the first index in the VAO's element buffer.
+    GLint baseVertex = 0;
+    int instanceCount = 1;
+    GLuint drawId = 0;                                                                                                   // First DrawDataBuffer slot of the draw, for the DRAW_DATA shader variant. Also its base instance.
+    bool isTranslucent = false;
+};
+
+struct RenderQueueStats
+{
+    int drawCount = 0;
+    int drawCallCount = 0;                                                                                               // Lower than drawCount when draws were merged.
+    int programBindCount = 0;
+    int vertexArrayBindCount = 0;
+    int materialBindCount = 0;
+    int elidedBindCount = 0;
+};
+
+using MaterialBinder = std::function<void(GLuint shaderProgram, uint16_t material)>;
+
+class RenderQueue
+{
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t commandIndex;
+    };
+
+    std::vector<RenderCommand> commands;
+    std::vector<SortItem> sortItems;
+    std::vector<SortItem> sortScratch;
+    std::unordered_map<GLuint, uint32_t> programRanks;
+    std::unordered_map<GLuint, uint32_t> vertexArrayRanks;
+    MaterialBinder materialBinder;
+    RenderQueueStats stats;
+    bool isMultiDrawEnabled = false;
+    bool isIndirect = false;
+    GLuint indirectBuffer = 0;
+    GLsizeiptr indirectBufferSize = 0;
+    GLuint constantDrawId = 0;
+    std::vector<DrawElementsIndirectCommand> indirectCommands;
+    std::vector<GLsizei> multiDrawCounts;
+    std::vector<const void*> multiDrawOffsets;
+    std::vector<GLint> multiDrawBaseVertices;
+
+    uint32_t getRank(std::unordered_map<GLuint, uint32_t>& ranks, GLuint name, uint32_t maxRank);
+    void sortCommands();
+    bool canMerge(const RenderCommand& first, const RenderCommand& command) const;
+    void uploadIndirectCommands();
+    void drawRun(size_t firstItem, size_t itemCount);
+public:
+    static uint64_t encodeSortKey(uint32_t programRank, uint16_t material, uint32_t vertexArrayRank, GLfloat depth, bool isTranslucent);
+
+    void setMaterialBinder(MaterialBinder binder) { materialBinder = std::move(binder); }
+
+    void setMultiDrawEnabled(bool isEnabled);
+
+    void submit(const RenderCommand& command);
+
+    void execute();
+
+    void clear();
+
+    const RenderQueueStats& getStats() const { return stats; }
+
+    bool isIndirectDrawing() const { return isIndirect; }
+
+    void deleteRenderQueue();
+};
+
+#endif
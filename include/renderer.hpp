@@ -1,5 +1,10 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
 #include "geometry/vertex-utils.hpp"
-#include <glfw/glfw3.h>
+#include "geometry/matrix-utils.hpp"
+#include "stream-buffer.hpp"
+#include <GLFW/glfw3.h>
 #include <vector>
 #include <cstdlib>
 
@@ -14,9 +19,11 @@ public:
     GLuint* boundVAO;
     GLuint* boundVBO;
     GLuint* boundEBO;
+    GLenum indexType;                                                                                                    // GL_UNSIGNED_SHORT for meshes of up to 65536 vertices, else GL_UNSIGNED_INT.
 
     VertexArrayData(int VAOCount, int VBOCount, int EBOCount)
     {
+        indexType = GL_UNSIGNED_INT;
         boundVAOCount = VAOCount;                                                                                        // A Vertex Array Object (or VAO) is an object that describes how the vertex attributes are stored in a Vertex Buffer Object (or VBO).
         boundVBOCount = VBOCount;                                                                                        // Vertex buffer object provides methods for uploading vertex data (position, normal vector, color, etc.).
         boundEBOCount = EBOCount;                                                                                        // Element buffer object allows to reuse vertex data without duplicating all attributes values.
@@ -39,10 +46,81 @@ public:
     }
 };
 
-VertexArrayData getVertexArrayData(std::vector<Vertex> vertices, std::vector<GLuint> indices);
+struct InstanceData                                                                                                     // Per-instance attributes, read once per instance instead of once per vertex (see the INSTANCED variant of vertexShader.glsl).
+{
+    Matrix4 model;
+    Color color;
+};
+
+struct TextureReference                                                                                                  // What the TEXTURE_ARRAY variants sample: a layer of the array bound to albedoArray, or of the array behind a bindless handle.
+{                                                                                                                        // A stream of its own next to InstanceData, so untextured draws do not carry it.
+    GLuint handle[2] = {};                                                                                               // Bindless handle, low half first as GLSL's uvec2 to sampler conversion expects. 0 uses the bound array.
+    GLfloat layer = 0.0f;
+    GLfloat padding = 0.0f;                                                                                              // One RGBA32UI texel in draw data.
+};
+
+inline TextureReference getTextureReference(GLuint64 bindlessHandle, int layer)
+{
+    TextureReference reference;
+    reference.handle[0] = (GLuint)(bindlessHandle & 0xFFFFFFFF);
+    reference.handle[1] = (GLuint)(bindlessHandle >> 32);
+    reference.layer = (GLfloat)layer;
+    return reference;
+}
+
+const GLuint instanceAttributeLocation = 4;                                                                              // First location after the Vertex attributes: model matrix columns take 4..7, color takes 8.
+const GLuint instanceTextureAttributeLocation = 10;                                                                      // TextureReference: bindless handle at 10 and layer at 11, after the draw ID (9).
+
+struct InstanceBuffer
+{
+    GLuint VBO;
+    int capacity;
+    GLuint textureVBO = 0;                                                                                               // TextureReference per instance, only for VAOs drawn with the TEXTURE_ARRAY variants.
+};
+
+void enableVertexLayout(const VertexAttribute* attributes, int attributeCount, GLsizei stride);                         // Sets up the attributes for the buffer bound to GL_ARRAY_BUFFER in the bound VAO.
+
+template<class VertexType>
+void enableVertexLayout()
+{
+    static_assert(isVertexLayoutValid<VertexType>(), "invalid vertex layout");
+    enableVertexLayout(VertexLayout<VertexType>::attributes, getVertexAttributeCount<VertexType>(), sizeof(VertexType));
+}
 
-void draw(GLuint shaderProgram, GLuint VAO, int ElementsCount);
+GLenum getIndexType(size_t vertexCount);
+
+GLsizeiptr getIndexSize(GLenum indexType);
+
+GLenum uploadIndices(const std::vector<GLuint>& indices, size_t vertexCount);                                           // Fills the bound GL_ELEMENT_ARRAY_BUFFER with the smallest index type that fits, returns that type.
+
+VertexArrayData createVertexArrayData(const void* vertices, size_t vertexCount, size_t verticesSize, const std::vector<GLuint>& indices,
+                                      const VertexAttribute* attributes, int attributeCount, GLsizei stride);
+
+template<class VertexType>
+VertexArrayData getVertexArrayData(const std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)       // Works for any vertex struct with a VertexLayout specialization.
+{
+    static_assert(isVertexLayoutValid<VertexType>(), "invalid vertex layout");
+    return createVertexArrayData(vertices.data(), vertices.size(), vertices.size() * sizeof(VertexType), indices,
+                                 VertexLayout<VertexType>::attributes, getVertexAttributeCount<VertexType>(), sizeof(VertexType));
+}
+
+InstanceBuffer getInstanceBuffer(const VertexArrayData& vertexArrayData, int capacity, bool hasTextureReferences = false);
+
+void draw(GLuint shaderProgram, GLuint VAO, int ElementsCount, GLenum indexType);
+
+void drawInstanced(GLuint shaderProgram, GLuint VAO, int ElementsCount, GLenum indexType, const InstanceBuffer& instanceBuffer, const std::vector<InstanceData>& instances,
+                   const std::vector<TextureReference>& textureReferences = {});                                         // textureReferences[i] for instances[i], when the buffer has them.
+
+GLuint createStreamVertexArray(const StreamBuffer& vertexBuffer, const StreamBuffer& indexBuffer);
+
+void drawStream(GLuint shaderProgram, GLuint VAO, const StreamAllocation& vertices, const StreamAllocation& indices, int ElementsCount);
+
+void cleanVertexArrayData(VertexArrayData vertexArrayData);
+
+void cleanInstanceBuffer(InstanceBuffer instanceBuffer);
 
 void cleanGlResources(VertexArrayData vertexArrayData, GLuint shaderProgram);
 
-void clearAllBuffers();
\ No newline at end of file
+void clearAllBuffers();
+
+#endif
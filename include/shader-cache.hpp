@@ -0,0 +1,30 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "shader-program.hpp"
+
+/* On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary). Entries live in
+resources/shader-cache and are keyed by a hash of the shader sources together with the GL vendor, renderer and version
+strings, so a driver update or a GPU switch never loads a stale binary. Drivers may still reject a binary (e.g. after
+a driver-internal change); the program is then compiled from source and the entry is rewritten. */
+
+struct ShaderCacheStats
+{
+    int hitCount = 0;
+    int missCount = 0;
+    int rejectedCount = 0;                                                                                               // Entries found on disk but refused by glProgramBinary.
+};
+
+bool isShaderCacheSupported();                                                                                           // GL_ARB_get_program_binary with at least one binary format.
+
+uint64_t getShaderCacheKey(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource);
+
+GLuint loadProgramBinary(uint64_t cacheKey);                                                                             // A linked program, or 0 when there is no usable entry.
+
+void saveProgramBinary(GLuint shaderProgram, uint64_t cacheKey);
+
+GLuint createCachedShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource);       // createShaderProgram() that tries the cache first and fills it on a miss.
+
+const ShaderCacheStats& getShaderCacheStats();
+
+#endif
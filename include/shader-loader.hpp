@@ -0,0 +1,53 @@
+#ifndef SHADER_LOADER_H
+#define SHADER_LOADER_H
+
+#include "shader-preprocessor.hpp"
+#include <string>
+#include <vector>
+
+/* Asynchronous shader program loading. load() only submits the compile and link of a program (or loads it from the
+shader cache) and returns a handle; poll() later picks up every program the driver has finished, so with
+GL_KHR_parallel_shader_compile dozens of programs compile on driver threads at once instead of one after another.
+Without the extension the programs are still all submitted first, and the first poll() waits for them. */
+
+typedef int ShaderProgramHandle;
+
+enum ShaderLoadState { shaderLoadPending, shaderLoadReady, shaderLoadFailed };
+
+class ShaderLoader
+{
+private:
+    struct LoadingProgram
+    {
+        ShaderLoadState state;
+        ShaderProgramBuild build;
+        uint64_t cacheKey;
+        ShaderProgram* program;
+    };
+
+    std::vector<LoadingProgram> programs;
+    int pendingCount = 0;
+
+    void finish(LoadingProgram& loadingProgram);
+public:
+    ShaderLoader();
+
+    ShaderProgramHandle load(const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+                             const ShaderDefines& defines = {});
+
+    void poll();                                                                                                         // Finishes every program whose build completed, call once per frame while loading.
+
+    void wait(ShaderProgramHandle handle);                                                                               // Blocks until the program is ready or failed.
+
+    void waitAll();
+
+    ShaderLoadState getState(ShaderProgramHandle handle) const { return programs[handle].state; }
+
+    ShaderProgram* getProgram(ShaderProgramHandle handle) const { return programs[handle].program; }                    // nullptr until the program is ready.
+
+    int getPendingCount() const { return pendingCount; }
+
+    void deleteShaderLoader();                                                                                           // Deletes every program created through the loader.
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include "shader-program.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* GLSL preprocessing before glShaderSource: resolves #include "file" relative to the including file (with #pragma once),
+and injects #defines right after #version (at the top without one), so one source file yields specialized variants
+(e.g. INSTANCED) without dynamic branches. #line directives keep compiler errors pointing at the right line; drivers
+that print the source string number report the index of the file in the dependency list (0 is the top-level file).
+The result references the memory-mapped files in place, only replaced directives are generated text. */
+
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;                                                                                                   // Empty for a plain #define NAME.
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+std::string getPermutationKey(const ShaderDefines& defines);                                                             // Order-independent, "A;B=2" for { B=2, A }.
+
+bool preprocessShader(const std::string& shaderAbsolutePath, const ShaderDefines& defines, ShaderSource& result,
+                      std::vector<std::string>* dependencies = nullptr);                                                 // dependencies receives every file read, the top-level one first.
+
+class ShaderVariantCache                                                                                                 // Programs per (vertex shader, fragment shader, permutation), compiled the first time they are asked for.
+{
+private:
+    std::unordered_map<std::string, ShaderProgram*> variants;
+public:
+    ShaderProgram* getVariant(const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+                              const ShaderDefines& defines = {});                                                        // nullptr when the variant fails to build, which is memoized too.
+
+    int getVariantCount() const { return variants.size(); }
+
+    void deleteShaderVariants();
+};
+
+#endif
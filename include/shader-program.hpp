@@ -1,18 +1,96 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include "geometry/matrix-utils.hpp"
+#include "mapped-file.hpp"
 #include <glad/glad.h>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <string>
+#include <vector>
+
+constexpr uint32_t hashUniformName(const char* name, uint32_t hash = 2166136261u)                                        // FNV-1a, constexpr so names known at compile time are hashed by the compiler.
+{
+    return *name == '\0' ? hash : hashUniformName(name + 1, (hash ^ (uint8_t)*name) * 16777619u);
+}
+
+struct UniformName                                                                                                       // Declare as static constexpr UniformName at the call site to keep hashing out of the frame loop.
+{
+    uint32_t hash;
+    const char* name;
+
+    constexpr UniformName(const char* name) : hash(hashUniformName(name)), name(name) {}
+};
+
+struct ShaderSource                                                                                                      // One stage's source as pointer + length pieces for glShaderSource: slices of memory-mapped files and generated lines.
+{
+    std::vector<const char*> strings;
+    std::vector<GLint> lengths;
+    std::vector<std::shared_ptr<MappedFile>> files;                                                                      // Keeps the sliced mappings alive until the source is handed to GL.
+    std::deque<std::string> generatedText;                                                                               // A deque, appending never moves text that strings already points to.
+
+    ShaderSource() = default;
+    explicit ShaderSource(const char* text);
+    ShaderSource(ShaderSource&&) = default;
+    ShaderSource& operator=(ShaderSource&&) = default;
+    ShaderSource(const ShaderSource&) = delete;
+
+    void append(const char* text, size_t length);                                                                        // Not copied, text has to outlive the source.
+    void appendGenerated(std::string text);
+    std::string toString() const;
+};
+
+struct ShaderProgramBuild                                                                                                // A program whose compile and link were submitted but whose status was not queried yet.
+{
+    GLuint program;
+    GLuint vertexShader;
+    GLuint fragmentShader;
+};
+
+ShaderProgramBuild submitShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource);
+
+bool isShaderProgramBuildComplete(const ShaderProgramBuild& build);                                                      // GL_COMPLETION_STATUS_KHR when available, querying it never waits for the driver.
+
+GLuint finishShaderProgram(const ShaderProgramBuild& build);                                                             // Reports errors and releases the shader objects, waits if the build is not complete.
+
+GLuint createShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource);
+
+GLuint createComputeShaderProgram(const ShaderSource& computeShaderSource);                                              // Needs GL_ARB_compute_shader, 0 on failure.
 
 class ShaderProgram
 {
+private:
+    struct Uniform
+    {
+        bool isUsed;
+        uint32_t hash;
+        std::string name;                                                                                                // Compared after the hash, names whose hashes collide do not alias.
+        GLint location;
+        GLenum type;
+        bool hasValue;
+        unsigned char value[sizeof(Matrix4)];                                                                            // Last value set through this program, big enough for a mat4.
+    };
+
+    std::vector<Uniform> uniforms;                                                                                       // Open addressing hash table probed by the name hash, its size is a power of two.
+
+    void introspectUniforms();
+    Uniform* findUniform(const UniformName& name);
+    Uniform* findChangedUniform(const UniformName& name, const void* value, size_t valueSize);
 public:
     unsigned int ID;
     ShaderProgram(const std::string &vertexShaderAbsolutePath, const std::string &fragmentShaderAbsolutePath);
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
+    explicit ShaderProgram(GLuint linkedProgram);                                                                        // Wraps a program that was already linked, e.g. by ShaderLoader.
+    void replaceProgram(GLuint linkedProgram);                                                                           // Swaps in a relinked program (hot reload) and deletes the old one, uniform values have to be set again.
+    bool hasUniform(const UniformName& name);
+    void setBool(const UniformName& name, bool value);
+    void setInt(const UniformName& name, int value);
+    void setFloat(const UniformName& name, float value);
+    void setVec2(const UniformName& name, float x, float y);
+    void setVec3(const UniformName& name, const Position& value);
+    void setVec4(const UniformName& name, const Color& value);
+    void setMat4(const UniformName& name, const Matrix4& value);
     void use();
 };
 
-#endif
\ No newline at end of file
+#endif
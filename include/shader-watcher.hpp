@@ -0,0 +1,58 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include "shader-preprocessor.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* Shader hot reload. Watches the resources/shaders directory of the SourceTree (inotify on Linux, modification
+times polled every shaderWatchPollInterval elsewhere) and rebuilds every watched program one of whose sources or
+#included files changed. Rebuilds are submitted like ShaderLoader does and picked up by a later update() once the
+driver finished them, so a reload never stalls a frame on compilation. The program ID is only swapped when the new
+program links; on errors the old program keeps running and the log is printed. */
+
+const std::chrono::milliseconds shaderWatchPollInterval(250);
+
+class ShaderWatcher
+{
+private:
+    struct WatchedProgram
+    {
+        ShaderProgram* program;
+        std::string vertexShaderPath;
+        std::string fragmentShaderPath;
+        ShaderDefines defines;
+        std::vector<std::string> dependencies;                                                                           // File names of both stages and everything they #include.
+        bool isChanged;
+        bool isBuilding;
+        ShaderProgramBuild build;
+        uint64_t cacheKey;
+        std::vector<long long> modificationTimes;                                                                        // Of dependencies, only used by the polling fallback.
+    };
+
+    std::string shadersDirectory;
+    std::vector<WatchedProgram> programs;
+    int inotifyDescriptor = -1;
+    std::chrono::steady_clock::time_point lastPollTime;
+    int reloadCount = 0;
+
+    bool preprocess(WatchedProgram& watchedProgram, ShaderSource& vertexShaderSource, ShaderSource& fragmentShaderSource);
+    static bool dependsOn(const WatchedProgram& watchedProgram, const std::string& fileName);
+    void readChanges();
+    void submitBuild(WatchedProgram& watchedProgram);
+    void finishBuild(WatchedProgram& watchedProgram);
+public:
+    ShaderWatcher();
+
+    void watch(ShaderProgram* program, const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+               const ShaderDefines& defines = {});
+
+    void update();                                                                                                       // Call once per frame, costs a non-blocking read when nothing changed.
+
+    int getReloadCount() const { return reloadCount; }
+
+    void deleteShaderWatcher();                                                                                          // Stops watching, the watched programs stay alive.
+};
+
+#endif
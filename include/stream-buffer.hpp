@@ -0,0 +1,57 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <vector>
+
+/* Buffer for data that is rewritten every frame (particles, trails, debug lines, per-frame uniforms).
+With GL_ARB_buffer_storage the buffer is split into streamBufferRegionCount regions that stay persistently mapped:
+the CPU writes region N while the GPU still reads regions N-1 and N-2, and a fence per region makes sure a region is
+only reused once the GPU is done with it. Without the extension (plain 3.3 contexts) data is staged on the CPU and
+uploaded with glBufferSubData into a buffer that is orphaned every frame, so the driver never has to sync either. */
+
+const int streamBufferRegionCount = 3;
+
+struct StreamAllocation
+{
+    void* data;                                                                                                          // Where to write, nullptr when the allocation did not fit into the frame's region.
+    GLintptr offset;                                                                                                     // Offset in the GL buffer to pass to draw calls / glBindBufferRange.
+    GLsizeiptr size;
+};
+
+class StreamBuffer
+{
+private:
+    GLenum target;
+    GLsizeiptr regionSize;
+    GLsizeiptr regionUsedSize = 0;
+    GLsizeiptr regionFlushedSize = 0;
+    int regionIndex = 0;
+    bool isPersistent;
+    char* mappedData = nullptr;
+    std::vector<char> stagingData;
+    GLsync regionFences[streamBufferRegionCount] = {};
+    int stallCount = 0;
+
+    void waitForRegion(int region);
+public:
+    GLuint ID;
+
+    StreamBuffer(GLenum target, GLsizeiptr regionSize);
+
+    StreamAllocation allocate(GLsizeiptr size, GLsizeiptr alignment = 4);
+
+    void flush();
+
+    void endFrame();
+
+    bool isPersistentlyMapped() const { return isPersistent; }
+
+    GLsizeiptr getRegionSize() const { return regionSize; }
+
+    int getStallCount() const { return stallCount; }
+
+    void deleteStreamBuffer();
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include "block-compression.hpp"
+#include "renderer.hpp"
+#include <string>
+#include <vector>
+
+/* Textures of one size and format packed into the layers of a GL_TEXTURE_2D_ARRAY, so materials that differ only in
+their texture can share one binding: every draw names its layer in a TextureReference next to its InstanceData, and
+the render queue merges draws with different textures into one instanced or multi-draw call instead of breaking the
+run for every texture bind. The TEXTURE_ARRAY shader variants sample albedoArray at that layer. With
+GL_ARB_bindless_texture the array also gets a resident bindless handle that getReference() puts into the reference,
+and the BINDLESS_TEXTURE variants sample through it: then even draws using different arrays (other sizes or formats)
+merge, no array has to be bound. Layers are allocated up front (layerCapacity) with the full mip chain, and a
+format the context cannot sample is stored as RGBA8, decoded on the CPU, like loadKtx2Texture does. */
+
+bool isBindlessTextureSupported();
+
+class TextureArray
+{
+private:
+    int width;
+    int height;
+    int levelCount;
+    int layerCapacity;
+    int layerCount = 0;
+    BlockFormat format;                                                                                                  // Of the levels addLayer takes.
+    BlockFormat storageFormat;                                                                                           // format, or RGBA8 when the context cannot sample it.
+    GLuint64 bindlessHandle = 0;
+
+    bool canAddLayer(int layerWidth, int layerHeight, int layerLevelCount) const;
+    bool uploadLevel(int layer, int level, int levelWidth, int levelHeight, const unsigned char* data, size_t size);     // data in format, decoded first when stored as RGBA8.
+public:
+    GLuint ID;
+
+    TextureArray(int width, int height, BlockFormat format, int layerCapacity);                                          // layerCapacity above GL_MAX_ARRAY_TEXTURE_LAYERS is clamped to it, with an error.
+
+    int addLayer(const std::vector<ImageLevel>& levels);                                                                 // Full mip chain in format. The new layer, -1 (and an error) when full or of another size.
+
+    int loadLayer(const std::string& absolutePath);                                                                      // KTX2 in format straight from the file mapping, or a JPEG/PNG, decoded and compressed to format here.
+
+    TextureReference getReference(int layer) const;
+
+    void bind(GLuint textureUnit);                                                                                       // For the albedoArray sampler, not needed by draws whose reference has a bindless handle.
+
+    int getLayerCount() const { return layerCount; }
+
+    int getLayerCapacity() const { return layerCapacity; }
+
+    int getWidth() const { return width; }
+
+    int getHeight() const { return height; }
+
+    BlockFormat getFormat() const { return format; }
+
+    void deleteTextureArray();
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include "block-compression.hpp"
+#include "stream-buffer.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Asynchronous texture loading with mip streaming. load() only queues the file and returns a handle: worker threads
+decode it and build the mip chain, and update() (once per frame on the render thread) uploads what they finished
+through a pixel unpack buffer, at most uploadBytesPerFrame per frame, so neither decoding nor a large glTexImage2D
+ever lands on a single frame. Mips stream in from the smallest: the levels of up to textureTailSize texels come in
+at once, then every larger level, row slices at a time. The GL texture only holds the resident levels: the rows of
+a new largest level go into a new texture with one more level that is not drawn with yet, so writing them never
+waits for draws, and once the level is complete the other levels are copied over on the GPU (glCopyImageSubData,
+or blits without GL_ARB_copy_image) and the new texture replaces the old one. Growing the levels of the drawn
+texture in place would make the driver reallocate it behind our back, or wait for the draws using it. Resident
+levels are kept under memoryBudget by dropping the largest levels of the least recently bound textures; a texture
+that lost levels or could not fit is decoded again once there is room. Until its tail arrives a texture binds as
+1x1 white. KTX2 files (see ktx2-file.hpp) are not decoded: their levels are read as they are and stay
+block-compressed on the GPU, streamed in rows of blocks. They need the full mip chain, and are decoded to RGBA8 when
+the context cannot sample their format or lacks GL_ARB_copy_image (blits cannot copy compressed levels). */
+
+typedef int TextureHandle;
+
+enum TextureLoadState { textureLoadPending, textureLoadReady, textureLoadFailed };
+
+const int textureTailSize = 64;                                                                                          // Levels up to this size are uploaded together and never evicted.
+
+struct TextureManagerStats
+{
+    int decodedCount = 0;
+    int uploadedLevelCount = 0;
+    int evictedLevelCount = 0;
+    GLsizeiptr uploadedBytes = 0;
+};
+
+class TextureManager
+{
+private:
+    struct DecodeJob
+    {
+        TextureHandle handle;
+        std::string path;
+    };
+
+    struct DecodeResult
+    {
+        TextureHandle handle;
+        bool isDecoded;
+        BlockFormat format;
+        std::vector<ImageLevel> levels;
+    };
+
+    struct Texture
+    {
+        std::string path;
+        TextureLoadState state = textureLoadPending;
+        GLuint ID = 0;                                                                                                   // 0 until the tail is uploaded.
+        GLuint streamingID = 0;                                                                                          // Texture starting at residentLevel - 1 while that level streams in.
+        int storageLevel = 0;                                                                                            // Level of the mip chain at level 0 of the GL texture.
+        int levelCount = 0;                                                                                              // 0 until the first decode.
+        int tailLevel = 0;                                                                                               // Largest level of the tail.
+        int residentLevel = 0;                                                                                           // Largest complete level, levelCount while nothing is resident.
+        int uploadedRowCount = 0;                                                                                        // Of the level in streamingID, in rows of blocks.
+        bool isDecoding = false;
+        BlockFormat format = blockFormatRGBA8;
+        std::vector<ImageLevel> levels;                                                                                  // Decoded levels not uploaded yet (in format), the others have empty pixels.
+        uint64_t lastUsedFrame = 0;
+    };
+
+    std::vector<Texture> textures;
+    std::vector<std::thread> workers;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<DecodeJob> decodeJobs;
+    std::vector<DecodeResult> decodeResults;
+    bool isStopping = false;
+    StreamBuffer uploadBuffer;
+    GLsizeiptr memoryBudget;
+    GLsizeiptr residentBytes = 0;
+    uint64_t frameIndex = 1;
+    GLuint placeholderTexture;
+    GLuint copyFramebuffers[2] = {};                                                                                     // Read and draw, only without GL_ARB_copy_image.
+    TextureManagerStats stats;
+
+    void runWorker();
+    void submitDecode(TextureHandle handle);
+    void onDecoded(DecodeResult& result);
+    GLsizeiptr getLevelSize(const Texture& texture, int level) const;
+    GLsizeiptr getStorageSize(const Texture& texture) const;
+    bool isLevelDecoded(const Texture& texture, int level) const;
+    bool isStreaming(const Texture& texture) const;                                                                       // Has levels left to upload.
+    void uploadTail(Texture& texture, GLsizeiptr& frameBytes);
+    bool uploadRows(Texture& texture, GLsizeiptr& frameBytes);                                                           // Continues the next level, true once the frame has no budget left.
+    GLsizeiptr getEvictableSize(uint64_t usedBeforeFrame) const;
+    bool makeRoom(GLsizeiptr size, uint64_t usedBeforeFrame);                                                            // Evicts levels of textures last bound before usedBeforeFrame, least recently bound first.
+    void evictLevel(Texture& texture);
+    GLuint createStorage(const Texture& texture, int firstLevel);                                                        // Levels firstLevel.. of the mip chain, unfilled.
+    void replaceStorage(Texture& texture, GLuint newID, int newStorageLevel);                                            // Copies the resident levels newID covers into it and deletes the old texture.
+    void copyLevel(GLuint source, int sourceLevel, GLuint target, int targetLevel, int width, int height);
+public:
+    TextureManager(int workerCount, GLsizeiptr memoryBudget, GLsizeiptr uploadBytesPerFrame = 4 << 20);
+
+    TextureHandle load(const std::string& absolutePath);
+
+    void update();                                                                                                       // Picks up decoded images and streams levels, call once per frame.
+
+    void bind(TextureHandle handle, GLuint textureUnit);                                                                 // Also marks the texture as used this frame, which keeps its levels resident longest.
+
+    TextureLoadState getState(TextureHandle handle) const { return textures[handle].state; }
+
+    int getResidentLevel(TextureHandle handle) const { return textures[handle].residentLevel; }                          // 0 once fully streamed in.
+
+    bool isIdle();                                                                                                       // Nothing is decoding or waiting for upload (textures that do not fit the budget may still be incomplete).
+
+    void setMemoryBudget(GLsizeiptr newMemoryBudget);                                                                    // Takes effect on the next update().
+
+    GLsizeiptr getResidentBytes() const { return residentBytes; }
+
+    GLsizeiptr getMemoryBudget() const { return memoryBudget; }
+
+    const TextureManagerStats& getStats() const { return stats; }
+
+    void deleteTextureManager();                                                                                         // Stops the workers and deletes every texture.
+};
+
+#endif
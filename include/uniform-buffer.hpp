@@ -0,0 +1,101 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include "geometry/matrix-utils.hpp"
+#include "stream-buffer.hpp"
+#include <cstddef>
+#include <vector>
+
+/* Uniform buffer objects with std140 layout. Every block is a plain C++ struct whose layout is checked at compile time
+against the std140 rules (STD140_OFFSET / STD140_SIZE), and has a matching GLSL block with the same member order in
+the shaders. Block names are bound to fixed binding points when a program is linked (GLSL 330 has no layout(binding)),
+so data is attached with one glBindBufferRange instead of one glUniform call per member per draw. */
+
+#define STD140_OFFSET(block, member, offset) \
+    static_assert(offsetof(block, member) == (offset), #block "::" #member " does not match its std140 offset " #offset)
+#define STD140_SIZE(block, size) \
+    static_assert(sizeof(block) == (size) && sizeof(block) % 16 == 0, #block " does not match its std140 size " #size)
+
+enum UniformBlockBinding { frameUniformBinding = 0, materialUniformBinding = 1, uniformBlockBindingCount };
+
+struct FrameUniforms                                                                                                     // Mirrors FrameUniforms in resources/shaders/uniform-blocks.glsl, bound once per frame.
+{
+    Matrix4 view;
+    Matrix4 projection;
+    Matrix4 viewProjection;
+    GLfloat viewport[4];                                                                                                 // x, y, width, height in pixels.
+    GLfloat time;
+    GLfloat deltaTime;
+    GLfloat padding[2];
+};
+STD140_OFFSET(FrameUniforms, view, 0);
+STD140_OFFSET(FrameUniforms, projection, 64);
+STD140_OFFSET(FrameUniforms, viewProjection, 128);
+STD140_OFFSET(FrameUniforms, viewport, 192);
+STD140_OFFSET(FrameUniforms, time, 208);
+STD140_OFFSET(FrameUniforms, deltaTime, 212);
+STD140_SIZE(FrameUniforms, 224);
+
+struct MaterialUniforms                                                                                                  // Mirrors MaterialUniforms in resources/shaders/uniform-blocks.glsl, bound per material.
+{
+    Color color;
+    GLfloat parameters[4];                                                                                               // Free for the material's shader to interpret.
+};
+STD140_OFFSET(MaterialUniforms, color, 0);
+STD140_OFFSET(MaterialUniforms, parameters, 16);
+STD140_SIZE(MaterialUniforms, 32);
+
+FrameUniforms getFrameUniforms(const Matrix4& view, const Matrix4& projection, int width, int height, GLfloat time, GLfloat deltaTime);
+
+const char* getUniformBlockName(UniformBlockBinding binding);
+
+void bindUniformBlocks(GLuint shaderProgram);                                                                            // Assigns every known block of the program its binding point, called after linking.
+
+bool validateUniformBlock(GLuint shaderProgram, UniformBlockBinding binding, GLsizeiptr expectedSize);                  // Compares the linked block size with the C++ struct, false (and an error) on mismatch.
+
+GLsizeiptr getUniformBufferAlignment();                                                                                  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the granularity of glBindBufferRange offsets.
+
+class FrameUniformBuffer                                                                                                 // Per-frame block written into a stream buffer, a fresh range every frame so the GPU is never waited on.
+{
+private:
+    StreamBuffer streamBuffer;
+public:
+    FrameUniformBuffer();
+
+    void update(const FrameUniforms& frameUniforms);                                                                     // Writes and binds the frame's block, call once per frame before drawing.
+
+    void endFrame() { streamBuffer.endFrame(); }
+
+    void deleteFrameUniformBuffer() { streamBuffer.deleteStreamBuffer(); }
+};
+
+typedef int UniformBlockHandle;
+
+const UniformBlockHandle invalidUniformBlock = -1;
+
+class UniformBlockArena                                                                                                  // One large uniform buffer split into equally sized, aligned slots, e.g. one per material.
+{
+private:
+    GLsizeiptr blockSize;
+    GLsizeiptr slotSize;
+    int capacity;
+    std::vector<UniformBlockHandle> freeSlots;
+public:
+    GLuint ID;
+
+    UniformBlockArena(GLsizeiptr blockSize, int capacity);
+
+    UniformBlockHandle allocate(const void* data);
+
+    void update(UniformBlockHandle handle, const void* data);
+
+    void release(UniformBlockHandle handle);
+
+    void bind(UniformBlockHandle handle, UniformBlockBinding binding);
+
+    int getCapacity() const { return capacity; }
+
+    void deleteUniformBlockArena();
+};
+
+#endif
@@ -0,0 +1,89 @@
+#version 330 core
+#extension GL_ARB_compute_shader : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require   // binding = on the buffer blocks
+// GPU culling for CullingPass: one invocation per instance tests its bounding sphere against the frustum and the
+// previous frame's Hi-Z depth pyramid, and appends the survivors to their mesh's range of the draw data buffer.
+layout (local_size_x = 64) in;
+
+struct InstanceData                           // Mirrors InstanceData in renderer.hpp
+{
+   mat4 model;
+   vec4 color;
+};
+
+struct DrawElementsIndirectCommand            // Mirrors DrawElementsIndirectCommand in multi-draw.hpp
+{
+   uint count;
+   uint instanceCount;
+   uint firstIndex;
+   int baseVertex;
+   uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer BoundingSpheres { vec4 boundingSpheres[]; }; // xyz center, w radius, world space
+layout (std430, binding = 1) readonly buffer MeshIndices { uint meshIndices[]; };
+layout (std430, binding = 2) readonly buffer Instances { InstanceData instances[]; };
+layout (std430, binding = 3) writeonly buffer VisibleInstances { InstanceData visibleInstances[]; };
+layout (std430, binding = 4) buffer DrawCommands { DrawElementsIndirectCommand drawCommands[]; }; // One per mesh, instanceCount starts at 0
+
+uniform int instanceCount;
+uniform mat4 viewProjection;
+uniform bool isOcclusionCulled;
+uniform mat4 occlusionViewProjection;         // The camera the depth pyramid was rendered with
+uniform sampler2D depthPyramid;
+uniform int depthPyramidLevelCount;
+
+bool isInFrustum(vec4 sphere)
+{
+   mat4 m = transpose(viewProjection);        // Rows of the matrix, the planes are sums and differences of them (Gribb & Hartmann)
+   vec4 planes[6] = vec4[6](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2]);
+   for (int i = 0; i < 6; i++)
+      if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w * length(planes[i].xyz))
+         return false;
+   return true;
+}
+
+bool isOccluded(vec4 sphere)
+{
+   vec2 uvMin = vec2(1.0), uvMax = vec2(0.0);
+   float nearestDepth = 1.0;
+   for (int i = 0; i < 8; i++) {              // Screen rectangle and nearest depth of the sphere's bounding box
+      vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) * 2 - 1, (i & 2) - 1, ((i >> 1) & 2) - 1);
+      vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+      if (clip.w <= 0.0)
+         return false;                        // Crosses the camera plane, the rectangle is unbounded
+      vec3 ndc = clip.xyz / clip.w;
+      uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+      uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+      nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+   }
+
+   ivec2 size = textureSize(depthPyramid, 0);
+   ivec2 pixelMin = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);
+   ivec2 pixelMax = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);
+   ivec2 extent = pixelMax - pixelMin + 1;
+   int level = min(int(ceil(log2(float(max(extent.x, extent.y))))), depthPyramidLevelCount - 1); // Coarsest level where the rectangle spans at most 2x2 texels
+   ivec2 levelSize = max(size >> level, ivec2(1));
+   ivec2 texelMin = min(pixelMin >> level, levelSize - 1);    // Texel j of level L covers pixels j << L up to ((j + 1) << L) - 1, the last one also the rest
+   ivec2 texelMax = min(pixelMax >> level, levelSize - 1);
+   float farthestDepth = 0.0;
+   for (int y = texelMin.y; y <= texelMax.y; y++)
+      for (int x = texelMin.x; x <= texelMax.x; x++)
+         farthestDepth = max(farthestDepth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+   return nearestDepth > farthestDepth;
+}
+
+void main()
+{
+   int instance = int(gl_GlobalInvocationID.x);
+   if (instance >= instanceCount)
+      return;
+   vec4 sphere = boundingSpheres[instance];
+   if (!isInFrustum(sphere) || (isOcclusionCulled && isOccluded(sphere)))
+      return;
+
+   uint mesh = meshIndices[instance];
+   uint slot = atomicAdd(drawCommands[mesh].instanceCount, 1u);
+   visibleInstances[drawCommands[mesh].baseInstance + slot] = instances[instance];
+}
@@ -0,0 +1,26 @@
+#version 330 core
+// One level of the Hi-Z depth pyramid (DepthPyramid): every texel keeps the farthest depth of the texels it covers.
+
+uniform sampler2D sourceDepth;                // The depth texture, or the pyramid with its base level set to the previous level
+uniform bool isCopy;                          // Level 0: copies the depth texture texel by texel
+
+out float reducedDepth;
+
+void main()
+{
+   ivec2 texel = ivec2(gl_FragCoord.xy);
+   if (isCopy) {
+      reducedDepth = texelFetch(sourceDepth, texel, 0).r;
+      return;
+   }
+
+   ivec2 sourceSize = textureSize(sourceDepth, 0);
+   ivec2 levelSize = max(sourceSize / 2, ivec2(1));
+   ivec2 first = texel * 2;
+   ivec2 last = min(first + 1 + ivec2(equal(texel, levelSize - 1)) * (sourceSize & 1), sourceSize - 1); // The last texel of an odd row or column also takes the leftover one
+   float depth = 0.0;
+   for (int y = first.y; y <= last.y; y++)
+      for (int x = first.x; x <= last.x; x++)
+         depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), 0).r);
+   reducedDepth = depth;
+}
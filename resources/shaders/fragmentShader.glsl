@@ -1,11 +1,39 @@
 #version 330 core
+#ifdef BINDLESS_TEXTURE
+#extension GL_ARB_bindless_texture : require
+#endif
+#if defined(TEXTURE_ARRAY) && !defined(TEXTURED)
+#define TEXTURED
+#endif
 out vec4 FragColor;
 
 in vec4 outColor;
-uniform float uniformColor; // we set this variable in the OpenGL code.
+#ifdef TEXTURED
+in vec2 outUV;
+#endif
+#ifdef TEXTURE_ARRAY
+flat in uvec2 outTextureHandle;               // TextureReference of the draw
+flat in float outTextureLayer;
+uniform sampler2DArray albedoArray;           // Used when the handle is 0
+#elif defined(TEXTURED)
+uniform sampler2D albedo;
+#endif
+
+#include "uniform-blocks.glsl"
 
 void main()
 {
-   float sin = sin(uniformColor) / 2.0f + 0.5f;
-   FragColor = vec4(outColor.r * (1.0f - sin), outColor.g * 0.5f * sin, outColor.b * sin, outColor.a);
+   float sin = sin(time) / 2.0f + 0.5f;
+   FragColor = vec4(outColor.r * (1.0f - sin), outColor.g * 0.5f * sin, outColor.b * sin, outColor.a) * materialColor;
+#ifdef TEXTURE_ARRAY
+   vec3 coordinates = vec3(outUV, outTextureLayer);
+#ifdef BINDLESS_TEXTURE
+   if (outTextureHandle != uvec2(0u))
+      FragColor *= texture(sampler2DArray(outTextureHandle), coordinates);
+   else
+#endif
+      FragColor *= texture(albedoArray, coordinates);
+#elif defined(TEXTURED)
+   FragColor *= texture(albedo, outUV);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+// Uniform blocks shared by all shaders, mirrored by the std140 structs in uniform-buffer.hpp: members have to stay in the same order.
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewport;
+    float time;
+    float deltaTime;
+};
+
+layout (std140) uniform MaterialUniforms
+{
+    vec4 materialColor;
+    vec4 materialParameters;
+};
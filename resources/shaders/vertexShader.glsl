@@ -1,11 +1,74 @@
 #version 330 core
+#ifdef BINDLESS_TEXTURE
+#extension GL_ARB_bindless_texture : require
+#endif
+#if defined(TEXTURE_ARRAY) && !defined(TEXTURED)
+#define TEXTURED
+#endif
 layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec4 aColor;
+#ifdef TEXTURED
+layout (location = 2) in vec2 aUV;
+#endif
+#ifdef INSTANCED
+layout (location = 4) in mat4 aModel;         // per instance, locations 4..7
+layout (location = 8) in vec4 aInstanceColor; // per instance
+#ifdef TEXTURE_ARRAY
+layout (location = 10) in uvec2 aInstanceTextureHandle; // per instance, TextureReference stream
+layout (location = 11) in float aInstanceTextureLayer;
+#endif
+#endif
+#ifdef DRAW_DATA
+layout (location = 9) in uint aDrawId;        // per draw, see multi-draw.hpp
+uniform samplerBuffer drawData;               // InstanceData per slot: model matrix columns, then color
+#ifdef TEXTURE_ARRAY
+uniform usamplerBuffer drawTextureReferences; // TextureReference per slot: bindless handle, layer bits
+#endif
+#endif
+#ifdef QUANTIZED_POSITION
+uniform vec3 positionScale;                   // 16-bit unorm positions relative to the mesh bounds (PackedVertex)
+uniform vec3 positionOffset;
+#endif
 
 out vec4 outColor;
+#ifdef TEXTURED
+out vec2 outUV;
+#endif
+#ifdef TEXTURE_ARRAY
+flat out uvec2 outTextureHandle;
+flat out float outTextureLayer;
+#endif
+
+#include "uniform-blocks.glsl"
 
 void main()
 {
+   vec3 position = aPosition;
+#ifdef TEXTURED
+   outUV = aUV;
+#endif
+#ifdef QUANTIZED_POSITION
+   position = position * positionScale + positionOffset;
+#endif
+#ifdef INSTANCED
+   outColor = aColor * aInstanceColor;
+   gl_Position = aModel * vec4(position, 1.0);
+#ifdef TEXTURE_ARRAY
+   outTextureHandle = aInstanceTextureHandle;
+   outTextureLayer = aInstanceTextureLayer;
+#endif
+#elif defined(DRAW_DATA)
+   int slot = (int(aDrawId) + gl_InstanceID) * 5;
+   mat4 model = mat4(texelFetch(drawData, slot), texelFetch(drawData, slot + 1), texelFetch(drawData, slot + 2), texelFetch(drawData, slot + 3));
+   outColor = aColor * texelFetch(drawData, slot + 4);
+   gl_Position = viewProjection * model * vec4(position, 1.0);
+#ifdef TEXTURE_ARRAY
+   uvec4 textureReference = texelFetch(drawTextureReferences, int(aDrawId) + gl_InstanceID);
+   outTextureHandle = textureReference.xy;
+   outTextureLayer = uintBitsToFloat(textureReference.z);
+#endif
+#else
    outColor = aColor;
-   gl_Position = vec4(aPosition.x, aPosition.y, aPosition.z, 1.0);
+   gl_Position = vec4(position, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,458 @@
+#include "block-compression.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+const BlockFormatInfo blockFormatInfos[blockFormatCount] = {
+    { "rgba8", 1, 4 },
+    { "bc1", 4, 8 },
+    { "bc3", 4, 16 },
+    { "bc5", 4, 16 },
+    { "bc7", 4, 16 }
+};
+const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };                               // Of the second endpoint, in 64ths.
+const float colorBlockWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+const int powerIterationCount = 8;
+
+typedef float BlockTexels[16][4];                                                                                        // Row by row, 0..255 per channel.
+
+const BlockFormatInfo& getBlockFormatInfo(BlockFormat format)
+{
+    return blockFormatInfos[format];
+}
+
+bool findBlockFormat(const std::string& name, BlockFormat& result)
+{
+    for (int format = 0; format < blockFormatCount; format++)
+        if (name == blockFormatInfos[format].name) {
+            result = (BlockFormat)format;
+            return true;
+        }
+    return false;
+}
+
+size_t getCompressedSize(BlockFormat format, int width, int height)
+{
+    const BlockFormatInfo& info = blockFormatInfos[format];
+    return (size_t)((width + info.blockSize - 1) / info.blockSize) * ((height + info.blockSize - 1) / info.blockSize) * info.blockBytes;
+}
+
+struct BitWriter
+{
+    unsigned char* data;                                                                                                 // Zeroed, bits are only ever set.
+    int position = 0;
+
+    void write(uint32_t value, int bitCount)
+    {
+        for (int i = 0; i < bitCount; i++, position++)
+            data[position >> 3] |= ((value >> i) & 1) << (position & 7);
+    }
+};
+
+struct BitReader
+{
+    const unsigned char* data;
+    int position = 0;
+
+    uint32_t read(int bitCount)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bitCount; i++, position++)
+            value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+        return value;
+    }
+};
+
+void loadBlock(const ImageLevel& image, int blockX, int blockY, BlockTexels& texels)
+{
+    for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++) {
+            size_t pixel = (size_t)std::min(blockY * 4 + y, image.height - 1) * image.width + std::min(blockX * 4 + x, image.width - 1);
+            for (int channel = 0; channel < 4; channel++)
+                texels[y * 4 + x][channel] = image.pixels[pixel * 4 + channel];
+        }
+}
+
+float getSquaredError(const float* texel, const int* color, int channelCount)
+{
+    float error = 0.0f;
+    for (int channel = 0; channel < channelCount; channel++)
+        error += (texel[channel] - color[channel]) * (texel[channel] - color[channel]);
+    return error;
+}
+
+void fitEndpoints(const BlockTexels& texels, int channelCount, float endpoints[2][4])                                      // The extremes of the texels along their principal axis.
+{
+    float mean[4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int channel = 0; channel < channelCount; channel++)
+            mean[channel] += texels[i][channel] / 16.0f;
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int row = 0; row < channelCount; row++)
+            for (int column = 0; column < channelCount; column++)
+                covariance[row][column] += (texels[i][row] - mean[row]) * (texels[i][column] - mean[column]);
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < powerIterationCount; iteration++) {
+        float next[4] = {}, largest = 0.0f;
+        for (int row = 0; row < channelCount; row++) {
+            for (int column = 0; column < channelCount; column++)
+                next[row] += covariance[row][column] * axis[column];
+            largest = std::max(largest, std::abs(next[row]));
+        }
+        if (largest == 0.0f)                                                                                             // A single color, any axis works.
+            break;
+        for (int channel = 0; channel < channelCount; channel++)
+            axis[channel] = next[channel] / largest;
+    }
+
+    float lowest = 0.0f, highest = 0.0f, axisLength = 0.0f;
+    for (int channel = 0; channel < channelCount; channel++)
+        axisLength += axis[channel] * axis[channel];
+    for (int i = 0; i < 16; i++) {
+        float projection = 0.0f;
+        for (int channel = 0; channel < channelCount; channel++)
+            projection += (texels[i][channel] - mean[channel]) * axis[channel];
+        lowest = std::min(lowest, projection / axisLength);
+        highest = std::max(highest, projection / axisLength);
+    }
+    for (int channel = 0; channel < channelCount; channel++) {
+        endpoints[0][channel] = std::min(std::max(mean[channel] + lowest * axis[channel], 0.0f), 255.0f);
+        endpoints[1][channel] = std::min(std::max(mean[channel] + highest * axis[channel], 0.0f), 255.0f);
+    }
+}
+
+bool refitEndpoints(const BlockTexels& texels, int channelCount, const float weights[16], float endpoints[2][4])         // Least squares for the endpoints that best reproduce the texels with the chosen weights.
+{
+    float lowLow = 0.0f, lowHigh = 0.0f, highHigh = 0.0f, lowTexel[4] = {}, highTexel[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float low = 1.0f - weights[i], high = weights[i];
+        lowLow += low * low;
+        lowHigh += low * high;
+        highHigh += high * high;
+        for (int channel = 0; channel < channelCount; channel++) {
+            lowTexel[channel] += low * texels[i][channel];
+            highTexel[channel] += high * texels[i][channel];
+        }
+    }
+    float determinant = lowLow * highHigh - lowHigh * lowHigh;
+    if (std::abs(determinant) < 1e-6f)                                                                                   // All texels on one weight.
+        return false;
+    for (int channel = 0; channel < channelCount; channel++) {
+        endpoints[0][channel] = std::min(std::max((lowTexel[channel] * highHigh - highTexel[channel] * lowHigh) / determinant, 0.0f), 255.0f);
+        endpoints[1][channel] = std::min(std::max((highTexel[channel] * lowLow - lowTexel[channel] * lowHigh) / determinant, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+uint16_t packColor565(const float color[4])
+{
+    return (uint16_t)((std::lround(color[0] * 31.0f / 255.0f) << 11) | (std::lround(color[1] * 63.0f / 255.0f) << 5) | std::lround(color[2] * 31.0f / 255.0f));
+}
+
+void unpackColor565(uint16_t packed, int color[4])
+{
+    int red = packed >> 11, green = (packed >> 5) & 63, blue = packed & 31;
+    color[0] = (red << 3) | (red >> 2);
+    color[1] = (green << 2) | (green >> 4);
+    color[2] = (blue << 3) | (blue >> 2);
+    color[3] = 255;
+}
+
+void getColorPalette(uint16_t color0, uint16_t color1, bool isFourColor, int palette[4][4])
+{
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    for (int channel = 0; channel < 4; channel++) {
+        if (isFourColor) {
+            palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+            palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+        }
+        else {
+            palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2;
+            palette[3][channel] = 0;                                                                                     // Transparent black.
+        }
+    }
+}
+
+float encodeColorBlock(const BlockTexels& texels, const float endpoints[2][4], unsigned char* block, float weights[16])  // Always four colors, so BC3 decodes it the same. Returns the squared error.
+{
+    uint16_t color0 = packColor565(endpoints[0]), color1 = packColor565(endpoints[1]);
+    if (color0 < color1)
+        std::swap(color0, color1);
+    int palette[4][4];
+    getColorPalette(color0, color1, true, palette);
+    uint32_t indices = 0;
+    float error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int bestIndex = 0;
+        float bestError = getSquaredError(texels[i], palette[0], 3);
+        for (int index = 1; index < 4 && color0 != color1; index++) {                                                   // Equal colors would decode as three colors, only index 0 is safe.
+            float indexError = getSquaredError(texels[i], palette[index], 3);
+            if (indexError < bestError) {
+                bestError = indexError;
+                bestIndex = index;
+            }
+        }
+        indices |= (uint32_t)bestIndex << (i * 2);
+        weights[i] = colorBlockWeights[bestIndex];
+        error += bestError;
+    }
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = (indices >> (i * 8)) & 0xFF;
+    return error;
+}
+
+void encodeBC1Block(const BlockTexels& texels, unsigned char* block)
+{
+    float endpoints[2][4], weights[16];
+    fitEndpoints(texels, 3, endpoints);
+    float error = encodeColorBlock(texels, endpoints, block, weights);
+    unsigned char refinedBlock[8];
+    float refinedWeights[16];
+    if (refitEndpoints(texels, 3, weights, endpoints) && encodeColorBlock(texels, endpoints, refinedBlock, refinedWeights) < error)
+        memcpy(block, refinedBlock, sizeof(refinedBlock));
+}
+
+void getChannelPalette(int value0, int value1, int palette[8])
+{
+    palette[0] = value0;
+    palette[1] = value1;
+    for (int index = 2; index < 8; index++)
+        palette[index] = value0 > value1 ? ((8 - index) * value0 + (index - 1) * value1) / 7
+                                         : index < 6 ? ((6 - index) * value0 + (index - 1) * value1) / 5 : (index == 6 ? 0 : 255);
+}
+
+void encodeChannelBlock(const BlockTexels& texels, int channel, unsigned char* block)                                    // BC4, eight values between the extremes.
+{
+    float lowest = 255.0f, highest = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        lowest = std::min(lowest, texels[i][channel]);
+        highest = std::max(highest, texels[i][channel]);
+    }
+    int value0 = (int)std::lround(highest), value1 = (int)std::lround(lowest);
+    int palette[8];
+    getChannelPalette(value0, value1, palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 16 && value0 > value1; i++) {                                                                    // Equal values leave every index at 0.
+        int bestIndex = 0;
+        for (int index = 1; index < 8; index++)
+            if (std::abs(texels[i][channel] - palette[index]) < std::abs(texels[i][channel] - palette[bestIndex]))
+                bestIndex = index;
+        indices |= (uint64_t)bestIndex << (i * 3);
+    }
+    block[0] = value0;
+    block[1] = value1;
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)                                           // 7 bits per channel and a p-bit shared by all four, the better of both p-bits.
+{
+    float bestError = INFINITY;
+    for (int candidatePBit = 0; candidatePBit < 2; candidatePBit++) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int channel = 0; channel < 4; channel++) {
+            candidate[channel] = std::min(std::max((int)std::lround((endpoint[channel] - candidatePBit) / 2.0f), 0), 127);
+            float value = candidate[channel] * 2 + candidatePBit;
+            error += (value - endpoint[channel]) * (value - endpoint[channel]);
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = candidatePBit;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+void getBC7Palette(const int colors[2][4], int palette[16][4])
+{
+    for (int index = 0; index < 16; index++)
+        for (int channel = 0; channel < 4; channel++)
+            palette[index][channel] = ((64 - bc7Weights[index]) * colors[0][channel] + bc7Weights[index] * colors[1][channel] + 32) >> 6;
+}
+
+float encodeBC7Block(const BlockTexels& texels, const float endpoints[2][4], unsigned char* block, float weights[16])    // Mode 6. Returns the squared error.
+{
+    int quantized[2][4], pBits[2], colors[2][4], palette[16][4], indices[16];
+    for (int endpoint = 0; endpoint < 2; endpoint++) {
+        quantizeBC7Endpoint(endpoints[endpoint], quantized[endpoint], pBits[endpoint]);
+        for (int channel = 0; channel < 4; channel++)
+            colors[endpoint][channel] = quantized[endpoint][channel] * 2 + pBits[endpoint];
+    }
+    getBC7Palette(colors, palette);
+    float error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = INFINITY;
+        for (int index = 0; index < 16; index++) {
+            float indexError = getSquaredError(texels[i], palette[index], 4);
+            if (indexError < bestError) {
+                bestError = indexError;
+                indices[i] = index;
+            }
+        }
+        error += bestError;
+    }
+    if (indices[0] >= 8) {                                                                                               // The first index is stored without its top bit, swapping the endpoints clears it.
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int& index : indices)
+            index = 15 - index;
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer{ block };
+    writer.write(1 << 6, 7);
+    for (int channel = 0; channel < 4; channel++)
+        for (int endpoint = 0; endpoint < 2; endpoint++)
+            writer.write(quantized[endpoint][channel], 7);
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    for (int i = 0; i < 16; i++) {
+        writer.write(indices[i], i == 0 ? 3 : 4);
+        weights[i] = bc7Weights[indices[i]] / 64.0f;
+    }
+    return error;
+}
+
+void encodeBC7Block(const BlockTexels& texels, unsigned char* block)
+{
+    float endpoints[2][4], weights[16];
+    fitEndpoints(texels, 4, endpoints);
+    float error = encodeBC7Block(texels, endpoints, block, weights);
+    unsigned char refinedBlock[16];
+    float refinedWeights[16];
+    if (refitEndpoints(texels, 4, weights, endpoints) && encodeBC7Block(texels, endpoints, refinedBlock, refinedWeights) < error)
+        memcpy(block, refinedBlock, sizeof(refinedBlock));
+}
+
+std::vector<unsigned char> compressImage(const ImageLevel& image, BlockFormat format)
+{
+    if (format == blockFormatRGBA8)
+        return image.pixels;
+    const BlockFormatInfo& info = blockFormatInfos[format];
+    int blocksWide = (image.width + 3) / 4, blocksHigh = (image.height + 3) / 4;
+    std::vector<unsigned char> result(getCompressedSize(format, image.width, image.height));
+    BlockTexels texels;
+    for (int blockY = 0; blockY < blocksHigh; blockY++)
+        for (int blockX = 0; blockX < blocksWide; blockX++) {
+            loadBlock(image, blockX, blockY, texels);
+            unsigned char* block = result.data() + ((size_t)blockY * blocksWide + blockX) * info.blockBytes;
+            switch (format) {
+            case blockFormatBC1:
+                encodeBC1Block(texels, block);
+                break;
+            case blockFormatBC3:
+                encodeChannelBlock(texels, 3, block);
+                encodeBC1Block(texels, block + 8);
+                break;
+            case blockFormatBC5:
+                encodeChannelBlock(texels, 0, block);
+                encodeChannelBlock(texels, 1, block + 8);
+                break;
+            default:
+                encodeBC7Block(texels, block);
+                break;
+            }
+        }
+    return result;
+}
+
+void decodeColorBlock(const unsigned char* block, bool isAlwaysFourColor, int texels[16][4])
+{
+    uint16_t color0 = block[0] | (block[1] << 8), color1 = block[2] | (block[3] << 8);
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    int palette[4][4];
+    getColorPalette(color0, color1, isAlwaysFourColor || color0 > color1, palette);
+    for (int i = 0; i < 16; i++)
+        memcpy(texels[i], palette[(indices >> (i * 2)) & 3], sizeof(texels[i]));
+}
+
+void decodeChannelBlock(const unsigned char* block, int channel, int texels[16][4])
+{
+    int palette[8];
+    getChannelPalette(block[0], block[1], palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+        indices |= (uint64_t)block[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++)
+        texels[i][channel] = palette[(indices >> (i * 3)) & 7];
+}
+
+bool decodeBC7Block(const unsigned char* block, int texels[16][4])
+{
+    if ((block[0] & 0x7F) != 1 << 6)
+        return false;
+    BitReader reader{ block, 7 };
+    int colors[2][4], palette[16][4];
+    for (int channel = 0; channel < 4; channel++)
+        for (int endpoint = 0; endpoint < 2; endpoint++)
+            colors[endpoint][channel] = reader.read(7) << 1;
+    for (int endpoint = 0; endpoint < 2; endpoint++) {
+        int pBit = reader.read(1);
+        for (int channel = 0; channel < 4; channel++)
+            colors[endpoint][channel] |= pBit;
+    }
+    getBC7Palette(colors, palette);
+    for (int i = 0; i < 16; i++)
+        memcpy(texels[i], palette[reader.read(i == 0 ? 3 : 4)], sizeof(texels[i]));
+    return true;
+}
+
+bool decompressImage(BlockFormat format, const unsigned char* data, size_t size, int width, int height, ImageLevel& result)
+{
+    if (size < getCompressedSize(format, width, height)) {
+        std::cout << "::Error: " << blockFormatInfos[format].name << " data of " << size << " bytes is too short for " << width << "x" << height << std::endl;
+        return false;
+    }
+    result.width = width;
+    result.height = height;
+    if (format == blockFormatRGBA8) {
+        result.pixels.assign(data, data + (size_t)width * height * 4);
+        return true;
+    }
+    const BlockFormatInfo& info = blockFormatInfos[format];
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    result.pixels.resize((size_t)width * height * 4);
+    int texels[16][4];
+    for (int blockY = 0; blockY < blocksHigh; blockY++)
+        for (int blockX = 0; blockX < blocksWide; blockX++) {
+            const unsigned char* block = data + ((size_t)blockY * blocksWide + blockX) * info.blockBytes;
+            switch (format) {
+            case blockFormatBC1:
+                decodeColorBlock(block, false, texels);
+                break;
+            case blockFormatBC3:
+                decodeColorBlock(block + 8, true, texels);
+                decodeChannelBlock(block, 3, texels);
+                break;
+            case blockFormatBC5:
+                for (int i = 0; i < 16; i++) {
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+                decodeChannelBlock(block, 0, texels);
+                decodeChannelBlock(block + 8, 1, texels);
+                break;
+            default:
+                if (!decodeBC7Block(block, texels)) {
+                    std::cout << "::Error: BC7 block uses a mode other than 6, which cannot be decoded on the CPU" << std::endl;
+                    return false;
+                }
+                break;
+            }
+            for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+                for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+                    for (int channel = 0; channel < 4; channel++)
+                        result.pixels[((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4 + channel] = texels[y * 4 + x][channel];
+        }
+    return true;
+}
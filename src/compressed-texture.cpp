@@ -0,0 +1,75 @@
+#include "compressed-texture.hpp"
+#include "gl-state-cache.hpp"
+#include "ktx2-file.hpp"
+#include "mapped-file.hpp"
+#include <iostream>
+
+const GLuint textureLoadUnit = 0;                                                                                        // Unit the glTex* calls go through, any unit works.
+
+GLenum getGlInternalFormat(BlockFormat format)
+{
+    switch (format) {
+    case blockFormatBC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case blockFormatBC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case blockFormatBC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case blockFormatBC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+    default:
+        return GL_RGBA8;
+    }
+}
+
+bool isBlockFormatSupported(BlockFormat format)
+{
+    switch (format) {
+    case blockFormatBC1:
+    case blockFormatBC3:
+        return GLAD_GL_EXT_texture_compression_s3tc;
+    case blockFormatBC7:
+        return GLAD_GL_ARB_texture_compression_bptc;
+    default:
+        return true;
+    }
+}
+
+GLuint loadKtx2Texture(const std::string& absolutePath)
+{
+    MappedFile file;
+    Ktx2Image image;
+    if (!file.open(absolutePath) || !readKtx2(file.getData(), file.getSize(), image)) {
+        std::cout << "::Error: failed to load texture " << absolutePath << std::endl;
+        return 0;
+    }
+
+    bool isSupported = isBlockFormatSupported(image.format);
+    GLuint ID;
+    glGenTextures(1, &ID);
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);                                                             // The pointers below are client memory.
+    getGlStateCache().selectTexture(textureLoadUnit, GL_TEXTURE_2D, ID);
+    for (int level = 0; level < (int)image.levels.size(); level++) {
+        const Ktx2Level& levelData = image.levels[level];
+        ImageLevel decoded;
+        if (image.format == blockFormatRGBA8)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelData.width, levelData.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levelData.data);
+        else if (isSupported)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, getGlInternalFormat(image.format), levelData.width, levelData.height, 0,
+                                   levelData.size, levelData.data);
+        else if (decompressImage(image.format, levelData.data, levelData.size, levelData.width, levelData.height, decoded))
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, decoded.width, decoded.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.pixels.data());
+        else {
+            std::cout << "::Error: failed to load texture " << absolutePath << std::endl;
+            getGlStateCache().onTextureDeleted(ID);
+            glDeleteTextures(1, &ID);
+            return 0;
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);                                       // The chain may stop before 1x1.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return ID;
+}
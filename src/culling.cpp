@@ -0,0 +1,298 @@
+#include "culling.hpp"
+#include "gl-state-cache.hpp"
+#include "shader-preprocessor.hpp"
+#include "filesystem-utils.hpp"
+#include "job-system.hpp"
+#include "geometry/vertex-packing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static_assert(sizeof(BoundingSphere) == 4 * sizeof(GLfloat), "BoundingSphere has to match a std430 vec4");
+
+const int cullWorkGroupSize = 64;                                                                                        // local_size_x of cullInstancesComputeShader.glsl.
+const int cullBatchSize = 1024;                                                                                          // Instances per job of the CPU path.
+const GLuint depthPyramidTextureUnit = 0;
+
+Frustum getFrustum(const Matrix4& viewProjection)                                                                        // Gribb & Hartmann: every plane is the last row plus or minus another row.
+{
+    Frustum frustum;
+    for (int plane = 0; plane < 6; plane++) {
+        int row = plane / 2;
+        GLfloat sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; column++)
+            frustum.planes[plane][column] = viewProjection.at(column, 3) + sign * viewProjection.at(column, row);
+        GLfloat* p = frustum.planes[plane];
+        GLfloat length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        for (int i = 0; i < 4; i++)
+            p[i] /= length;
+    }
+    return frustum;
+}
+
+bool isSphereInFrustum(const Frustum& frustum, const BoundingSphere& sphere)
+{
+    for (const GLfloat* p : frustum.planes)
+        if (p[0] * sphere.center.x + p[1] * sphere.center.y + p[2] * sphere.center.z + p[3] < -sphere.radius)
+            return false;
+    return true;
+}
+
+BoundingSphere getBoundingSphere(const std::vector<Vertex>& vertices)
+{
+    MeshBounds bounds = getMeshBounds(vertices);
+    Position center((bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f);
+    GLfloat squaredRadius = 0.0f;
+    for (const Vertex& vertex : vertices) {
+        GLfloat dx = vertex.position.x - center.x, dy = vertex.position.y - center.y, dz = vertex.position.z - center.z;
+        squaredRadius = std::max(squaredRadius, dx * dx + dy * dy + dz * dz);
+    }
+    return { center, std::sqrt(squaredRadius) };
+}
+
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const Matrix4& model)
+{
+    GLfloat maxSquaredScale = 0.0f;
+    for (int column = 0; column < 3; column++)
+        maxSquaredScale = std::max(maxSquaredScale, model.at(column, 0) * model.at(column, 0) + model.at(column, 1) * model.at(column, 1)
+                                                    + model.at(column, 2) * model.at(column, 2));
+    return { model.transformPoint(sphere.center), sphere.radius * std::sqrt(maxSquaredScale) };
+}
+
+DepthPyramid::DepthPyramid(int width, int height) : width(width), height(height)
+{
+    levelCount = 1 + (int)std::floor(std::log2((double)std::max(width, height)));
+    glGenTextures(1, &texture);
+    getGlStateCache().selectTexture(depthPyramidTextureUnit, GL_TEXTURE_2D, texture);
+    for (int level = 0; level < levelCount; level++)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenVertexArrays(1, &emptyVAO);
+    reduceProgram = new ShaderProgram(getShaderFileAbsolutePath("fullscreenVertexShader.glsl"),
+                                      getShaderFileAbsolutePath("depthReduceFragmentShader.glsl"));
+    reduceProgram->setInt("sourceDepth", depthPyramidTextureUnit);
+}
+
+void DepthPyramid::build(GLuint depthTexture)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLuint previousFramebuffer = getGlStateCache().getFramebuffer();
+    getGlStateCache().bindFramebuffer(framebuffer);
+    getGlStateCache().bindVertexArray(emptyVAO);
+    reduceProgram->use();
+
+    for (int level = 0; level < levelCount; level++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+        glViewport(0, 0, std::max(width >> level, 1), std::max(height >> level, 1));
+        reduceProgram->setBool("isCopy", level == 0);
+        if (level == 0)
+            getGlStateCache().bindTexture(depthPyramidTextureUnit, GL_TEXTURE_2D, depthTexture);
+        else {
+            getGlStateCache().selectTexture(depthPyramidTextureUnit, GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);                                            // Only the source level is visible to the shader, reading the texture that is rendered to stays defined.
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    getGlStateCache().selectTexture(depthPyramidTextureUnit, GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    getGlStateCache().bindFramebuffer(previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void DepthPyramid::deleteDepthPyramid()
+{
+    getGlStateCache().onFramebufferDeleted(framebuffer);
+    getGlStateCache().onVertexArrayDeleted(emptyVAO);
+    getGlStateCache().onTextureDeleted(texture);
+    getGlStateCache().onProgramDeleted(reduceProgram->ID);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteTextures(1, &texture);
+    glDeleteProgram(reduceProgram->ID);
+    delete reduceProgram;
+}
+
+GLuint createShaderStorageBuffer(GLsizeiptr size)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    return buffer;
+}
+
+void uploadBuffer(GLuint buffer, const void* data, GLsizeiptr size)
+{
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+}
+
+CullingPass::CullingPass(GeometryPool* geometryPool, const std::vector<MeshAllocation>& meshes, int instanceCapacity, bool isGpuPreferred)
+    : geometryPool(geometryPool), meshes(meshes), drawDataBuffer(instanceCapacity), instanceCapacity(instanceCapacity), cullProgram(nullptr),
+      sphereBuffer(0), meshIndexBuffer(0), instanceBuffer(0), drawCommandBuffer(0)
+{
+    drawDataBuffer.attach(geometryPool->VAO);
+    isGpu = isGpuPreferred && GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_storage_buffer_object && GLAD_GL_ARB_shading_language_420pack
+            && isMultiDrawIndirectSupported();                                                                           // The compute shader is GLSL 3.30 with these extensions, so a 3.3 context exposing them can run it.
+    if (isGpu) {
+        ShaderSource source;
+        GLuint program = 0;
+        if (preprocessShader(getShaderFileAbsolutePath("cullInstancesComputeShader.glsl"), {}, source))
+            program = createComputeShaderProgram(source);
+        if (program == 0) {
+            std::cout << "::Error: the culling compute shader failed to build, culling on the CPU instead" << std::endl;
+            isGpu = false;
+        }
+        else
+            cullProgram = new ShaderProgram(program);
+    }
+    if (isGpu) {
+        sphereBuffer = createShaderStorageBuffer(instanceCapacity * sizeof(BoundingSphere));
+        meshIndexBuffer = createShaderStorageBuffer(instanceCapacity * sizeof(GLuint));
+        instanceBuffer = createShaderStorageBuffer(instanceCapacity * sizeof(InstanceData));
+        drawCommandBuffer = createShaderStorageBuffer(meshes.size() * sizeof(DrawElementsIndirectCommand));
+    }
+}
+
+void CullingPass::setInstances(const std::vector<InstanceData>& newInstances, const std::vector<BoundingSphere>& newBoundingSpheres,
+                               const std::vector<GLuint>& newMeshIndices)
+{
+    int instanceCount = std::min({ (int)newInstances.size(), (int)newBoundingSpheres.size(), (int)newMeshIndices.size() });
+    if (instanceCount > instanceCapacity) {
+        std::cout << "::Error: " << instanceCount << " instances do not fit a culling pass of " << instanceCapacity << ", the rest is dropped" << std::endl;
+        instanceCount = instanceCapacity;
+    }
+    instances.assign(newInstances.begin(), newInstances.begin() + instanceCount);
+    boundingSpheres.assign(newBoundingSpheres.begin(), newBoundingSpheres.begin() + instanceCount);
+    meshIndices.assign(newMeshIndices.begin(), newMeshIndices.begin() + instanceCount);
+
+    std::vector<GLuint> meshInstanceCounts(meshes.size(), 0);                                                            // Every mesh gets a range as large as its instance count, surviving instances are packed into it.
+    for (GLuint mesh : meshIndices)
+        meshInstanceCounts[mesh]++;
+    drawCommands.clear();
+    GLuint firstSlot = 0;
+    for (size_t mesh = 0; mesh < meshes.size(); mesh++) {
+        const MeshAllocation& allocation = meshes[mesh];
+        drawCommands.push_back({ (GLuint)allocation.elementsCount, 0, (GLuint)allocation.firstIndex, allocation.baseVertex, firstSlot });
+        firstSlot += meshInstanceCounts[mesh];
+    }
+
+    if (isGpu) {
+        uploadBuffer(sphereBuffer, boundingSpheres.data(), instanceCount * sizeof(BoundingSphere));
+        uploadBuffer(meshIndexBuffer, meshIndices.data(), instanceCount * sizeof(GLuint));
+        uploadBuffer(instanceBuffer, instances.data(), instanceCount * sizeof(InstanceData));
+    }
+}
+
+void CullingPass::cullOnCpu(const Matrix4& viewProjection)
+{
+    Frustum frustum = getFrustum(viewProjection);
+    visibleInstances.resize(instances.size());
+    instanceVisibility.resize(instances.size());
+    parallelFor(instances.size(), cullBatchSize, [&](int begin, int end) {                                              // The tests run on the job system, packing the survivors stays in order on this thread.
+        for (int instance = begin; instance < end; instance++)
+            instanceVisibility[instance] = isSphereInFrustum(frustum, boundingSpheres[instance]);
+    });
+    for (DrawElementsIndirectCommand& command : drawCommands)
+        command.instanceCount = 0;
+    for (size_t instance = 0; instance < instances.size(); instance++) {
+        if (!instanceVisibility[instance])
+            continue;
+        DrawElementsIndirectCommand& command = drawCommands[meshIndices[instance]];
+        visibleInstances[command.baseInstance + command.instanceCount++] = instances[instance];
+    }
+    drawDataBuffer.update(visibleInstances);
+}
+
+void CullingPass::cull(const Matrix4& viewProjection, const DepthPyramid* depthPyramid, const Matrix4& pyramidViewProjection)
+{
+    if (!isGpu) {
+        cullOnCpu(viewProjection);
+        return;
+    }
+
+    for (DrawElementsIndirectCommand& command : drawCommands)
+        command.instanceCount = 0;
+    uploadBuffer(drawCommandBuffer, drawCommands.data(), drawCommands.size() * sizeof(DrawElementsIndirectCommand));
+
+    cullProgram->use();
+    cullProgram->setInt("instanceCount", instances.size());
+    cullProgram->setMat4("viewProjection", viewProjection);
+    cullProgram->setBool("isOcclusionCulled", depthPyramid != nullptr);
+    if (depthPyramid != nullptr) {
+        cullProgram->setMat4("occlusionViewProjection", pyramidViewProjection);
+        cullProgram->setInt("depthPyramid", depthPyramidTextureUnit);
+        cullProgram->setInt("depthPyramidLevelCount", depthPyramid->getLevelCount());
+        getGlStateCache().bindTexture(depthPyramidTextureUnit, GL_TEXTURE_2D, depthPyramid->texture);
+    }
+    getGlStateCache().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sphereBuffer);
+    getGlStateCache().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, meshIndexBuffer);
+    getGlStateCache().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instanceBuffer);
+    getGlStateCache().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawDataBuffer.ID);
+    getGlStateCache().bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, drawCommandBuffer);
+    glDispatchCompute((instances.size() + cullWorkGroupSize - 1) / cullWorkGroupSize, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);               // Indirect commands, draw data fetches and the next frame's uploads see the shader's writes.
+}
+
+void CullingPass::draw(GLuint shaderProgram)
+{
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(geometryPool->VAO);
+    drawDataBuffer.bind();
+    if (isGpu) {
+        getGlStateCache().bindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, geometryPool->indexType, nullptr, drawCommands.size(), 0);
+        return;
+    }
+
+    for (const DrawElementsIndirectCommand& command : drawCommands) {                                                    // The same commands, issued one by one with the draw ID set the way the VAO reads it.
+        if (command.instanceCount == 0)
+            continue;
+        void* indexOffset = (void*)(command.firstIndex * getIndexSize(geometryPool->indexType));
+        glVertexAttribI1ui(drawIdAttributeLocation, command.baseInstance);
+        if (GLAD_GL_ARB_base_instance)
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, geometryPool->indexType, indexOffset, command.instanceCount,
+                                                          command.baseVertex, command.baseInstance);
+        else
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, geometryPool->indexType, indexOffset, command.instanceCount, command.baseVertex);
+    }
+    glVertexAttribI1ui(drawIdAttributeLocation, 0);
+}
+
+int CullingPass::getVisibleCount()
+{
+    if (isGpu) {
+        getGlStateCache().bindBuffer(GL_COPY_READ_BUFFER, drawCommandBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, drawCommands.size() * sizeof(DrawElementsIndirectCommand), drawCommands.data());
+    }
+    int visibleCount = 0;
+    for (const DrawElementsIndirectCommand& command : drawCommands)
+        visibleCount += command.instanceCount;
+    return visibleCount;
+}
+
+void CullingPass::deleteCullingPass()
+{
+    drawDataBuffer.deleteDrawDataBuffer();
+    if (cullProgram != nullptr) {
+        getGlStateCache().onProgramDeleted(cullProgram->ID);
+        glDeleteProgram(cullProgram->ID);
+        delete cullProgram;
+        cullProgram = nullptr;
+    }
+    GLuint buffers[] = { sphereBuffer, meshIndexBuffer, instanceBuffer, drawCommandBuffer };
+    for (GLuint buffer : buffers)
+        getGlStateCache().onBufferDeleted(buffer);
+    if (isGpu)
+        glDeleteBuffers(4, buffers);
+}
@@ -2,6 +2,7 @@
 #include <nlohmann-json/json.hpp>
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 
 struct SrcPathNode
 {
@@ -16,9 +17,11 @@ public:
     SrcPathNode* rootPath;
     SrcPathNode* resourcesPath;
     SrcPathNode* shadersPath;
+    SrcPathNode* texturesPath;
     SrcPathNode* vertexShaderPath;
     SrcPathNode* fragmentShaderPath;
     SrcPathNode* configPath;
+    SrcPathNode* shaderCachePath;
 
     bool isInitialized() const { return rootPath != nullptr; }
     SrcPathNode* getResourcePath() const { return resourcesPath; }
@@ -26,13 +29,17 @@ public:
     SrcPathNode* getVertexShaderPath() const { return vertexShaderPath; }
     SrcPathNode* getFragmentShaderPath() const { return fragmentShaderPath; }
     SrcPathNode* getConfigPath() const { return configPath; }
+    SrcPathNode* getShaderCachePath() const { return shaderCachePath; }
 };
 
 std::map<PathNodeType, std::string> pathNodeName
 {
     { PathNodeType::configJson, "configJson" },
     { PathNodeType::vertexShader, "vertexShader" },
-    { PathNodeType::fragmentShader, "fragmentShader" }
+    { PathNodeType::fragmentShader, "fragmentShader" },
+    { PathNodeType::shaderCache, "shaderCache" },
+    { PathNodeType::shadersDirectory, "shadersDirectory" },
+    { PathNodeType::texturesDirectory, "texturesDirectory" }
 };
 
 SourceTree sourceTree;
@@ -74,6 +81,8 @@ void initializePath()
     sourceTree.configPath = createPath("config.json", sourceTree.rootPath);
     sourceTree.resourcesPath = createPath("resources", sourceTree.rootPath);
     sourceTree.shadersPath = createPath("shaders", sourceTree.resourcesPath);
+    sourceTree.shaderCachePath = createPath("shader-cache", sourceTree.resourcesPath);
+    sourceTree.texturesPath = createPath("textures", sourceTree.resourcesPath);
 }
 
 void addShaderPath(GLenum shaderType, const std::string& shaderName)
@@ -81,11 +90,13 @@ void addShaderPath(GLenum shaderType, const std::string& shaderName)
     if (!sourceTree.isInitialized())
         initializePath();
 
+    SrcPathNode *shaderPathNode = nullptr;
     for (int i = 0; i < sourceTree.shadersPath->children.size(); i++)
         if (sourceTree.shadersPath->children[i]->name == shaderName)
-            return;
+            shaderPathNode = sourceTree.shadersPath->children[i];
 
-    SrcPathNode *shaderPathNode = createPath(shaderName, sourceTree.shadersPath);
+    if (shaderPathNode == nullptr)
+        shaderPathNode = createPath(shaderName, sourceTree.shadersPath);
     if (shaderType == GL_VERTEX_SHADER)
         sourceTree.vertexShaderPath = shaderPathNode;
     else
@@ -121,6 +132,12 @@ std::string getAbsolutePath(PathNodeType type)
             return getAbsolutePath(sourceTree.vertexShaderPath, type);
         case fragmentShader:
             return getAbsolutePath(sourceTree.fragmentShaderPath, type);
+        case shaderCache:
+            return getAbsolutePath(sourceTree.shaderCachePath, type);
+        case shadersDirectory:
+            return getAbsolutePath(sourceTree.shadersPath, type);
+        case texturesDirectory:
+            return getAbsolutePath(sourceTree.texturesPath, type);
         default:
             exit(EXIT_FAILURE);
     }
@@ -138,6 +155,26 @@ std::string getShaderAbsolutePath(GLenum shaderType, const std::string &vertexSh
     return getAbsolutePath(ShaderPathNodeType);
 }
 
+std::string getShaderFileAbsolutePath(const std::string& shaderName)
+{
+    return (std::filesystem::path(getAbsolutePath(PathNodeType::shadersDirectory)) / shaderName).string();
+}
+
+std::string getTextureAbsolutePath(const std::string& textureName)
+{
+    return (std::filesystem::path(getAbsolutePath(PathNodeType::texturesDirectory)) / textureName).string();
+}
+
+std::string getShaderCacheDirectory()
+{
+    std::string shaderCachePath = getAbsolutePath(PathNodeType::shaderCache);
+    std::error_code error;
+    std::filesystem::create_directories(shaderCachePath, error);
+    if (error)
+        std::cout << "::Error: failed to create shader cache directory " << shaderCachePath << ": " << error.message() << std::endl;
+    return shaderCachePath;
+}
+
 void deletePath(SrcPathNode* &root)
 {
     if (root == nullptr)
@@ -157,9 +194,11 @@ void deletePath() {
     sourceTree.rootPath = nullptr;
     sourceTree.resourcesPath = nullptr;
     sourceTree.shadersPath = nullptr;
+    sourceTree.texturesPath = nullptr;
     sourceTree.vertexShaderPath = nullptr;
     sourceTree.fragmentShaderPath = nullptr;
     sourceTree.configPath = nullptr;
+    sourceTree.shaderCachePath = nullptr;
 }
 
 template<class T>
@@ -183,5 +222,9 @@ ConfigData getConfig()
     readValue(data, "borderless", result.isBorderless);
     readValue(data, "width", result.width);
     readValue(data, "height", result.height);
+    readValue(data, "profilerTrace", result.profilerTracePath);
+    readValue(data, "shaderHotReload", result.isShaderHotReloadEnabled);
+    readValue(data, "textureMemoryBudgetMB", result.textureMemoryBudgetMB);
+    readValue(data, "workerThreads", result.workerThreadCount);
     return result;
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "framebuffer.hpp"
+#include "gl-state-cache.hpp"
+#include <iostream>
+
+GLuint createAttachmentTexture(GLint internalFormat, GLenum format, GLenum type, int width, int height)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    getGlStateCache().bindTexture(0, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);       // Allocates storage only, the contents are produced by rendering.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    getGlStateCache().bindTexture(0, GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+Framebuffer::Framebuffer(int width, int height) : width(width), height(height)
+{
+    colorTexture = createAttachmentTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    depthTexture = createAttachmentTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width, height);
+
+    glGenFramebuffers(1, &ID);
+    getGlStateCache().bindFramebuffer(ID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "::Error: framebuffer " << width << "x" << height << " is incomplete" << std::endl;
+        deleteFramebuffer();
+    }
+    getGlStateCache().bindFramebuffer(0);
+}
+
+void Framebuffer::bind() const
+{
+    getGlStateCache().bindFramebuffer(ID);                                                                        // Every following draw call renders into the attachments instead of the window's default framebuffer.
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::unbind() const
+{
+    getGlStateCache().bindFramebuffer(0);
+}
+
+void Framebuffer::deleteFramebuffer()
+{
+    getGlStateCache().onFramebufferDeleted(ID);
+    getGlStateCache().onTextureDeleted(colorTexture);
+    getGlStateCache().onTextureDeleted(depthTexture);
+    glDeleteFramebuffers(1, &ID);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteTextures(1, &depthTexture);
+    ID = 0;
+    colorTexture = 0;
+    depthTexture = 0;
+}
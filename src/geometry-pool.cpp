@@ -0,0 +1,180 @@
+#include "geometry-pool.hpp"
+#include "renderer.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+#include <iostream>
+
+RangeAllocator::RangeAllocator(int capacity) : capacity(capacity), freeSize(capacity)
+{
+    if (capacity > 0)
+        freeRanges[0] = capacity;
+}
+
+int RangeAllocator::allocate(int size)
+{
+    auto best = freeRanges.end();
+    for (auto range = freeRanges.begin(); range != freeRanges.end(); range++) {                                          // Best fit keeps large ranges whole for large meshes.
+        if (range->second >= size && (best == freeRanges.end() || range->second < best->second))
+            best = range;
+        if (best != freeRanges.end() && best->second == size)
+            break;
+    }
+    if (best == freeRanges.end())
+        return -1;
+
+    int offset = best->first, remainingSize = best->second - size;
+    freeRanges.erase(best);
+    if (remainingSize > 0)
+        freeRanges[offset + size] = remainingSize;
+    freeSize -= size;
+    return offset;
+}
+
+void RangeAllocator::release(int offset, int size)
+{
+    if (size <= 0)
+        return;
+    freeSize += size;
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && next->first == offset + size) {                                                     // Merges with the free range right after.
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {                                                              // And with the one right before.
+            previous->second += size;
+            return;
+        }
+    }
+    freeRanges[offset] = size;
+}
+
+void RangeAllocator::grow(int newCapacity)
+{
+    if (newCapacity <= capacity)
+        return;
+    release(capacity, newCapacity - capacity);
+    capacity = newCapacity;
+}
+
+GeometryPool::GeometryPool(const VertexAttribute* attributes, int attributeCount, GLsizei stride, int vertexCapacity, int indexCapacity,
+                           GLenum indexType)
+    : attributes(attributes), attributeCount(attributeCount), stride(stride), vertexAllocator(vertexCapacity),
+      indexAllocator(indexCapacity), indexType(indexType)
+{
+    glGenVertexArrays(1, &VAO);
+    createBuffers(vertexCapacity, indexCapacity);
+}
+
+void GeometryPool::createBuffers(int vertexCapacity, int indexCapacity)                                                 // Creates VBO and EBO and points the VAO at them.
+{
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    getGlStateCache().bindVertexArray(VAO);
+    getGlStateCache().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * getIndexSize(indexType), nullptr, GL_STATIC_DRAW);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * stride, nullptr, GL_STATIC_DRAW);
+    enableVertexLayout(attributes, attributeCount, stride);
+    getGlStateCache().bindVertexArray(0);
+}
+
+void GeometryPool::growBuffers(int minVertexCapacity, int minIndexCapacity)
+{
+    int vertexCapacity = std::max(vertexAllocator.getCapacity(), 1), indexCapacity = std::max(indexAllocator.getCapacity(), 1);
+    while (vertexCapacity < minVertexCapacity)
+        vertexCapacity *= 2;
+    while (indexCapacity < minIndexCapacity)
+        indexCapacity *= 2;
+    GLuint oldVBO = VBO, oldEBO = EBO;
+    createBuffers(vertexCapacity, indexCapacity);
+
+    getGlStateCache().bindBuffer(GL_COPY_READ_BUFFER, oldVBO);                                                           // GPU-side copies, the old contents never travel back to the CPU.
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)vertexAllocator.getCapacity() * stride);
+    getGlStateCache().bindBuffer(GL_COPY_READ_BUFFER, oldEBO);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)indexAllocator.getCapacity() * getIndexSize(indexType));
+
+    getGlStateCache().onBufferDeleted(oldVBO);
+    getGlStateCache().onBufferDeleted(oldEBO);
+    GLuint oldBuffers[] = { oldVBO, oldEBO };
+    glDeleteBuffers(2, oldBuffers);
+    vertexAllocator.grow(vertexCapacity);
+    indexAllocator.grow(indexCapacity);
+}
+
+MeshAllocation GeometryPool::allocate(const void* vertices, int vertexCount, const std::vector<GLuint>& indices)
+{
+    MeshAllocation allocation;
+    if (vertexCount <= 0 || indices.empty()) {
+        std::cout << "::Error: a mesh without vertices or indices cannot be added to the geometry pool" << std::endl;
+        return allocation;
+    }
+    if (indexType == GL_UNSIGNED_SHORT && vertexCount > 65536) {
+        std::cout << "::Error: a mesh of " << vertexCount << " vertices does not fit the 16-bit indices of the geometry pool" << std::endl;
+        return allocation;
+    }
+    int vertexOffset = vertexAllocator.allocate(vertexCount);
+    int indexOffset = indexAllocator.allocate(indices.size());
+    if (vertexOffset < 0 || indexOffset < 0) {
+        int minVertexCapacity = vertexAllocator.getCapacity() + (vertexOffset < 0 ? vertexCount : 0);                   // The new space alone fits the mesh, however fragmented the old space is.
+        int minIndexCapacity = indexAllocator.getCapacity() + (indexOffset < 0 ? indices.size() : 0);
+        if (vertexOffset >= 0)
+            vertexAllocator.release(vertexOffset, vertexCount);
+        if (indexOffset >= 0)
+            indexAllocator.release(indexOffset, indices.size());
+        growBuffers(minVertexCapacity, minIndexCapacity);
+        vertexOffset = vertexAllocator.allocate(vertexCount);
+        indexOffset = indexAllocator.allocate(indices.size());
+    }
+
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)vertexOffset * stride, (GLsizeiptr)vertexCount * stride, vertices);
+    getGlStateCache().bindVertexArray(0);                                                                                // The element buffer binding is VAO state, keeps other VAOs out of it.
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    if (indexType == GL_UNSIGNED_SHORT) {
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexOffset * sizeof(GLushort), shortIndices.size() * sizeof(GLushort), shortIndices.data());
+    }
+    else
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexOffset * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+
+    allocation.baseVertex = vertexOffset;
+    allocation.vertexCount = vertexCount;
+    allocation.firstIndex = indexOffset;
+    allocation.elementsCount = indices.size();
+    allocation.isValid = true;
+    return allocation;
+}
+
+void GeometryPool::release(const MeshAllocation& allocation)
+{
+    if (!allocation.isValid)
+        return;
+    vertexAllocator.release(allocation.baseVertex, allocation.vertexCount);
+    indexAllocator.release(allocation.firstIndex, allocation.elementsCount);
+}
+
+GLintptr GeometryPool::getIndexOffset(const MeshAllocation& allocation) const
+{
+    return (GLintptr)allocation.firstIndex * getIndexSize(indexType);
+}
+
+void GeometryPool::draw(GLuint shaderProgram, const MeshAllocation& allocation) const
+{
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(VAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, allocation.elementsCount, indexType, (void*)getIndexOffset(allocation), allocation.baseVertex);
+}
+
+void GeometryPool::deleteGeometryPool()
+{
+    getGlStateCache().onVertexArrayDeleted(VAO);
+    getGlStateCache().onBufferDeleted(VBO);
+    getGlStateCache().onBufferDeleted(EBO);
+    glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = { VBO, EBO };
+    glDeleteBuffers(2, buffers);
+}
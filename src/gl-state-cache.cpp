@@ -0,0 +1,222 @@
+#include "gl-state-cache.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+GlStateCache glStateCache;
+
+GlStateCache& getGlStateCache()
+{
+    return glStateCache;
+}
+
+int GlStateCacheStats::getIssuedCallCount() const
+{
+    int result = 0;
+    for (int count : issuedCallCount)
+        result += count;
+    return result;
+}
+
+int GlStateCacheStats::getElidedCallCount() const
+{
+    int result = 0;
+    for (int count : elidedCallCount)
+        result += count;
+    return result;
+}
+
+GlStateCache::GlStateCache()
+{
+    invalidate();
+}
+
+bool GlStateCache::isChanged(GlStateCall call, bool isChanged)
+{
+    if (isChanged)
+        stats.issuedCallCount[call]++;
+    else
+        stats.elidedCallCount[call]++;
+    return isChanged;
+}
+
+int GlStateCache::getBufferTargetSlot(GLenum target)
+{
+    switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_COPY_READ_BUFFER: return 3;
+        case GL_COPY_WRITE_BUFFER: return 4;
+        case GL_PIXEL_UNPACK_BUFFER: return 5;
+        case GL_PIXEL_PACK_BUFFER: return 6;
+        case GL_DRAW_INDIRECT_BUFFER: return 7;
+        case GL_SHADER_STORAGE_BUFFER: return 8;
+        case GL_TEXTURE_BUFFER: return 9;
+        default: return -1;
+    }
+}
+
+void GlStateCache::useProgram(GLuint newProgram)
+{
+    if (isChanged(programCall, newProgram != program)) {
+        glUseProgram(newProgram);
+        program = newProgram;
+    }
+}
+
+void GlStateCache::bindVertexArray(GLuint newVertexArray)
+{
+    if (isChanged(vertexArrayCall, newVertexArray != vertexArray)) {
+        glBindVertexArray(newVertexArray);
+        vertexArray = newVertexArray;
+        buffers[getBufferTargetSlot(GL_ELEMENT_ARRAY_BUFFER)] = unknownName;                                       // The element buffer binding is part of the VAO state.
+    }
+}
+
+void GlStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = getBufferTargetSlot(target);
+    if (slot < 0) {
+        glBindBuffer(target, buffer);
+        stats.issuedCallCount[bufferCall]++;
+        return;
+    }
+    if (isChanged(bufferCall, buffers[slot] != buffer)) {
+        glBindBuffer(target, buffer);
+        buffers[slot] = buffer;
+    }
+}
+
+void GlStateCache::bindUniformBufferRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (binding >= cachedUniformBindingCount) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+        stats.issuedCallCount[bufferRangeCall]++;
+        return;
+    }
+    BufferRange& range = uniformRanges[binding];
+    if (isChanged(bufferRangeCall, range.buffer != buffer || range.offset != offset || range.size != size)) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);                                    // Also binds the generic GL_UNIFORM_BUFFER target.
+        range = { buffer, offset, size };
+        buffers[getBufferTargetSlot(GL_UNIFORM_BUFFER)] = buffer;
+    }
+}
+
+void GlStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (unit >= textures.size()) {
+        textures.resize(unit + 1, unknownName);
+        textureTargets.resize(unit + 1, 0);
+    }
+    if (textures[unit] == texture && textureTargets[unit] == target) {
+        stats.elidedCallCount[textureCall]++;
+        return;
+    }
+    if (isChanged(activeTextureCall, activeTextureUnit != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeTextureUnit = unit;
+    }
+    glBindTexture(target, texture);
+    stats.issuedCallCount[textureCall]++;
+    textures[unit] = texture;
+    textureTargets[unit] = target;
+}
+
+void GlStateCache::selectTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    bindTexture(unit, target, texture);
+    if (isChanged(activeTextureCall, activeTextureUnit != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeTextureUnit = unit;
+    }
+}
+
+void GlStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    glBindBufferBase(target, index, buffer);
+    stats.issuedCallCount[bufferRangeCall]++;
+    int slot = getBufferTargetSlot(target);
+    if (slot >= 0)
+        buffers[slot] = buffer;
+}
+
+void GlStateCache::bindFramebuffer(GLuint newFramebuffer)
+{
+    if (isChanged(framebufferCall, newFramebuffer != framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, newFramebuffer);
+        framebuffer = newFramebuffer;
+    }
+}
+
+void GlStateCache::setClearColor(const Color& color)
+{
+    bool isColorChanged = color.r != clearColor.r || color.g != clearColor.g || color.b != clearColor.b || color.a != clearColor.a;
+    if (isChanged(clearColorCall, isColorChanged)) {
+        glClearColor(color.r, color.g, color.b, color.a);
+        clearColor = color;
+    }
+}
+
+void GlStateCache::setPolygonMode(GLenum mode)
+{
+    if (isChanged(polygonModeCall, mode != polygonMode)) {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+        polygonMode = mode;
+    }
+}
+
+void GlStateCache::onProgramDeleted(GLuint deletedProgram)                                                               // A deleted program that is still in use stays current, but its name may be reused by the next glCreateProgram.
+{
+    if (program == deletedProgram)
+        program = unknownName;
+}
+
+void GlStateCache::onVertexArrayDeleted(GLuint deletedVertexArray)                                                       // Deleting a bound object reverts its binding to 0.
+{
+    if (vertexArray == deletedVertexArray) {
+        vertexArray = 0;
+        buffers[getBufferTargetSlot(GL_ELEMENT_ARRAY_BUFFER)] = unknownName;
+    }
+}
+
+void GlStateCache::onBufferDeleted(GLuint deletedBuffer)
+{
+    for (GLuint& buffer : buffers)
+        if (buffer == deletedBuffer)
+            buffer = 0;
+    for (BufferRange& range : uniformRanges)
+        if (range.buffer == deletedBuffer)
+            range = { 0, 0, 0 };
+}
+
+void GlStateCache::onTextureDeleted(GLuint deletedTexture)
+{
+    for (GLuint& texture : textures)
+        if (texture == deletedTexture)
+            texture = 0;
+}
+
+void GlStateCache::onFramebufferDeleted(GLuint deletedFramebuffer)
+{
+    if (framebuffer == deletedFramebuffer)
+        framebuffer = 0;
+}
+
+void GlStateCache::invalidate()                                                                                          // Forgets everything, the next call of every setter reaches GL.
+{
+    program = vertexArray = framebuffer = activeTextureUnit = unknownName;
+    for (GLuint& buffer : buffers)
+        buffer = unknownName;
+    for (BufferRange& range : uniformRanges)
+        range = { unknownName, 0, 0 };
+    std::fill(textures.begin(), textures.end(), unknownName);
+    std::fill(textureTargets.begin(), textureTargets.end(), 0);
+    clearColor = Color(-1.0f, -1.0f, -1.0f, -1.0f);
+    polygonMode = 0;
+}
+
+void GlStateCache::reportStats()                                                                                         // Adds the counters to the profiler trace, meant to be called once per frame.
+{
+    addProfilerCounter("GL calls issued", stats.getIssuedCallCount());
+    addProfilerCounter("GL calls elided", stats.getElidedCallCount());
+}
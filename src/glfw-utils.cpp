@@ -1,5 +1,6 @@
 #include "glfw-utils.hpp"
 #include "filesystem-utils.hpp"
+#include "gl-state-cache.hpp"
 #include "geometry/vertex-utils.hpp"
 #include <vector>
 
@@ -18,10 +19,15 @@ void framebufferResizeCallback(GLFWwindow*, int width, int height)
     setViewport(width, height);                                                                                          // sets the viewport (a rectangle in pixels on the screen that you wish to render to), transforms NDC coordinates to screen coordinates. OpenGL will automatically scale the rendering so it fits into the given viewport.
 }
 
-void initGLFW()
+void initGLFW(bool isHeadless)
 {
     glfwSetErrorCallback(errorCallback);
 
+#ifdef __linux__
+    if (isHeadless && !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY"))                                                  // Without a display server GLFW can still create windowless OSMesa contexts (e.g. Mesa llvmpipe on a GPU-less CI box) through its null platform.
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
     if (!glfwInit())                                                                                                     // This function initializes the GLFW library.Before most GLFW functions can be used, GLFW must be initialized (GLFW provides programmers with the ability to create and manage windows and OpenGL contexts, as well as handle joystick, keyboard and mouse input.).
         exit(EXIT_FAILURE);
 
@@ -30,17 +36,25 @@ void initGLFW()
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);                                            // This hint specifies which OpenGL profile to create the context for. Core-profile gets access to a smaller subset of OpenGL features without backwards-compatible features we don't need.
 }
 
+void loadGLFunctions()
+{
+    /* GLFW returns glfwGetProcAddress that defines the correct function based on which OS we're compiling for. */
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        throw std::runtime_error("::Failed to initialize GLAD");
+    }
+}
+
 void keyCallback(GLFWwindow* window, int key, int, int action, int)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
     if (key == GLFW_KEY_1 && action == GLFW_PRESS)
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        getGlStateCache().setPolygonMode(GL_LINE);
     if (key == GLFW_KEY_2 && action == GLFW_PRESS)
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        getGlStateCache().setPolygonMode(GL_FILL);
     if (key == GLFW_KEY_3 && action == GLFW_PRESS)
-        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        getGlStateCache().setPolygonMode(GL_POINT);
 }
 
 void mouseCallback(GLFWwindow* window, double x, double y)
@@ -61,6 +75,8 @@ GLFWwindow* createWindow(const char* windowName, bool isFullscreen, bool isBorde
         monitor = nullptr;
 
     GLFWwindow* window = glfwCreateWindow(width, height, windowName, monitor, nullptr);
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(window != nullptr, errorHandler, "::Failed to create GLFW window");
     //try {
     //    checkNotNull(window, (const char *&) "::Failed to create GLFW window");
     //}
@@ -78,12 +94,7 @@ GLFWwindow* createWindow(const char* windowName, bool isFullscreen, bool isBorde
 //    int egl_version = gladLoaderLoadEGL(display);
 //#else
 
-    /* GLFW returns glfwGetProcAddress that defines the correct function based on which OS we're compiling for. */
-    auto errorHandler = []() { glfwTerminate(); };
-    checkCondition(window != nullptr, errorHandler, "::Failed to create GLFW window");
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        throw std::exception("::Failed to initialize GLAD");
-    }
+    loadGLFunctions();
 //#endif
     setViewport(width, height);
 
@@ -92,5 +103,25 @@ GLFWwindow* createWindow(const char* windowName, bool isFullscreen, bool isBorde
     glfwSetCursorPosCallback(window, mouseCallback);
     glfwSwapInterval(1);
 
+    return window;
+}
+
+GLFWwindow* createHeadlessWindow(const char* windowName, int width, int height)                                          // Creates an invisible window whose context is only used to render into offscreen framebuffers.
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+
+    GLFWwindow* window = glfwCreateWindow(width, height, windowName, nullptr, nullptr);
+    auto errorHandler = []() { glfwTerminate(); };
+    checkCondition(window != nullptr, errorHandler, "::Failed to create headless GLFW window");
+
+    glfwMakeContextCurrent(window);
+    loadGLFunctions();
+    setViewport(width, height);
+
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSwapInterval(0);                                                                                                 // Nothing is presented, so nothing should wait for vertical sync either.
+
     return window;
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "image-decoder.hpp"
+#include "mapped-file.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const int linearToSrgbTableSize = 4096;
+
+bool decodeImage(const char* data, size_t size, ImageLevel& result)
+{
+    const unsigned char* signature = (const unsigned char*)data;
+    bool isJpeg = size >= 3 && signature[0] == 0xFF && signature[1] == 0xD8 && signature[2] == 0xFF;
+    bool isPng = size >= 8 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0;
+    if (isJpeg)
+        return decodeJpeg(data, size, result);
+    if (isPng)
+        return decodePng(data, size, result);
+    std::cout << "::Error: unknown image format" << std::endl;
+    return false;
+}
+
+bool decodeImageFile(const std::string& absolutePath, ImageLevel& result)
+{
+    MappedFile file;
+    if (!file.open(absolutePath))
+        return false;
+    if (decodeImage(file.getData(), file.getSize(), result))
+        return true;
+    std::cout << "::Error: failed to load image " << absolutePath << std::endl;
+    return false;
+}
+
+int getMipLevelCount(int width, int height)
+{
+    int levelCount = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2)
+        levelCount++;
+    return levelCount;
+}
+
+float getSrgbToLinear(unsigned char value)
+{
+    static const std::vector<float> table = []() {
+        std::vector<float> result(256);
+        for (int i = 0; i < 256; i++) {
+            float srgb = i / 255.0f;
+            result[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table[value];
+}
+
+unsigned char getLinearToSrgb(float value)
+{
+    static const std::vector<unsigned char> table = []() {
+        std::vector<unsigned char> result(linearToSrgbTableSize);
+        for (int i = 0; i < linearToSrgbTableSize; i++) {
+            float linear = (i + 0.5f) / linearToSrgbTableSize;
+            float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            result[i] = (unsigned char)std::lround(std::min(std::max(srgb, 0.0f), 1.0f) * 255.0f);
+        }
+        return result;
+    }();
+    return table[std::min((int)(value * linearToSrgbTableSize), linearToSrgbTableSize - 1)];
+}
+
+ImageLevel getNextMipLevel(const ImageLevel& level)                                                                       // Averages color in linear space, averaging sRGB values darkens the smaller levels.
+{
+    ImageLevel result;
+    result.width = std::max(level.width / 2, 1);
+    result.height = std::max(level.height / 2, 1);
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    for (int y = 0; y < result.height; y++) {
+        const unsigned char* rows[2] = { level.pixels.data() + (size_t)std::min(y * 2, level.height - 1) * level.width * 4,
+                                         level.pixels.data() + (size_t)std::min(y * 2 + 1, level.height - 1) * level.width * 4 };
+        unsigned char* target = result.pixels.data() + (size_t)y * result.width * 4;
+        for (int x = 0; x < result.width; x++) {
+            int columns[2] = { std::min(x * 2, level.width - 1) * 4, std::min(x * 2 + 1, level.width - 1) * 4 };
+            for (int channel = 0; channel < 4; channel++) {
+                float sum = 0.0f;
+                for (const unsigned char* row : rows)
+                    for (int column : columns)
+                        sum += channel == 3 ? row[column + channel] / 255.0f : getSrgbToLinear(row[column + channel]);
+                target[x * 4 + channel] = channel == 3 ? (unsigned char)std::lround(sum * 0.25f * 255.0f) : getLinearToSrgb(sum * 0.25f);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<ImageLevel> generateMipChain(ImageLevel&& image)
+{
+    std::vector<ImageLevel> levels;
+    levels.reserve(getMipLevelCount(image.width, image.height));
+    levels.push_back(std::move(image));
+    while (levels.back().width > 1 || levels.back().height > 1)
+        levels.push_back(getNextMipLevel(levels.back()));
+    return levels;
+}
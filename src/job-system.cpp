@@ -0,0 +1,287 @@
+#include "job-system.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+const int jobDequeCapacity = 4096;                                                                                       // Power of two. A worker whose deque is full runs the job right away.
+const int waitYieldCount = 16;                                                                                           // Failed findJob calls in waitForCounter before it sleeps.
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter* counter;
+};
+
+class JobDeque                                                                                                           // Chase-Lev, as in "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.). Fixed size, jobs outlive their slot.
+{
+private:
+    std::atomic<long long> top{ 0 };                                                                                     // Next job to steal.
+    std::atomic<long long> bottom{ 0 };                                                                                  // Next free slot, only the owner writes it.
+    std::atomic<Job*> jobs[jobDequeCapacity] = {};
+public:
+    bool push(Job* job)                                                                                                  // Owner only.
+    {
+        long long b = bottom.load(std::memory_order_relaxed);
+        long long t = top.load(std::memory_order_acquire);
+        if (b - t >= jobDequeCapacity)
+            return false;
+        jobs[b & (jobDequeCapacity - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Job* pop()                                                                                                           // Owner only, newest first.
+    {
+        long long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = jobs[b & (jobDequeCapacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {                                                                                                    // Last job, a thief may be taking it too.
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* steal()                                                                                                         // Any thread, oldest first.
+    {
+        long long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Job* job = jobs[t & (jobDequeCapacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;                                                                                              // Lost to the owner or another thief.
+        return job;
+    }
+};
+
+struct JobSystem
+{
+    std::vector<JobDeque*> deques;                                                                                       // Index 0 belongs to the main thread, worker i owns i + 1.
+    std::vector<std::thread> workers;
+    std::mutex sharedMutex;
+    std::deque<Job*> sharedJobs;                                                                                         // From threads without a deque.
+    std::atomic<int> sharedJobCount{ 0 };                                                                                // Of sharedJobs, checked before taking the mutex.
+    std::atomic<int> queuedJobCount{ 0 };                                                                                // In any deque or sharedJobs, lets idle workers sleep.
+    std::atomic<int> sleepingWorkerCount{ 0 };
+    std::atomic<int> waitingThreadCount{ 0 };                                                                            // Asleep in waitForCounter.
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::condition_variable waitCondition;                                                                               // Woken by every queued job and every counter reaching zero.
+    std::atomic<bool> isStopping{ false };
+};
+
+JobSystem* jobSystem = nullptr;
+thread_local int dequeIndex = -1;                                                                                        // Of the calling thread in jobSystem->deques, -1 when it has none.
+thread_local unsigned int stealSeed = 0;
+
+void executeJob(Job* job);
+
+void wakeWorker()
+{
+    if (jobSystem->sleepingWorkerCount.load() == 0 && jobSystem->waitingThreadCount.load() == 0)
+        return;
+    std::lock_guard<std::mutex> lock(jobSystem->sleepMutex);                                                             // A worker between checking for jobs and sleeping holds the mutex, so it cannot miss this.
+    jobSystem->sleepCondition.notify_one();
+    if (jobSystem->waitingThreadCount.load() > 0)                                                                        // A worker waiting inside a job may be the only thread left to run this one.
+        jobSystem->waitCondition.notify_all();
+}
+
+void wakeWaitingThreads()
+{
+    if (jobSystem == nullptr || jobSystem->waitingThreadCount.load() == 0)
+        return;
+    std::lock_guard<std::mutex> lock(jobSystem->sleepMutex);
+    jobSystem->waitCondition.notify_all();
+}
+
+void submitJob(Job* job)
+{
+    if (jobSystem == nullptr) {
+        executeJob(job);
+        return;
+    }
+    if (dequeIndex >= 0) {
+        if (!jobSystem->deques[dequeIndex]->push(job)) {
+            executeJob(job);
+            return;
+        }
+    }
+    else {
+        std::lock_guard<std::mutex> lock(jobSystem->sharedMutex);
+        jobSystem->sharedJobs.push_back(job);
+        jobSystem->sharedJobCount++;
+    }
+    jobSystem->queuedJobCount++;
+    wakeWorker();
+}
+
+Job* findJob()
+{
+    Job* job = dequeIndex >= 0 ? jobSystem->deques[dequeIndex]->pop() : nullptr;
+    if (job == nullptr && jobSystem->sharedJobCount.load() > 0) {
+        std::lock_guard<std::mutex> lock(jobSystem->sharedMutex);
+        if (!jobSystem->sharedJobs.empty()) {
+            job = jobSystem->sharedJobs.front();
+            jobSystem->sharedJobs.pop_front();
+            jobSystem->sharedJobCount--;
+        }
+    }
+    int dequeCount = jobSystem->deques.size();
+    stealSeed = stealSeed * 1664525u + 1013904223u;                                                                      // Random first victim, so thieves spread over the deques.
+    for (int i = 0; job == nullptr && i < dequeCount; i++) {
+        int victim = (stealSeed + i) % dequeCount;
+        if (victim != dequeIndex)
+            job = jobSystem->deques[victim]->steal();
+    }
+    if (job != nullptr)
+        jobSystem->queuedJobCount--;
+    return job;
+}
+
+void finishJob(Job* job)
+{
+    JobCounter* counter = job->counter;
+    delete job;
+    if (counter == nullptr)
+        return;
+    std::vector<Job*> continuations;
+    bool isCounterDone;
+    {
+        std::lock_guard<std::mutex> lock(counter->continuationMutex);                                                    // Decremented under it, so a waiter that saw zero cannot free the counter while this still uses it.
+        isCounterDone = --counter->value == 0;
+        if (isCounterDone)
+            continuations.swap(counter->continuations);
+    }
+    if (isCounterDone)
+        wakeWaitingThreads();
+    for (Job* continuation : continuations)
+        submitJob(continuation);
+}
+
+void executeJob(Job* job)
+{
+    job->function();
+    finishJob(job);
+}
+
+void runWorker(int index)
+{
+    dequeIndex = index;
+    stealSeed = index;
+    while (true) {
+        Job* job = findJob();
+        if (job != nullptr) {
+            executeJob(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(jobSystem->sleepMutex);
+        jobSystem->sleepingWorkerCount++;
+        jobSystem->sleepCondition.wait(lock, []() { return jobSystem->queuedJobCount.load() > 0 || jobSystem->isStopping.load(); });
+        jobSystem->sleepingWorkerCount--;
+        if (jobSystem->isStopping && jobSystem->queuedJobCount.load() == 0)
+            return;
+    }
+}
+
+void initJobSystem(int workerCount)
+{
+    if (workerCount <= 0)
+        workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+    jobSystem = new JobSystem();
+    for (int i = 0; i <= workerCount; i++)
+        jobSystem->deques.push_back(new JobDeque());
+    dequeIndex = 0;
+    for (int i = 0; i < workerCount; i++)
+        jobSystem->workers.emplace_back(runWorker, i + 1);
+}
+
+int getJobWorkerCount()
+{
+    return jobSystem != nullptr ? jobSystem->workers.size() : 0;
+}
+
+void runJob(std::function<void()> function, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->value++;
+    submitJob(new Job{ std::move(function), counter });
+}
+
+void runJobAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->value++;
+    Job* job = new Job{ std::move(function), counter };
+    {
+        std::lock_guard<std::mutex> lock(dependency.continuationMutex);                                                  // finishJob takes the continuations under it after the counter reached zero.
+        if (dependency.value.load() > 0) {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    submitJob(job);
+}
+
+void waitForCounter(JobCounter& counter)
+{
+    for (int failedFindCount = 0; !counter.isDone(); ) {
+        Job* job = jobSystem != nullptr ? findJob() : nullptr;
+        if (job != nullptr) {
+            executeJob(job);
+            failedFindCount = 0;
+        }
+        else if (jobSystem == nullptr || ++failedFindCount < waitYieldCount)
+            std::this_thread::yield();                                                                                   // The remaining jobs run on other threads and may finish any moment.
+        else {                                                                                                           // They take longer, sleep until one of them finishes or a new job is queued.
+            std::unique_lock<std::mutex> lock(jobSystem->sleepMutex);
+            jobSystem->waitingThreadCount++;
+            jobSystem->waitCondition.wait(lock, [&counter]() { return counter.isDone() || jobSystem->queuedJobCount.load() > 0; });
+            jobSystem->waitingThreadCount--;
+            failedFindCount = 0;
+        }
+    }
+    std::lock_guard<std::mutex> lock(counter.continuationMutex);                                                         // Until the last job let go of the counter.
+}
+
+void parallelFor(int count, int batchSize, const std::function<void(int begin, int end)>& function)
+{
+    batchSize = std::max(batchSize, 1);
+    if (jobSystem == nullptr || count <= batchSize) {
+        function(0, count);
+        return;
+    }
+    JobCounter counter;
+    for (int begin = batchSize; begin < count; begin += batchSize)                                                       // The first batch runs here.
+        runJob([&function, begin, count, batchSize]() { function(begin, std::min(begin + batchSize, count)); }, &counter);
+    function(0, batchSize);
+    waitForCounter(counter);
+}
+
+void deleteJobSystem()
+{
+    if (jobSystem == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(jobSystem->sleepMutex);
+        jobSystem->isStopping = true;
+    }
+    jobSystem->sleepCondition.notify_all();
+    for (std::thread& worker : jobSystem->workers)
+        worker.join();
+    for (JobDeque* deque : jobSystem->deques)
+        delete deque;
+    delete jobSystem;
+    jobSystem = nullptr;
+    dequeIndex = -1;
+}
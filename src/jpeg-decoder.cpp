@@ -0,0 +1,592 @@
+#include "image-decoder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+const int jpegMaxComponentCount = 3;
+const int jpegFastBitCount = 9;                                                                                          // Huffman codes up to this length decode with one table lookup.
+
+const unsigned char jpegZigzag[64 + 16] = {                                                                              // Natural order of the n-th coefficient. The padding absorbs runs past the end of corrupt blocks.
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+struct JpegHuffmanTable
+{
+    unsigned char fastLengths[1 << jpegFastBitCount] = {};                                                               // 0 when the code is longer than jpegFastBitCount.
+    unsigned char fastValues[1 << jpegFastBitCount] = {};
+    int codeEnds[17] = {};                                                                                               // One past the last code of each length.
+    int valueOffsets[17] = {};                                                                                           // Index of a code's value is code + valueOffsets[length].
+    unsigned char values[256] = {};
+};
+
+struct JpegComponent
+{
+    int id;
+    int horizontalSampling;
+    int verticalSampling;
+    int quantizationTable;
+    int dcTable;
+    int acTable;
+    int width;                                                                                                           // In samples, rounded up at subsampled edges.
+    int height;
+    int blocksPerLine;                                                                                                   // Of the coefficient storage, padded to whole MCUs.
+    int blocksPerColumn;
+    int dcPrediction;
+    std::vector<int16_t> coefficients;                                                                                   // 64 per block, zigzag undone.
+    std::vector<unsigned char> samples;                                                                                  // blocksPerLine * 8 per row once transformed.
+};
+
+class JpegBitReader                                                                                                      // Entropy-coded data MSB first, with stuffed 0xFF00 bytes removed. A marker ends the data, zeros are read past it.
+{
+private:
+    uint32_t buffer = 0;
+    int bitCount = 0;
+    bool isMarkerReached = false;
+
+    void fill()
+    {
+        while (bitCount <= 24) {
+            uint32_t byte = 0;
+            if (!isMarkerReached && position < size) {
+                byte = data[position];
+                if (byte == 0xFF && position + 1 < size && data[position + 1] != 0x00) {
+                    isMarkerReached = true;
+                    byte = 0;
+                }
+                else
+                    position += byte == 0xFF ? 2 : 1;
+            }
+            buffer |= byte << (24 - bitCount);
+            bitCount += 8;
+        }
+    }
+public:
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+
+    JpegBitReader(const unsigned char* data, size_t size, size_t position) : data(data), size(size), position(position) {}
+
+    uint32_t peek16()
+    {
+        fill();
+        return buffer >> 16;
+    }
+
+    void skip(int count)
+    {
+        buffer <<= count;
+        bitCount -= count;
+    }
+
+    int getBits(int count)
+    {
+        if (count == 0)
+            return 0;
+        fill();
+        int value = buffer >> (32 - count);
+        skip(count);
+        return value;
+    }
+
+    int receiveExtend(int count)                                                                                         // A count-bit magnitude category, negative values have a leading 0.
+    {
+        int value = getBits(count);
+        return count == 0 || value >= (1 << (count - 1)) ? value : value - (1 << count) + 1;
+    }
+
+    void restart()                                                                                                       // Drops the padding bits and steps over the RSTn marker.
+    {
+        buffer = 0;
+        bitCount = 0;
+        isMarkerReached = false;
+        if (position + 1 < size && data[position] == 0xFF && data[position + 1] >= 0xD0 && data[position + 1] <= 0xD7)
+            position += 2;
+    }
+};
+
+struct JpegDecoder
+{
+    const unsigned char* data;
+    size_t size;
+    size_t position = 0;
+    int width = 0;
+    int height = 0;
+    bool isProgressive = false;
+    bool isFrameRead = false;
+    bool isRgb = false;                                                                                                  // Adobe transform 0: the components are R, G, B rather than Y, Cb, Cr.
+    int maxHorizontalSampling = 1;
+    int maxVerticalSampling = 1;
+    int mcusPerLine = 0;
+    int mcusPerColumn = 0;
+    int restartInterval = 0;
+    int eobRun = 0;
+    uint16_t quantizationTables[4][64] = {};                                                                             // In zigzag order, as stored.
+    JpegHuffmanTable dcTables[4];
+    JpegHuffmanTable acTables[4];
+    std::vector<JpegComponent> components;
+    std::string error;
+};
+
+void buildHuffmanTable(JpegHuffmanTable& table, const unsigned char* counts, const unsigned char* values)                // Canonical codes: each length continues counting from the last code of the previous length, shifted left.
+{
+    table = JpegHuffmanTable();
+    int code = 0, valueIndex = 0;
+    for (int length = 1; length <= 16; length++) {
+        table.valueOffsets[length] = valueIndex - code;
+        for (int i = 0; i < counts[length - 1]; i++, code++, valueIndex++) {
+            table.values[valueIndex] = values[valueIndex];
+            if (length <= jpegFastBitCount)
+                for (int fill = code << (jpegFastBitCount - length); fill < (code + 1) << (jpegFastBitCount - length) && fill < (1 << jpegFastBitCount); fill++) {
+                    table.fastLengths[fill] = length;
+                    table.fastValues[fill] = values[valueIndex];
+                }
+        }
+        table.codeEnds[length] = code;
+        code <<= 1;
+    }
+}
+
+int decodeHuffman(JpegBitReader& reader, const JpegHuffmanTable& table)                                                  // -1 for a code the table does not have.
+{
+    uint32_t bits = reader.peek16();
+    int fastIndex = bits >> (16 - jpegFastBitCount);
+    if (table.fastLengths[fastIndex] != 0) {
+        reader.skip(table.fastLengths[fastIndex]);
+        return table.fastValues[fastIndex];
+    }
+    for (int length = jpegFastBitCount + 1; length <= 16; length++) {
+        int code = bits >> (16 - length);
+        if (code < table.codeEnds[length]) {
+            reader.skip(length);
+            return table.values[code + table.valueOffsets[length]];
+        }
+    }
+    return -1;
+}
+
+int readUint16(const unsigned char* data)
+{
+    return (data[0] << 8) | data[1];
+}
+
+bool readFrameHeader(JpegDecoder& decoder, const unsigned char* segment, int length)
+{
+    if (length < 6 || segment[0] != 8) {
+        decoder.error = "only 8-bit samples are supported";
+        return false;
+    }
+    decoder.height = readUint16(segment + 1);
+    decoder.width = readUint16(segment + 3);
+    int componentCount = segment[5];
+    if (decoder.width == 0 || decoder.height == 0 || length < 6 + componentCount * 3) {
+        decoder.error = "invalid frame header";
+        return false;
+    }
+    if (componentCount != 1 && componentCount != jpegMaxComponentCount) {
+        decoder.error = "only grayscale and 3-component images are supported, not CMYK";
+        return false;
+    }
+    decoder.components.resize(componentCount);
+    for (int i = 0; i < componentCount; i++) {
+        JpegComponent& component = decoder.components[i];
+        component.id = segment[6 + i * 3];
+        component.horizontalSampling = segment[7 + i * 3] >> 4;
+        component.verticalSampling = segment[7 + i * 3] & 15;
+        component.quantizationTable = segment[8 + i * 3] & 3;
+        if (component.horizontalSampling < 1 || component.horizontalSampling > 4 || component.verticalSampling < 1 || component.verticalSampling > 4) {
+            decoder.error = "invalid sampling factors";
+            return false;
+        }
+        decoder.maxHorizontalSampling = std::max(decoder.maxHorizontalSampling, component.horizontalSampling);
+        decoder.maxVerticalSampling = std::max(decoder.maxVerticalSampling, component.verticalSampling);
+    }
+    if (componentCount == 3 && decoder.components[0].id == 'R' && decoder.components[1].id == 'G' && decoder.components[2].id == 'B')
+        decoder.isRgb = true;
+
+    int mcuWidth = 8 * decoder.maxHorizontalSampling, mcuHeight = 8 * decoder.maxVerticalSampling;
+    decoder.mcusPerLine = (decoder.width + mcuWidth - 1) / mcuWidth;
+    decoder.mcusPerColumn = (decoder.height + mcuHeight - 1) / mcuHeight;
+    size_t codedBlockCount = 0;
+    for (JpegComponent& component : decoder.components) {
+        component.width = (decoder.width * component.horizontalSampling + decoder.maxHorizontalSampling - 1) / decoder.maxHorizontalSampling;
+        component.height = (decoder.height * component.verticalSampling + decoder.maxVerticalSampling - 1) / decoder.maxVerticalSampling;
+        codedBlockCount += (size_t)((component.width + 7) / 8) * ((component.height + 7) / 8);
+    }
+    if (codedBlockCount > decoder.size * 8) {                                                                            // Every block costs at least one Huffman coded bit, a corrupt header cannot ask for more.
+        decoder.error = "frame larger than the data could encode";
+        return false;
+    }
+    for (JpegComponent& component : decoder.components) {
+        component.blocksPerLine = decoder.mcusPerLine * component.horizontalSampling;
+        component.blocksPerColumn = decoder.mcusPerColumn * component.verticalSampling;
+        component.coefficients.assign((size_t)component.blocksPerLine * component.blocksPerColumn * 64, 0);
+    }
+    decoder.isFrameRead = true;
+    return true;
+}
+
+bool readHuffmanTables(JpegDecoder& decoder, const unsigned char* segment, int length)
+{
+    for (int offset = 0; offset < length; ) {
+        if (length - offset < 17) {
+            decoder.error = "truncated Huffman table";
+            return false;
+        }
+        int tableClass = segment[offset] >> 4, tableIndex = segment[offset] & 3;
+        const unsigned char* counts = segment + offset + 1;
+        int valueCount = 0;
+        for (int i = 0; i < 16; i++)
+            valueCount += counts[i];
+        if (tableClass > 1 || valueCount > 256 || length - offset < 17 + valueCount) {
+            decoder.error = "invalid Huffman table";
+            return false;
+        }
+        buildHuffmanTable(tableClass == 0 ? decoder.dcTables[tableIndex] : decoder.acTables[tableIndex], counts, segment + offset + 17);
+        offset += 17 + valueCount;
+    }
+    return true;
+}
+
+bool readQuantizationTables(JpegDecoder& decoder, const unsigned char* segment, int length)
+{
+    for (int offset = 0; offset < length; ) {
+        int precision = segment[offset] >> 4, tableIndex = segment[offset] & 3;
+        if (precision > 1 || length - offset < 1 + 64 * (precision + 1)) {
+            decoder.error = "invalid quantization table";
+            return false;
+        }
+        for (int i = 0; i < 64; i++)
+            decoder.quantizationTables[tableIndex][i] = precision == 0 ? segment[offset + 1 + i] : readUint16(segment + offset + 1 + i * 2);
+        offset += 1 + 64 * (precision + 1);
+    }
+    return true;
+}
+
+void decodeBlockBaseline(JpegDecoder& decoder, JpegBitReader& reader, JpegComponent& component, int16_t* block)
+{
+    int category = decodeHuffman(reader, decoder.dcTables[component.dcTable]);
+    component.dcPrediction += reader.receiveExtend(std::max(category, 0) & 15);
+    block[0] = (int16_t)component.dcPrediction;
+    for (int k = 1; k < 64; ) {
+        int runSize = decodeHuffman(reader, decoder.acTables[component.acTable]);
+        if (runSize < 0)
+            return;
+        int run = runSize >> 4, size = runSize & 15;
+        if (size == 0) {
+            if (run != 15)
+                return;                                                                                                  // End of block.
+            k += 16;
+            continue;
+        }
+        k += run;
+        block[jpegZigzag[std::min(k, 63)]] = (int16_t)reader.receiveExtend(size);
+        k++;
+    }
+}
+
+void decodeBlockProgressive(JpegDecoder& decoder, JpegBitReader& reader, JpegComponent& component, int16_t* block, int spectralStart,
+                            int spectralEnd, int approximationHigh, int approximationLow)                               // One scan's part of a block, following the refinement rules of ITU T.81 G.1.2.
+{
+    if (spectralStart == 0) {                                                                                            // DC scans never carry AC coefficients.
+        if (approximationHigh == 0) {
+            int category = decodeHuffman(reader, decoder.dcTables[component.dcTable]);
+            component.dcPrediction += reader.receiveExtend(std::max(category, 0) & 15);
+            block[0] = (int16_t)(component.dcPrediction * (1 << approximationLow));
+        }
+        else if (reader.getBits(1))
+            block[0] |= (int16_t)(1 << approximationLow);
+        return;
+    }
+
+    const JpegHuffmanTable& table = decoder.acTables[component.acTable];
+    if (approximationHigh == 0) {
+        if (decoder.eobRun > 0) {
+            decoder.eobRun--;
+            return;
+        }
+        for (int k = spectralStart; k <= spectralEnd; ) {
+            int runSize = decodeHuffman(reader, table);
+            if (runSize < 0)
+                return;
+            int run = runSize >> 4, size = runSize & 15;
+            if (size == 0) {
+                if (run < 15) {                                                                                          // This block and the next eobRun ones end here.
+                    decoder.eobRun = (1 << run) - 1 + reader.getBits(run);
+                    return;
+                }
+                k += 16;
+                continue;
+            }
+            k += run;
+            block[jpegZigzag[std::min(k, 63)]] = (int16_t)(reader.receiveExtend(size) * (1 << approximationLow));
+            k++;
+        }
+        return;
+    }
+
+    int positiveBit = 1 << approximationLow, negativeBit = -1 * (1 << approximationLow);
+    int k = spectralStart;
+    if (decoder.eobRun == 0) {
+        for (; k <= spectralEnd; k++) {
+            int runSize = decodeHuffman(reader, table);
+            if (runSize < 0)
+                return;
+            int run = runSize >> 4, size = runSize & 15, value = 0;
+            if (size == 0) {
+                if (run < 15) {
+                    decoder.eobRun = (1 << run) + reader.getBits(run);
+                    break;
+                }
+            }
+            else
+                value = reader.getBits(1) ? positiveBit : negativeBit;                                                  // A newly nonzero coefficient, always of magnitude 1 at this bit.
+            for (; k <= spectralEnd; k++) {                                                                              // Refines the nonzero coefficients passed on the way to the run-th zero one.
+                int16_t& coefficient = block[jpegZigzag[k]];
+                if (coefficient != 0) {
+                    if (reader.getBits(1) && (coefficient & positiveBit) == 0)
+                        coefficient += coefficient >= 0 ? positiveBit : negativeBit;
+                }
+                else if (run-- == 0)
+                    break;
+            }
+            if (value != 0 && k <= spectralEnd)
+                block[jpegZigzag[k]] = (int16_t)value;
+        }
+    }
+    if (decoder.eobRun > 0) {                                                                                            // The rest of the band only refines coefficients that are already nonzero.
+        for (; k <= spectralEnd; k++) {
+            int16_t& coefficient = block[jpegZigzag[k]];
+            if (coefficient != 0 && reader.getBits(1) && (coefficient & positiveBit) == 0)
+                coefficient += coefficient >= 0 ? positiveBit : negativeBit;
+        }
+        decoder.eobRun--;
+    }
+}
+
+bool decodeScan(JpegDecoder& decoder, const unsigned char* segment, int length)
+{
+    int componentCount = length > 0 ? segment[0] : 0;
+    if (!decoder.isFrameRead || componentCount < 1 || componentCount > (int)decoder.components.size() || length < 4 + componentCount * 2) {
+        decoder.error = "invalid scan header";
+        return false;
+    }
+    std::vector<JpegComponent*> scanComponents;
+    for (int i = 0; i < componentCount; i++) {
+        int id = segment[1 + i * 2];
+        auto component = std::find_if(decoder.components.begin(), decoder.components.end(), [id](const JpegComponent& c) { return c.id == id; });
+        if (component == decoder.components.end()) {
+            decoder.error = "scan of an unknown component";
+            return false;
+        }
+        component->dcTable = segment[2 + i * 2] >> 4 & 3;
+        component->acTable = segment[2 + i * 2] & 3;
+        component->dcPrediction = 0;
+        scanComponents.push_back(&*component);
+    }
+    const unsigned char* parameters = segment + 1 + componentCount * 2;
+    int spectralStart = parameters[0], spectralEnd = std::min((int)parameters[1], 63);
+    int approximationHigh = parameters[2] >> 4, approximationLow = parameters[2] & 15;
+    decoder.eobRun = 0;
+
+    JpegBitReader reader(decoder.data, decoder.size, decoder.position);
+    auto decodeBlock = [&](JpegComponent& component, int blockX, int blockY) {
+        int16_t* block = &component.coefficients[((size_t)blockY * component.blocksPerLine + blockX) * 64];
+        if (decoder.isProgressive)
+            decodeBlockProgressive(decoder, reader, component, block, spectralStart, spectralEnd, approximationHigh, approximationLow);
+        else
+            decodeBlockBaseline(decoder, reader, component, block);
+    };
+    auto restartIfDue = [&](int mcuIndex) {
+        if (decoder.restartInterval == 0 || mcuIndex == 0 || mcuIndex % decoder.restartInterval != 0)
+            return;
+        reader.restart();
+        decoder.eobRun = 0;
+        for (JpegComponent* component : scanComponents)
+            component->dcPrediction = 0;
+    };
+
+    if (componentCount == 1) {                                                                                           // Non-interleaved: MCUs are single blocks covering only the component's samples.
+        JpegComponent& component = *scanComponents[0];
+        int blocksPerLine = (component.width + 7) / 8, blocksPerColumn = (component.height + 7) / 8;
+        for (int blockY = 0, mcuIndex = 0; blockY < blocksPerColumn; blockY++)
+            for (int blockX = 0; blockX < blocksPerLine; blockX++, mcuIndex++) {
+                restartIfDue(mcuIndex);
+                decodeBlock(component, blockX, blockY);
+            }
+    }
+    else {
+        for (int mcuY = 0, mcuIndex = 0; mcuY < decoder.mcusPerColumn; mcuY++)
+            for (int mcuX = 0; mcuX < decoder.mcusPerLine; mcuX++, mcuIndex++) {
+                restartIfDue(mcuIndex);
+                for (JpegComponent* component : scanComponents)
+                    for (int y = 0; y < component->verticalSampling; y++)
+                        for (int x = 0; x < component->horizontalSampling; x++)
+                            decodeBlock(*component, mcuX * component->horizontalSampling + x, mcuY * component->verticalSampling + y);
+            }
+    }
+
+    decoder.position = reader.position;                                                                                  // Continues at the next marker that is not a restart marker.
+    while (decoder.position + 1 < decoder.size && !(decoder.data[decoder.position] == 0xFF && decoder.data[decoder.position + 1] != 0x00
+                                                     && (decoder.data[decoder.position + 1] < 0xD0 || decoder.data[decoder.position + 1] > 0xD7)))
+        decoder.position++;
+    return true;
+}
+
+void transformBlock(const int16_t* block, const uint16_t* quantizationTable, unsigned char* target, int targetStride)    // Dequantizes and applies the separable 8x8 inverse DCT.
+{
+    static const std::vector<float> cosines = []() {                                                                     // cosines[x * 8 + u] = C(u) / 2 * cos((2x + 1) u pi / 16).
+        std::vector<float> result(64);
+        for (int x = 0; x < 8; x++)
+            for (int u = 0; u < 8; u++)
+                result[x * 8 + u] = (u == 0 ? std::sqrt(0.5f) : 1.0f) * 0.5f * std::cos((2 * x + 1) * u * 3.14159265358979f / 16.0f);
+        return result;
+    }();
+    float coefficients[64], rows[64];
+    for (int i = 0; i < 64; i++)
+        coefficients[jpegZigzag[i]] = (float)block[jpegZigzag[i]] * quantizationTable[i];
+    for (int v = 0; v < 8; v++)                                                                                          // Rows: frequency u to sample x.
+        for (int x = 0; x < 8; x++) {
+            float sum = 0.0f;
+            for (int u = 0; u < 8; u++)
+                sum += cosines[x * 8 + u] * coefficients[v * 8 + u];
+            rows[v * 8 + x] = sum;
+        }
+    for (int y = 0; y < 8; y++)                                                                                          // Columns: frequency v to sample y.
+        for (int x = 0; x < 8; x++) {
+            float sum = 0.0f;
+            for (int v = 0; v < 8; v++)
+                sum += cosines[y * 8 + v] * rows[v * 8 + x];
+            target[y * targetStride + x] = (unsigned char)std::clamp((int)std::lround(sum + 128.0f), 0, 255);
+        }
+}
+
+float sampleComponent(const JpegComponent& component, float x, float y)                                                  // Bilinear between sample centers, which for 2x subsampling is the usual 3/4, 1/4 triangle filter.
+{
+    int stride = component.blocksPerLine * 8;
+    x = std::clamp(x, 0.0f, (float)(component.width - 1));
+    y = std::clamp(y, 0.0f, (float)(component.height - 1));
+    int x0 = (int)x, y0 = (int)y;
+    int x1 = std::min(x0 + 1, component.width - 1), y1 = std::min(y0 + 1, component.height - 1);
+    float fx = x - x0, fy = y - y0;
+    const unsigned char* samples = component.samples.data();
+    float top = samples[y0 * stride + x0] + (samples[y0 * stride + x1] - samples[y0 * stride + x0]) * fx;
+    float bottom = samples[y1 * stride + x0] + (samples[y1 * stride + x1] - samples[y1 * stride + x0]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+void writePixels(JpegDecoder& decoder, ImageLevel& result)
+{
+    for (JpegComponent& component : decoder.components) {
+        int stride = component.blocksPerLine * 8;
+        component.samples.resize((size_t)stride * component.blocksPerColumn * 8);
+        for (int blockY = 0; blockY < component.blocksPerColumn; blockY++)
+            for (int blockX = 0; blockX < component.blocksPerLine; blockX++)
+                transformBlock(&component.coefficients[((size_t)blockY * component.blocksPerLine + blockX) * 64],
+                               decoder.quantizationTables[component.quantizationTable], &component.samples[(size_t)blockY * 8 * stride + blockX * 8], stride);
+        component.coefficients.clear();
+        component.coefficients.shrink_to_fit();
+    }
+
+    result.width = decoder.width;
+    result.height = decoder.height;
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    for (int y = 0; y < decoder.height; y++) {
+        unsigned char* target = result.pixels.data() + (size_t)(decoder.height - 1 - y) * decoder.width * 4;             // Bottom row first.
+        for (int x = 0; x < decoder.width; x++) {
+            float values[jpegMaxComponentCount] = {};
+            for (size_t i = 0; i < decoder.components.size(); i++) {
+                const JpegComponent& component = decoder.components[i];
+                float scaleX = (float)component.horizontalSampling / decoder.maxHorizontalSampling;
+                float scaleY = (float)component.verticalSampling / decoder.maxVerticalSampling;
+                values[i] = sampleComponent(component, (x + 0.5f) * scaleX - 0.5f, (y + 0.5f) * scaleY - 0.5f);
+            }
+            float r = values[0], g = values[0], b = values[0];
+            if (decoder.components.size() == 3 && decoder.isRgb) {
+                g = values[1];
+                b = values[2];
+            }
+            else if (decoder.components.size() == 3) {                                                                   // JFIF YCbCr.
+                float cb = values[1] - 128.0f, cr = values[2] - 128.0f;
+                r = values[0] + 1.402f * cr;
+                g = values[0] - 0.344136f * cb - 0.714136f * cr;
+                b = values[0] + 1.772f * cb;
+            }
+            target[x * 4] = (unsigned char)std::clamp((int)std::lround(r), 0, 255);
+            target[x * 4 + 1] = (unsigned char)std::clamp((int)std::lround(g), 0, 255);
+            target[x * 4 + 2] = (unsigned char)std::clamp((int)std::lround(b), 0, 255);
+            target[x * 4 + 3] = 255;
+        }
+    }
+}
+
+bool decodeJpegMarkers(JpegDecoder& decoder)
+{
+    if (decoder.size < 4 || decoder.data[0] != 0xFF || decoder.data[1] != 0xD8) {
+        decoder.error = "no start of image marker";
+        return false;
+    }
+    decoder.position = 2;
+    while (true) {
+        while (decoder.position < decoder.size && decoder.data[decoder.position] != 0xFF)                                // Tolerates garbage between segments.
+            decoder.position++;
+        while (decoder.position < decoder.size && decoder.data[decoder.position] == 0xFF)                                // Fill bytes.
+            decoder.position++;
+        if (decoder.position >= decoder.size)
+            return decoder.isFrameRead;                                                                                  // A missing end of image marker is common enough to accept.
+        int marker = decoder.data[decoder.position++];
+        if (marker == 0xD9)
+            return decoder.isFrameRead;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))                                                        // No length.
+            continue;
+        if (decoder.position + 2 > decoder.size) {
+            decoder.error = "truncated segment";
+            return false;
+        }
+        int length = readUint16(decoder.data + decoder.position) - 2;
+        const unsigned char* segment = decoder.data + decoder.position + 2;
+        if (length < 0 || decoder.position + 2 + length > decoder.size) {
+            decoder.error = "truncated segment";
+            return false;
+        }
+        decoder.position += 2 + length;
+
+        bool isRead = true;
+        if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+            decoder.isProgressive = marker == 0xC2;
+            isRead = readFrameHeader(decoder, segment, length);
+        }
+        else if (marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            decoder.error = "lossless, hierarchical and arithmetic coded images are not supported";
+            return false;
+        }
+        else if (marker == 0xC4)
+            isRead = readHuffmanTables(decoder, segment, length);
+        else if (marker == 0xDB)
+            isRead = readQuantizationTables(decoder, segment, length);
+        else if (marker == 0xDD && length >= 2)
+            decoder.restartInterval = readUint16(segment);
+        else if (marker == 0xEE && length >= 12 && std::equal(segment, segment + 5, "Adobe"))
+            decoder.isRgb = segment[11] == 0;
+        else if (marker == 0xDA)
+            isRead = decodeScan(decoder, segment, length);
+        if (!isRead)
+            return false;
+    }
+}
+
+bool decodeJpeg(const char* data, size_t size, ImageLevel& result)
+{
+    JpegDecoder decoder;
+    decoder.data = (const unsigned char*)data;
+    decoder.size = size;
+    if (!decodeJpegMarkers(decoder)) {
+        std::cout << "::Error: failed to decode JPEG: " << (decoder.error.empty() ? "no frame" : decoder.error) << std::endl;
+        return false;
+    }
+    writePixels(decoder, result);
+    return true;
+}
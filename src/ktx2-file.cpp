@@ -0,0 +1,186 @@
+#include "ktx2-file.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+const size_t ktx2HeaderSize = 80;                                                                                        // Identifier, nine 32-bit fields and the index of the data blocks.
+const size_t ktx2LevelIndexEntrySize = 24;
+
+struct Ktx2FormatInfo
+{
+    uint32_t vkFormat;
+    unsigned char colorModel;                                                                                            // Of the data format descriptor.
+    int sampleCount;
+    unsigned char sampleChannels[4];
+};
+
+const Ktx2FormatInfo ktx2FormatInfos[blockFormatCount] = {
+    { 37, 1, 4, { 0, 1, 2, 15 } },                                                                                       // VK_FORMAT_R8G8B8A8_UNORM, KHR_DF_MODEL_RGBSDA.
+    { 131, 128, 1, { 0 } },                                                                                              // VK_FORMAT_BC1_RGB_UNORM_BLOCK, KHR_DF_MODEL_BC1A.
+    { 137, 130, 2, { 15, 0 } },                                                                                          // VK_FORMAT_BC3_UNORM_BLOCK, KHR_DF_MODEL_BC3, alpha block first.
+    { 141, 132, 2, { 0, 1 } },                                                                                           // VK_FORMAT_BC5_UNORM_BLOCK, KHR_DF_MODEL_BC5.
+    { 145, 134, 1, { 0 } }                                                                                               // VK_FORMAT_BC7_UNORM_BLOCK, KHR_DF_MODEL_BC7.
+};
+
+uint32_t readUint32(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+uint64_t readUint64(const unsigned char* data)
+{
+    return readUint32(data) | ((uint64_t)readUint32(data + 4) << 32);
+}
+
+void appendUint(std::vector<unsigned char>& data, uint64_t value, int byteCount)                                        // Little-endian, the byte order of every KTX2 field.
+{
+    for (int i = 0; i < byteCount; i++)
+        data.push_back((value >> (i * 8)) & 0xFF);
+}
+
+void writeUint(std::vector<unsigned char>& data, size_t offset, uint64_t value, int byteCount)
+{
+    for (int i = 0; i < byteCount; i++)
+        data[offset + i] = (value >> (i * 8)) & 0xFF;
+}
+
+void padTo(std::vector<unsigned char>& data, size_t alignment)
+{
+    data.resize((data.size() + alignment - 1) / alignment * alignment);
+}
+
+bool readKtx2(const char* data, size_t size, Ktx2Image& result)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (size < ktx2HeaderSize || memcmp(bytes, ktx2Identifier, sizeof(ktx2Identifier)) != 0) {
+        std::cout << "::Error: not a KTX2 file" << std::endl;
+        return false;
+    }
+    uint32_t vkFormat = readUint32(bytes + 12);
+    int width = readUint32(bytes + 20), height = readUint32(bytes + 24);
+    uint32_t depth = readUint32(bytes + 28), layerCount = readUint32(bytes + 32), faceCount = readUint32(bytes + 36);
+    uint32_t levelCount = std::max(readUint32(bytes + 40), 1u), supercompressionScheme = readUint32(bytes + 44);
+    const BlockFormatInfo* formatInfo = nullptr;
+    for (int format = 0; format < blockFormatCount; format++)
+        if (ktx2FormatInfos[format].vkFormat == vkFormat) {
+            result.format = (BlockFormat)format;
+            formatInfo = &getBlockFormatInfo(result.format);
+        }
+    if (formatInfo == nullptr) {
+        std::cout << "::Error: KTX2 Vulkan format " << vkFormat << " is not supported" << std::endl;
+        return false;
+    }
+    if (width <= 0 || height <= 0 || depth != 0 || layerCount > 1 || faceCount != 1 || supercompressionScheme != 0) {
+        std::cout << "::Error: only plain 2D KTX2 textures without supercompression are supported" << std::endl;
+        return false;
+    }
+    if (levelCount > 32 || size < ktx2HeaderSize + levelCount * ktx2LevelIndexEntrySize) {
+        std::cout << "::Error: KTX2 level index is truncated" << std::endl;
+        return false;
+    }
+
+    result.levels.clear();
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const unsigned char* entry = bytes + ktx2HeaderSize + level * ktx2LevelIndexEntrySize;
+        uint64_t offset = readUint64(entry), length = readUint64(entry + 8);
+        Ktx2Level levelData;
+        levelData.width = std::max(width >> level, 1);
+        levelData.height = std::max(height >> level, 1);
+        levelData.size = getCompressedSize(result.format, levelData.width, levelData.height);
+        if (offset > size || length > size - offset || length < levelData.size) {
+            std::cout << "::Error: KTX2 level " << level << " lies outside the file or is too short" << std::endl;
+            return false;
+        }
+        levelData.data = bytes + offset;
+        result.levels.push_back(levelData);
+    }
+    return true;
+}
+
+void appendDataFormatDescriptor(std::vector<unsigned char>& data, BlockFormat format)                                   // A basic descriptor block, what a KTX2 reader needs besides vkFormat to interpret the texels.
+{
+    const Ktx2FormatInfo& ktx2Info = ktx2FormatInfos[format];
+    const BlockFormatInfo& info = getBlockFormatInfo(format);
+    const int bitsPerSample = info.blockBytes * 8 / ktx2Info.sampleCount;
+    uint32_t blockSize = 24 + 16 * ktx2Info.sampleCount;
+    appendUint(data, 4 + blockSize, 4);                                                                                  // dfdTotalSize.
+    appendUint(data, 0, 4);                                                                                              // Khronos vendor, basic descriptor type.
+    appendUint(data, 2 | (blockSize << 16), 4);                                                                          // Version 1.3 and the block size.
+    data.push_back(ktx2Info.colorModel);
+    data.push_back(1);                                                                                                   // BT.709 primaries.
+    data.push_back(1);                                                                                                   // Linear transfer, UNORM formats do not decode sRGB.
+    data.push_back(0);                                                                                                   // Straight alpha.
+    for (int dimension = 0; dimension < 4; dimension++)
+        data.push_back(dimension < 2 ? info.blockSize - 1 : 0);
+    appendUint(data, info.blockBytes, 8);                                                                                // Bytes of plane 0, the other planes are unused.
+    for (int sample = 0; sample < ktx2Info.sampleCount; sample++) {
+        appendUint(data, sample * bitsPerSample, 2);
+        data.push_back(bitsPerSample - 1);
+        data.push_back(ktx2Info.sampleChannels[sample]);
+        appendUint(data, 0, 4);                                                                                          // Sample position.
+        appendUint(data, 0, 4);
+        appendUint(data, bitsPerSample == 8 ? 255 : 0xFFFFFFFF, 4);
+    }
+}
+
+void appendKeyValue(std::vector<unsigned char>& data, const std::string& key, const std::string& value)
+{
+    appendUint(data, key.size() + value.size() + 2, 4);
+    data.insert(data.end(), key.begin(), key.end());
+    data.push_back(0);
+    data.insert(data.end(), value.begin(), value.end());
+    data.push_back(0);
+    padTo(data, 4);
+}
+
+bool writeKtx2File(const std::string& path, BlockFormat format, const std::vector<ImageLevel>& levels)
+{
+    std::vector<unsigned char> data(ktx2Identifier, ktx2Identifier + sizeof(ktx2Identifier));
+    appendUint(data, ktx2FormatInfos[format].vkFormat, 4);
+    appendUint(data, 1, 4);                                                                                              // typeSize, 1 for bytes and blocks.
+    appendUint(data, levels[0].width, 4);
+    appendUint(data, levels[0].height, 4);
+    appendUint(data, 0, 4);                                                                                              // Depth, layer count.
+    appendUint(data, 0, 4);
+    appendUint(data, 1, 4);                                                                                              // Face count.
+    appendUint(data, levels.size(), 4);
+    appendUint(data, 0, 4);                                                                                              // No supercompression.
+    size_t indexOffset = data.size();
+    data.resize(ktx2HeaderSize + levels.size() * ktx2LevelIndexEntrySize);
+
+    size_t descriptorOffset = data.size();
+    appendDataFormatDescriptor(data, format);
+    size_t keyValueOffset = data.size();
+    appendKeyValue(data, "KTXorientation", "ru");                                                                        // Keys sorted, as the format requires.
+    appendKeyValue(data, "KTXwriter", "ENginger texconv");
+    writeUint(data, indexOffset, descriptorOffset, 4);
+    writeUint(data, indexOffset + 4, keyValueOffset - descriptorOffset, 4);
+    writeUint(data, indexOffset + 8, keyValueOffset, 4);
+    writeUint(data, indexOffset + 12, data.size() - keyValueOffset, 4);
+
+    size_t levelAlignment = getBlockFormatInfo(format).blockBytes;                                                       // lcm(block bytes, 4), a multiple of 4 for every format here.
+    for (int level = (int)levels.size() - 1; level >= 0; level--) {                                                      // Smallest level first, so a partial read gets a usable chain.
+        padTo(data, levelAlignment);
+        size_t entryOffset = ktx2HeaderSize + level * ktx2LevelIndexEntrySize;
+        writeUint(data, entryOffset, data.size(), 8);
+        writeUint(data, entryOffset + 8, levels[level].pixels.size(), 8);
+        writeUint(data, entryOffset + 16, levels[level].pixels.size(), 8);
+        data.insert(data.end(), levels[level].pixels.begin(), levels[level].pixels.end());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)data.data(), data.size());
+    if (!file) {
+        std::cout << "::Error: failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool isKtx2Path(const std::string& path)
+{
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".ktx2") == 0;
+}
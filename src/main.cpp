@@ -1,8 +1,19 @@
 #include "glfw-utils.hpp"
 #include "filesystem-utils.hpp"
 #include "renderer.hpp"
+#include "mesh-optimizer.hpp"
+#include "geometry-pool.hpp"
 #include "shader-program.hpp"
+#include "shader-loader.hpp"
+#include "shader-watcher.hpp"
+#include "profiler.hpp"
+#include "gl-state-cache.hpp"
+#include "uniform-buffer.hpp"
+#include "texture-manager.hpp"
+#include "job-system.hpp"
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 /* vertices within Normalized Device Coordinates (NDC) range
 Unlike usual screen coordinates the positive y-axis points in the up-direction and the (0,0) coordinates are at the center of the graph, 
@@ -18,10 +29,10 @@ std::vector<Vertex> getVertices()
     Position rightBottom = Position(right, bottom);
     Position leftTop = Position(left, top);
     Position rightTop = Position(right, top);
-    Vertex vertex1 = Vertex(leftBottom, Color::magenta(), UV(), Position());
-    Vertex vertex2 = Vertex(rightBottom, Color::cyan(), UV(), Position());
-    Vertex vertex3 = Vertex(leftTop, Color::yellow(), UV(), Position());
-    Vertex vertex4 = Vertex(rightTop, Color::white(), UV(), Position());
+    Vertex vertex1 = Vertex(leftBottom, Color::magenta(), UV(0.0f, 0.0f), Position());
+    Vertex vertex2 = Vertex(rightBottom, Color::cyan(), UV(1.0f, 0.0f), Position());
+    Vertex vertex3 = Vertex(leftTop, Color::yellow(), UV(0.0f, 1.0f), Position());
+    Vertex vertex4 = Vertex(rightTop, Color::white(), UV(1.0f, 1.0f), Position());
     return std::vector<Vertex> { vertex1, vertex2, vertex3, vertex4 };
 }
 
@@ -44,24 +55,85 @@ int main(int, char*[])
             );
     auto errorHandler = []() { glfwTerminate(); };
     checkCondition(window != nullptr, errorHandler, "::Failed to create GLFW window");
+    initJobSystem(configData.workerThreadCount);
 
-    VertexArrayData vertexArrayData = getVertexArrayData(vertices, indices);
+    optimizeMesh(vertices, indices);
+    GeometryPool geometryPool = createGeometryPool<Vertex>(vertices.size(), indices.size());                             // Static meshes share one VAO, VBO and EBO and are drawn by base vertex.
+    MeshAllocation meshAllocation = geometryPool.allocate(vertices, indices);
     std::string vertexShaderPath = getShaderAbsolutePath(GL_VERTEX_SHADER, configData.vertexShader);
     std::string fragmentShaderPath = getShaderAbsolutePath(GL_FRAGMENT_SHADER, configData.fragmentShader);
-    ShaderProgram shaderProgram = ShaderProgram(vertexShaderPath, fragmentShaderPath);
-    checkCondition(shaderProgram.ID != 0, errorHandler, "Failed to create shader program.");
-    glUseProgram(shaderProgram.ID);
+    ShaderLoader shaderLoader;
+    ShaderDefines shaderDefines = { { "TEXTURED", "" } };
+    ShaderProgramHandle shaderProgramHandle = shaderLoader.load(vertexShaderPath, fragmentShaderPath, shaderDefines);                   // Further programs would be submitted here too, before waiting on any of them.
+    shaderLoader.waitAll();
+    checkCondition(shaderLoader.getState(shaderProgramHandle) == shaderLoadReady, errorHandler, "Failed to create shader program.");
+    ShaderProgram& shaderProgram = *shaderLoader.getProgram(shaderProgramHandle);
+    ShaderWatcher shaderWatcher;
+    if (configData.isShaderHotReloadEnabled)
+        shaderWatcher.watch(&shaderProgram, vertexShaderPath, fragmentShaderPath, shaderDefines);
+    shaderProgram.use();
+    shaderProgram.setInt("albedo", 0);
+    validateUniformBlock(shaderProgram.ID, frameUniformBinding, sizeof(FrameUniforms));
+    validateUniformBlock(shaderProgram.ID, materialUniformBinding, sizeof(MaterialUniforms));
 
+    FrameUniformBuffer frameUniformBuffer;
+    UniformBlockArena materialArena(sizeof(MaterialUniforms), 64);
+    MaterialUniforms defaultMaterial = { Color::white(), {} };
+    UniformBlockHandle defaultMaterialHandle = materialArena.allocate(&defaultMaterial);
+    materialArena.bind(defaultMaterialHandle, materialUniformBinding);
+    TextureManager textureManager(2, (GLsizeiptr)configData.textureMemoryBudgetMB << 20);                                // Decodes on its own threads, the quad is white until the first mips arrive.
+    TextureHandle albedoTexture = textureManager.load(getTextureAbsolutePath("seamless.jpg"));
+    GLfloat lastFrameTime = glfwGetTime();
+    if (!configData.profilerTracePath.empty())
+        initProfiler();
+
+#ifdef _WIN32
     ShowWindow(GetConsoleWindow(), SW_HIDE);
+#endif
     while (!glfwWindowShouldClose(window)) {
-        clearAllBuffers();
-        draw(shaderProgram.ID, *vertexArrayData.boundVAO, indices.size());
-        glfwPollEvents();                                                                                                // This function processes only those events that are already in the event queue and then returns immediately. Processing events will cause the window and input callbacks associated with those events to be called.
-        glfwSwapBuffers(window);                                                                                         // Swaps the front and back buffers of the specified window that are used to prevent screen tearing.
+        beginProfilerFrame();
+        shaderWatcher.update();
+        textureManager.update();
+        {
+            PROFILE_ZONE("clearAllBuffers");
+            clearAllBuffers();
+        }
+        {
+            PROFILE_ZONE("draw");
+            GLfloat time = glfwGetTime();
+            frameUniformBuffer.update(getFrameUniforms(Matrix4::identity(), Matrix4::identity(), configData.width, configData.height, time, time - lastFrameTime));
+            lastFrameTime = time;
+            textureManager.bind(albedoTexture, 0);
+            geometryPool.draw(shaderProgram.ID, meshAllocation);
+        }
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();                                                                                            // This function processes only those events that are already in the event queue and then returns immediately. Processing events will cause the window and input callbacks associated with those events to be called.
+        }
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);                                                                                     // Swaps the front and back buffers of the specified window that are used to prevent screen tearing.
+        }
+        frameUniformBuffer.endFrame();
+        endProfilerFrame();
+        if (isProfilerEnabled()) {
+            getGlStateCache().reportStats();
+            getGlStateCache().resetStats();
+        }
     }
+#ifdef _WIN32
     ShowWindow(GetConsoleWindow(), SW_RESTORE);
+#endif
 
-    cleanGlResources(vertexArrayData, shaderProgram.ID);
+    writeChromeTrace(configData.profilerTracePath);
+    deleteProfiler();
+    frameUniformBuffer.deleteFrameUniformBuffer();
+    materialArena.deleteUniformBlockArena();
+    textureManager.deleteTextureManager();
+    geometryPool.deleteGeometryPool();
+    shaderWatcher.deleteShaderWatcher();
+    shaderLoader.deleteShaderLoader();
+    deleteJobSystem();
     glfwDestroyWindow(window);
     glfwTerminate();
     deletePath();
@@ -0,0 +1,87 @@
+#include "mapped-file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char emptyFileData[1] = "";                                                                                        // Zero-length files cannot be mapped, they point here instead.
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,    // Shared write and delete access, so editors can still save over a mapped shader.
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER fileSize;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+        std::cout << "::Error: failed to open " << path << " (error " << GetLastError() << ")" << std::endl;
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        return false;
+    }
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        data = emptyFileData;
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        std::cout << "::Error: failed to map " << path << " (error " << GetLastError() << ")" << std::endl;
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const char*)view;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat fileStatus;
+    if (file < 0 || fstat(file, &fileStatus) != 0) {
+        std::cout << "::Error: failed to open " << path << ": " << strerror(errno) << std::endl;
+        if (file >= 0)
+            ::close(file);
+        return false;
+    }
+    if (fileStatus.st_size == 0) {
+        ::close(file);
+        data = emptyFileData;
+        return true;
+    }
+    void* mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);                                                                                                       // The mapping keeps its own reference to the file.
+    if (mapping == MAP_FAILED) {
+        std::cout << "::Error: failed to map " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    data = (const char*)mapping;
+    size = fileStatus.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data != nullptr && size > 0) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        mappingHandle = fileHandle = nullptr;
+#else
+        munmap((void*)data, size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,282 @@
+#include "mesh-optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
+
+const GLuint unusedVertex = ~0u;
+
+struct VertexBytesHash                                                                                                   // Hashes and compares vertices by index into an array, so the set stores indices only.
+{
+    const Vertex* vertices;
+
+    size_t operator()(GLuint index) const
+    {
+        const unsigned char* bytes = (const unsigned char*)&vertices[index];
+        uint64_t hash = 14695981039346656037ull;                                                                         // FNV-1a.
+        for (size_t i = 0; i < sizeof(Vertex); i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+};
+
+struct VertexBytesEqual
+{
+    const Vertex* vertices;
+
+    bool operator()(GLuint a, GLuint b) const { return memcmp(&vertices[a], &vertices[b], sizeof(Vertex)) == 0; }
+};
+
+void remapMesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices, const std::vector<GLuint>& remap, int newVertexCount)
+{
+    std::vector<Vertex> remappedVertices(newVertexCount, vertices.empty() ? Vertex(Position(), Color(), UV(), Position()) : vertices[0]);
+    for (size_t i = 0; i < vertices.size(); i++)
+        if (remap[i] != unusedVertex)
+            remappedVertices[remap[i]] = vertices[i];
+    for (GLuint& index : indices)
+        index = remap[index];
+    vertices = std::move(remappedVertices);
+}
+
+int deduplicateVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    std::unordered_set<GLuint, VertexBytesHash, VertexBytesEqual> uniqueVertices(vertices.size(), VertexBytesHash{ vertices.data() },
+                                                                                 VertexBytesEqual{ vertices.data() });
+    std::vector<GLuint> remap(vertices.size());
+    std::vector<GLuint> uniqueRemap(vertices.size(), unusedVertex);                                                      // New index of each entry of uniqueVertices, by old index.
+    int vertexCount = 0;
+    for (GLuint i = 0; i < vertices.size(); i++) {
+        auto inserted = uniqueVertices.insert(i);
+        if (inserted.second)
+            uniqueRemap[i] = vertexCount++;
+        remap[i] = uniqueRemap[*inserted.first];
+    }
+    remapMesh(vertices, indices, remap, vertexCount);
+    return vertexCount;
+}
+
+GLfloat getForsythVertexScore(int cachePosition, int remainingTriangleCount)
+{
+    if (remainingTriangleCount == 0)
+        return -1.0f;
+    GLfloat score = 0.0f;
+    if (cachePosition >= 0)
+        score = cachePosition < 3 ? 0.75f                                                                                // The last triangle's three vertices score the same, whatever order they were used in.
+                                  : std::pow(1.0f - (cachePosition - 3) * (1.0f / (vertexCacheSize - 3)), 1.5f);
+    return score + 2.0f / std::sqrt((GLfloat)remainingTriangleCount);                                                   // Vertices with few triangles left are finished first, so they leave the cache for good.
+}
+
+void optimizeVertexCache(std::vector<GLuint>& indices, int vertexCount)
+{
+    int triangleCount = indices.size() / 3;
+    std::vector<int> remainingTriangleCounts(vertexCount, 0);
+    for (GLuint index : indices)
+        remainingTriangleCounts[index]++;
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);                                                               // Triangles of vertex v are adjacency[offsets[v], offsets[v] + remaining[v]).
+    for (int vertex = 0; vertex < vertexCount; vertex++)
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + remainingTriangleCounts[vertex];
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (int triangle = 0; triangle < triangleCount; triangle++)
+        for (int corner = 0; corner < 3; corner++)
+            adjacency[adjacencyCursors[indices[triangle * 3 + corner]]++] = triangle;
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<GLfloat> vertexScores(vertexCount);
+    for (int vertex = 0; vertex < vertexCount; vertex++)
+        vertexScores[vertex] = getForsythVertexScore(-1, remainingTriangleCounts[vertex]);
+    std::vector<GLfloat> triangleScores(triangleCount);
+    std::vector<bool> isEmitted(triangleCount, false);
+    int bestTriangle = -1;
+    for (int triangle = 0; triangle < triangleCount; triangle++) {
+        triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+        if (bestTriangle < 0 || triangleScores[triangle] > triangleScores[bestTriangle])
+            bestTriangle = triangle;
+    }
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    std::vector<GLuint> cache, newCache;
+    int nextUnemittedTriangle = 0;
+    while (bestTriangle >= 0) {
+        const GLuint* corners = &indices[bestTriangle * 3];
+        result.insert(result.end(), corners, corners + 3);
+        isEmitted[bestTriangle] = true;
+
+        newCache.assign(corners, corners + 3);
+        for (int corner = 0; corner < 3; corner++) {
+            GLuint vertex = corners[corner];
+            int* triangles = &adjacency[adjacencyOffsets[vertex]];
+            int* last = triangles + --remainingTriangleCounts[vertex];
+            std::iter_swap(std::find(triangles, last + 1, bestTriangle), last);
+        }
+        for (GLuint vertex : cache)
+            if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+                newCache.push_back(vertex);
+
+        for (size_t position = 0; position < newCache.size(); position++) {                                             // Entries past vertexCacheSize were just evicted.
+            GLuint vertex = newCache[position];
+            cachePositions[vertex] = position < (size_t)vertexCacheSize ? (int)position : -1;
+            vertexScores[vertex] = getForsythVertexScore(cachePositions[vertex], remainingTriangleCounts[vertex]);
+        }
+
+        bestTriangle = -1;
+        for (GLuint vertex : newCache) {                                                                                 // Only triangles touching the cache changed score, the best one is among them.
+            for (int i = 0; i < remainingTriangleCounts[vertex]; i++) {
+                int triangle = adjacency[adjacencyOffsets[vertex] + i];
+                triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]]
+                                         + vertexScores[indices[triangle * 3 + 2]];
+                if (bestTriangle < 0 || triangleScores[triangle] > triangleScores[bestTriangle])
+                    bestTriangle = triangle;
+            }
+        }
+        if (newCache.size() > (size_t)vertexCacheSize)
+            newCache.resize(vertexCacheSize);
+        std::swap(cache, newCache);
+
+        if (bestTriangle < 0) {                                                                                          // Nothing left around the cache, continue with the next disconnected part.
+            while (nextUnemittedTriangle < triangleCount && isEmitted[nextUnemittedTriangle])
+                nextUnemittedTriangle++;
+            if (nextUnemittedTriangle < triangleCount)
+                bestTriangle = nextUnemittedTriangle;
+        }
+    }
+    indices = std::move(result);
+}
+
+class FifoCacheSimulation                                                                                                // Counts the vertex shader invocations of a FIFO post-transform cache.
+{
+private:
+    std::vector<unsigned> insertTimes;
+    unsigned time;
+    int cacheSize;
+public:
+    FifoCacheSimulation(int vertexCount, int cacheSize) : insertTimes(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {}
+
+    int addTriangle(const GLuint* corners)                                                                               // Returns the number of misses.
+    {
+        int missCount = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            if (time - insertTimes[corners[corner]] > (unsigned)cacheSize) {
+                insertTimes[corners[corner]] = time++;
+                missCount++;
+            }
+        }
+        return missCount;
+    }
+
+    void clear() { time += cacheSize + 1; }
+};
+
+GLfloat getAverageCacheMissRatio(const std::vector<GLuint>& indices, int vertexCount, int cacheSize)
+{
+    if (indices.empty())
+        return 0.0f;
+    FifoCacheSimulation cache(vertexCount, cacheSize);
+    int missCount = 0;
+    for (size_t i = 0; i < indices.size(); i += 3)
+        missCount += cache.addTriangle(&indices[i]);
+    return (GLfloat)missCount / (indices.size() / 3);
+}
+
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, GLfloat threshold)
+{
+    const int simulatedCacheSize = 16;
+    int triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    std::vector<int> hardClusters;                                                                                       // A triangle missing the cache with all three vertices starts a disjoint patch.
+    FifoCacheSimulation cache(vertices.size(), simulatedCacheSize);
+    for (int triangle = 0; triangle < triangleCount; triangle++)
+        if (cache.addTriangle(&indices[triangle * 3]) == 3 || triangle == 0)
+            hardClusters.push_back(triangle);
+    hardClusters.push_back(triangleCount);
+
+    std::vector<int> clusters;                                                                                           // Hard clusters split further wherever the ACMR so far stays within threshold of the whole cluster's.
+    for (size_t hardCluster = 0; hardCluster + 1 < hardClusters.size(); hardCluster++) {
+        int start = hardClusters[hardCluster], end = hardClusters[hardCluster + 1];
+        cache.clear();
+        int clusterMissCount = 0;
+        for (int triangle = start; triangle < end; triangle++)
+            clusterMissCount += cache.addTriangle(&indices[triangle * 3]);
+        GLfloat maxMissRatio = threshold * clusterMissCount / (end - start);
+
+        cache.clear();
+        int clusterStart = start, missCount = 0;
+        clusters.push_back(start);
+        for (int triangle = start; triangle < end - 1; triangle++) {
+            missCount += cache.addTriangle(&indices[triangle * 3]);
+            if ((GLfloat)missCount / (triangle - clusterStart + 1) <= maxMissRatio) {
+                clusters.push_back(triangle + 1);
+                clusterStart = triangle + 1;
+                missCount = 0;
+                cache.clear();                                                                                           // The next cluster may be drawn anywhere, so it cannot count on this one's vertices.
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    auto getPosition = [&](GLuint index) { return vertices[index].position; };
+    Position meshCentroid;
+    GLfloat meshArea = 0.0f;
+    std::vector<Position> clusterCentroids(clusters.size() - 1), clusterNormals(clusters.size() - 1);
+    for (size_t cluster = 0; cluster + 1 < clusters.size(); cluster++) {
+        Position centroid, normal;
+        GLfloat area = 0.0f;
+        for (int triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++) {
+            Position a = getPosition(indices[triangle * 3]), b = getPosition(indices[triangle * 3 + 1]), c = getPosition(indices[triangle * 3 + 2]);
+            Position edge1(b.x - a.x, b.y - a.y, b.z - a.z), edge2(c.x - a.x, c.y - a.y, c.z - a.z);
+            Position triangleNormal(edge1.y * edge2.z - edge1.z * edge2.y, edge1.z * edge2.x - edge1.x * edge2.z, edge1.x * edge2.y - edge1.y * edge2.x);
+            GLfloat triangleArea = std::sqrt(triangleNormal.x * triangleNormal.x + triangleNormal.y * triangleNormal.y + triangleNormal.z * triangleNormal.z);
+            centroid = Position(centroid.x + (a.x + b.x + c.x) / 3.0f * triangleArea, centroid.y + (a.y + b.y + c.y) / 3.0f * triangleArea,
+                                centroid.z + (a.z + b.z + c.z) / 3.0f * triangleArea);
+            normal = Position(normal.x + triangleNormal.x, normal.y + triangleNormal.y, normal.z + triangleNormal.z);      // Unnormalized, so larger triangles weigh more.
+            area += triangleArea;
+        }
+        meshCentroid = Position(meshCentroid.x + centroid.x, meshCentroid.y + centroid.y, meshCentroid.z + centroid.z);
+        meshArea += area;
+        clusterCentroids[cluster] = area > 0.0f ? Position(centroid.x / area, centroid.y / area, centroid.z / area) : getPosition(indices[clusters[cluster] * 3]);
+        clusterNormals[cluster] = normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid = Position(meshCentroid.x / meshArea, meshCentroid.y / meshArea, meshCentroid.z / meshArea);
+
+    std::vector<GLfloat> sortKeys(clusters.size() - 1);                                                                  // How far a cluster faces away from the mesh center: those occlude the rest, so they are drawn first.
+    for (size_t cluster = 0; cluster < sortKeys.size(); cluster++) {
+        const Position& centroid = clusterCentroids[cluster];
+        const Position& normal = clusterNormals[cluster];
+        GLfloat normalLength = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        sortKeys[cluster] = normalLength > 0.0f ? ((centroid.x - meshCentroid.x) * normal.x + (centroid.y - meshCentroid.y) * normal.y
+                                                   + (centroid.z - meshCentroid.z) * normal.z) / normalLength : 0.0f;
+    }
+    std::vector<int> clusterOrder(sortKeys.size());
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](int a, int b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    for (int cluster : clusterOrder)
+        result.insert(result.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+    indices = std::move(result);
+}
+
+int optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    std::vector<GLuint> remap(vertices.size(), unusedVertex);
+    int vertexCount = 0;
+    for (GLuint index : indices)
+        if (remap[index] == unusedVertex)
+            remap[index] = vertexCount++;
+    remapMesh(vertices, indices, remap, vertexCount);
+    return vertexCount;
+}
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+    int vertexCount = deduplicateVertices(vertices, indices);
+    optimizeVertexCache(indices, vertexCount);
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+}
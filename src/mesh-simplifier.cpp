@@ -0,0 +1,316 @@
+#include "mesh-simplifier.hpp"
+#include "mesh-optimizer.hpp"
+#include "gl-state-cache.hpp"
+#include "geometry/vertex-packing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+const double borderQuadricWeight = 10.0;                                                                                 // How strongly borders resist moving away from their original line.
+const double borderCornerCosine = 0.9998;                                                                                // Border edges turning by more than about 1 degree meet at a corner.
+
+struct Quadric                                                                                                           // Sum of squared distances to a set of planes, the upper triangle of a symmetric 4x4 matrix.
+{
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(double a, double b, double c, double d, double weight)                                      // Plane ax + by + cz + d = 0 with a unit normal.
+    {
+        Quadric quadric;
+        quadric.a2 = a * a * weight; quadric.ab = a * b * weight; quadric.ac = a * c * weight; quadric.ad = a * d * weight;
+        quadric.b2 = b * b * weight; quadric.bc = b * c * weight; quadric.bd = b * d * weight;
+        quadric.c2 = c * c * weight; quadric.cd = c * d * weight;
+        quadric.d2 = d * d * weight;
+        quadric.weight = weight;
+        return quadric;
+    }
+
+    void add(const Quadric& other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+    }
+
+    double getError(const Position& p) const                                                                             // Weighted mean squared distance of p to the planes.
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                     + 2.0 * (ad * x + bd * y + cd * z) + d2;
+        return weight > 0.0 ? std::fabs(error) / weight : 0.0;
+    }
+};
+
+enum SimplifierVertexKind
+{
+    manifoldVertex,
+    borderVertex,                                                                                                        // Only collapses along border edges.
+    lockedVertex                                                                                                         // Attribute seams, border corners and non-manifold vertices, never collapse.
+};
+
+struct EdgeCollapse
+{
+    GLuint from;
+    GLuint to;
+    double error;
+};
+
+Position subtract(const Position& a, const Position& b) { return Position(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+GLfloat dot(const Position& a, const Position& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+uint64_t getEdgeKey(GLuint a, GLuint b) { return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a; }
+
+void countEdgeUses(const std::vector<GLuint>& indices, const std::vector<GLuint>& representatives, std::unordered_map<uint64_t, int>& edgeUseCounts)
+{
+    edgeUseCounts.clear();                                                                                               // Over welded positions: 1 is a border, 2 an interior edge, more is non-manifold.
+    for (size_t i = 0; i < indices.size(); i += 3)
+        for (int corner = 0; corner < 3; corner++)
+            edgeUseCounts[getEdgeKey(representatives[indices[i + corner]], representatives[indices[i + (corner + 1) % 3]])]++;
+}
+
+std::vector<GLuint> getPositionRepresentatives(const std::vector<Vertex>& vertices)                                     // First vertex with the same position, so seams are seen as one surface.
+{
+    std::unordered_map<std::string, GLuint> firstVertices;
+    std::vector<GLuint> representatives(vertices.size());
+    for (GLuint i = 0; i < vertices.size(); i++) {
+        std::string key((const char*)&vertices[i].position, sizeof(Position));
+        representatives[i] = firstVertices.emplace(key, i).first->second;
+    }
+    return representatives;
+}
+
+void lockBorderCorners(const std::vector<Vertex>& vertices, const std::unordered_map<uint64_t, int>& edgeUseCounts,
+                       std::vector<SimplifierVertexKind>& kinds)                                                         // A border vertex may only slide along a straight stretch of the border, otherwise collapsing it cuts the corner.
+{
+    std::vector<int> borderEdgeCounts(vertices.size(), 0);
+    std::vector<Position> firstBorderDirections(vertices.size());
+    for (const auto& edgeUseCount : edgeUseCounts) {
+        if (edgeUseCount.second != 1)
+            continue;
+        GLuint ends[2] = { (GLuint)(edgeUseCount.first >> 32), (GLuint)(edgeUseCount.first & 0xFFFFFFFF) };
+        for (int end = 0; end < 2; end++) {
+            GLuint vertex = ends[end];
+            if (kinds[vertex] != borderVertex)
+                continue;
+            Position direction = Matrix4::normalize(subtract(vertices[ends[1 - end]].position, vertices[vertex].position));
+            if (borderEdgeCounts[vertex]++ == 0)
+                firstBorderDirections[vertex] = direction;
+            else if (borderEdgeCounts[vertex] > 2 || dot(firstBorderDirections[vertex], direction) > -borderCornerCosine)
+                kinds[vertex] = lockedVertex;                                                                            // A corner, or where borders meet.
+        }
+    }
+}
+
+bool isCollapseFlippingTriangles(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<int>& triangles,
+                                 GLuint from, GLuint to)
+{
+    for (int triangle : triangles) {
+        const GLuint* corners = &indices[triangle * 3];
+        if (corners[0] == to || corners[1] == to || corners[2] == to)
+            continue;                                                                                                    // Degenerates and is removed.
+        Position positions[3], movedPositions[3];
+        for (int corner = 0; corner < 3; corner++) {
+            positions[corner] = vertices[corners[corner]].position;
+            movedPositions[corner] = corners[corner] == from ? vertices[to].position : positions[corner];
+        }
+        Position normal = Matrix4::cross(subtract(positions[1], positions[0]), subtract(positions[2], positions[0]));
+        Position movedNormal = Matrix4::cross(subtract(movedPositions[1], movedPositions[0]), subtract(movedPositions[2], movedPositions[0]));
+        if (dot(normal, movedNormal) <= 0.25f * std::sqrt(dot(normal, normal) * dot(movedNormal, movedNormal)))         // Turning by more than about 75 degrees folds thin triangles over their neighbours.
+            return true;
+    }
+    return false;
+}
+
+std::vector<GLuint> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int targetIndexCount,
+                                 GLfloat maxError, GLfloat* resultError)
+{
+    std::vector<GLuint> representatives = getPositionRepresentatives(vertices);
+    std::vector<SimplifierVertexKind> kinds(vertices.size(), manifoldVertex);
+    for (GLuint i = 0; i < vertices.size(); i++)
+        if (representatives[i] != i)
+            kinds[i] = kinds[representatives[i]] = lockedVertex;
+
+    std::unordered_map<uint64_t, int> edgeUseCounts;
+    countEdgeUses(indices, representatives, edgeUseCounts);
+
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const GLuint* corners = &indices[i];
+        Position p0 = vertices[corners[0]].position, p1 = vertices[corners[1]].position, p2 = vertices[corners[2]].position;
+        Position normal = Matrix4::cross(subtract(p1, p0), subtract(p2, p0));
+        GLfloat doubleArea = std::sqrt(dot(normal, normal));
+        if (doubleArea == 0.0f)
+            continue;
+        normal = Position(normal.x / doubleArea, normal.y / doubleArea, normal.z / doubleArea);
+        Quadric faceQuadric = Quadric::fromPlane(normal.x, normal.y, normal.z, -dot(normal, p0), doubleArea * 0.5);
+        for (int corner = 0; corner < 3; corner++)
+            quadrics[representatives[corners[corner]]].add(faceQuadric);
+
+        for (int corner = 0; corner < 3; corner++) {                                                                    // A plane through each border edge, perpendicular to the face, keeps borders in place.
+            GLuint a = representatives[corners[corner]], b = representatives[corners[(corner + 1) % 3]];
+            int useCount = edgeUseCounts[getEdgeKey(a, b)];
+            if (useCount > 2)
+                kinds[a] = kinds[b] = lockedVertex;
+            if (useCount != 1)
+                continue;
+            if (kinds[a] == manifoldVertex)
+                kinds[a] = borderVertex;
+            if (kinds[b] == manifoldVertex)
+                kinds[b] = borderVertex;
+            Position edge = subtract(vertices[b].position, vertices[a].position);
+            Position borderNormal = Matrix4::normalize(Matrix4::cross(edge, normal));
+            Quadric borderQuadric = Quadric::fromPlane(borderNormal.x, borderNormal.y, borderNormal.z, -dot(borderNormal, vertices[a].position),
+                                                       dot(edge, edge) * borderQuadricWeight);
+            quadrics[a].add(borderQuadric);
+            quadrics[b].add(borderQuadric);
+        }
+    }
+    lockBorderCorners(vertices, edgeUseCounts, kinds);
+
+    std::vector<GLuint> result = indices;
+    std::vector<GLuint> remap(vertices.size());
+    std::vector<bool> isLockedThisPass(vertices.size());
+    std::vector<int> adjacencyOffsets(vertices.size() + 1), adjacency;
+    double maxSquaredError = (double)maxError * maxError, largestCollapseError = 0.0;
+    for (bool isFirstPass = true; (int)result.size() > targetIndexCount; isFirstPass = false) {
+        if (!isFirstPass)
+            countEdgeUses(result, representatives, edgeUseCounts);                                                       // Collapses along a border create new border edges.
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);                                                 // Triangles around each vertex, rebuilt every pass.
+        for (GLuint index : result)
+            adjacencyOffsets[index + 1]++;
+        for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+        adjacency.resize(result.size());
+        std::vector<int> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+            adjacency[cursors[result[i]]++] = i / 3;
+
+        std::vector<EdgeCollapse> collapses;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                GLuint a = result[i + corner], b = result[i + (corner + 1) % 3];
+                if (kinds[a] == lockedVertex || kinds[b] == lockedVertex)
+                    continue;
+                bool isBorderEdge = edgeUseCounts[getEdgeKey(a, b)] == 1;                                                 // Not locked, so a and b are their own representatives.
+                EdgeCollapse best = { 0, 0, -1.0 };
+                for (int direction = 0; direction < 2; direction++) {
+                    GLuint from = direction == 0 ? a : b, to = direction == 0 ? b : a;
+                    if (kinds[from] == borderVertex && (!isBorderEdge || kinds[to] != borderVertex))
+                        continue;                                                                                        // Would pull the border inwards.
+                    Quadric quadric = quadrics[from];
+                    quadric.add(quadrics[to]);
+                    double error = quadric.getError(vertices[to].position);
+                    if (best.error < 0.0 || error < best.error)
+                        best = { from, to, error };
+                }
+                if (best.error >= 0.0)
+                    collapses.push_back(best);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.error < b.error; });
+
+        for (GLuint vertex = 0; vertex < vertices.size(); vertex++)
+            remap[vertex] = vertex;
+        std::fill(isLockedThisPass.begin(), isLockedThisPass.end(), false);
+        int triangleBudget = (result.size() - targetIndexCount) / 3, removedTriangleCount = 0, collapseCount = 0;
+        for (const EdgeCollapse& collapse : collapses) {
+            if (collapse.error > maxSquaredError || removedTriangleCount >= triangleBudget)
+                break;
+            if (isLockedThisPass[collapse.from] || isLockedThisPass[collapse.to])
+                continue;
+            std::vector<int> triangles(adjacency.begin() + adjacencyOffsets[collapse.from], adjacency.begin() + adjacencyOffsets[collapse.from + 1]);
+            if (isCollapseFlippingTriangles(vertices, result, triangles, collapse.from, collapse.to))
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            largestCollapseError = std::max(largestCollapseError, collapse.error);
+            collapseCount++;
+            for (int triangle : triangles) {                                                                             // Collapses in one pass must not share triangles, their flip checks assumed the old positions.
+                const GLuint* corners = &result[triangle * 3];
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                    removedTriangleCount++;
+                for (int corner = 0; corner < 3; corner++)
+                    isLockedThisPass[corners[corner]] = true;
+            }
+        }
+        if (collapseCount == 0)
+            break;
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[writeIndex++] = a;
+            result[writeIndex++] = b;
+            result[writeIndex++] = c;
+        }
+        result.resize(writeIndex);
+    }
+    if (resultError != nullptr)
+        *resultError = (GLfloat)std::sqrt(largestCollapseError);
+    return result;
+}
+
+LodMesh getLodMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int maxLodCount, GLfloat reduction)
+{
+    std::vector<std::vector<GLuint>> lodIndices = { indices };
+    std::vector<GLfloat> lodErrors = { 0.0f };
+    while ((int)lodIndices.size() < maxLodCount) {
+        const std::vector<GLuint>& previous = lodIndices.back();
+        int targetIndexCount = (int)(previous.size() / 3 * reduction) * 3;
+        GLfloat error = 0.0f;
+        std::vector<GLuint> simplified = simplifyMesh(vertices, previous, targetIndexCount, INFINITY, &error);
+        if (simplified.empty() || simplified.size() > previous.size() * 0.9f)                                            // Locked vertices left little to simplify, further LODs would repeat this one.
+            break;
+        optimizeVertexCache(simplified, vertices.size());
+        lodErrors.push_back(lodErrors.back() + error);                                                                  // Errors of consecutive LODs add up at most.
+        lodIndices.push_back(std::move(simplified));
+    }
+
+    std::vector<MeshLod> lods;
+    std::vector<GLuint> allIndices;
+    for (size_t lod = 0; lod < lodIndices.size(); lod++) {
+        lods.push_back({ (int)allIndices.size(), (int)lodIndices[lod].size(), lodErrors[lod] });
+        allIndices.insert(allIndices.end(), lodIndices[lod].begin(), lodIndices[lod].end());
+    }
+    MeshBounds bounds = getMeshBounds(vertices);
+    Position extent = bounds.getExtent();
+    Position center((bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f);
+    return LodMesh{ getVertexArrayData(vertices, allIndices), lods, center, 0.5f * std::sqrt(dot(extent, extent)) };
+}
+
+GLfloat getProjectedSize(GLfloat size, GLfloat distance, GLfloat verticalFov, int viewportHeight)
+{
+    if (distance <= 0.0f)
+        return INFINITY;
+    return size * viewportHeight / (2.0f * std::tan(verticalFov * 0.5f) * distance);
+}
+
+int selectLod(const LodMesh& lodMesh, GLfloat distance, GLfloat verticalFov, int viewportHeight, GLfloat maxPixelError)
+{
+    for (int lod = lodMesh.lods.size() - 1; lod > 0; lod--)                                                              // Coarsest first.
+        if (getProjectedSize(lodMesh.lods[lod].error, distance, verticalFov, viewportHeight) <= maxPixelError)
+            return lod;
+    return 0;
+}
+
+void drawLod(GLuint shaderProgram, const LodMesh& lodMesh, int lod)
+{
+    const MeshLod& meshLod = lodMesh.lods[lod];
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(*lodMesh.vertexArrayData.boundVAO);
+    glDrawElements(GL_TRIANGLES, meshLod.elementsCount, lodMesh.vertexArrayData.indexType,
+                   (void*)(meshLod.firstIndex * getIndexSize(lodMesh.vertexArrayData.indexType)));
+}
+
+void cleanLodMesh(LodMesh lodMesh)
+{
+    cleanVertexArrayData(lodMesh.vertexArrayData);
+}
@@ -0,0 +1,118 @@
+#include "mesh-streams.hpp"
+#include "renderer.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+
+void MeshStreams::append(const Vertex& vertex)
+{
+    positions.push_back(vertex.position);
+    colors.push_back(vertex.color);
+    uvs.push_back(vertex.uv);
+    normals.push_back(vertex.normals);
+}
+
+MeshStreams MeshStreams::fromVertices(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices)
+{
+    MeshStreams meshStreams;
+    meshStreams.positions.reserve(vertices.size());
+    meshStreams.colors.reserve(vertices.size());
+    meshStreams.uvs.reserve(vertices.size());
+    meshStreams.normals.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        meshStreams.append(vertex);
+    meshStreams.indices = indices;
+    return meshStreams;
+}
+
+std::vector<Vertex> MeshStreams::toVertices() const
+{
+    std::vector<Vertex> vertices;
+    vertices.reserve(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+        vertices.push_back(Vertex(positions[i], i < colors.size() ? colors[i] : Color::white(), i < uvs.size() ? uvs[i] : UV(),
+                                  i < normals.size() ? normals[i] : Position()));
+    return vertices;
+}
+
+MeshBounds getMeshBounds(const MeshStreams& meshStreams)
+{
+    if (meshStreams.positions.empty())
+        return MeshBounds();
+    GLfloat minX = meshStreams.positions[0].x, minY = meshStreams.positions[0].y, minZ = meshStreams.positions[0].z;
+    GLfloat maxX = minX, maxY = minY, maxZ = minZ;
+    for (const Position& position : meshStreams.positions) {                                                             // Independent min/max per component, which the compiler turns into vector min/max.
+        minX = std::min(minX, position.x);
+        minY = std::min(minY, position.y);
+        minZ = std::min(minZ, position.z);
+        maxX = std::max(maxX, position.x);
+        maxY = std::max(maxY, position.y);
+        maxZ = std::max(maxZ, position.z);
+    }
+    return MeshBounds{ Position(minX, minY, minZ), Position(maxX, maxY, maxZ) };
+}
+
+void transformMeshStreams(MeshStreams& meshStreams, const Matrix4& transform)
+{
+    for (Position& position : meshStreams.positions)
+        position = transform.transformPoint(position);
+
+    Matrix4 rotation = transform;
+    rotation.at(3, 0) = rotation.at(3, 1) = rotation.at(3, 2) = 0.0f;
+    for (Position& normal : meshStreams.normals)
+        normal = Matrix4::normalize(rotation.transformPoint(normal));
+}
+
+template<class AttributeType>
+GLuint createVertexStream(const std::vector<AttributeType>& stream, VertexStream location)                              // Uploads one stream and enables it in the bound VAO, 0 when the stream is empty.
+{
+    if (stream.empty())
+        return 0;
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, stream.size() * sizeof(AttributeType), stream.data(), GL_STATIC_DRAW);
+    const VertexAttribute attribute = getStreamAttribute<AttributeType>(location);
+    enableVertexLayout(&attribute, 1, sizeof(AttributeType));
+    return VBO;
+}
+
+MultiStreamMesh getMultiStreamMesh(const MeshStreams& meshStreams)
+{
+    MultiStreamMesh multiStreamMesh = {};
+    multiStreamMesh.elementsCount = meshStreams.indices.size();
+    glGenVertexArrays(1, &multiStreamMesh.VAO);
+    glGenVertexArrays(1, &multiStreamMesh.positionOnlyVAO);
+    glGenBuffers(1, &multiStreamMesh.EBO);
+
+    getGlStateCache().bindVertexArray(multiStreamMesh.VAO);
+    getGlStateCache().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, multiStreamMesh.EBO);
+    multiStreamMesh.indexType = uploadIndices(meshStreams.indices, meshStreams.getVertexCount());
+    multiStreamMesh.VBO[positionStream] = createVertexStream(meshStreams.positions, positionStream);
+    multiStreamMesh.VBO[colorStream] = createVertexStream(meshStreams.colors, colorStream);
+    multiStreamMesh.VBO[uvStream] = createVertexStream(meshStreams.uvs, uvStream);
+    multiStreamMesh.VBO[normalStream] = createVertexStream(meshStreams.normals, normalStream);
+
+    getGlStateCache().bindVertexArray(multiStreamMesh.positionOnlyVAO);                                                  // Shares the index and position buffers.
+    getGlStateCache().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, multiStreamMesh.EBO);
+    if (multiStreamMesh.VBO[positionStream] != 0) {                                                                      // Without a buffer bound glVertexAttribPointer fails in the core profile.
+        getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, multiStreamMesh.VBO[positionStream]);
+        const VertexAttribute positionAttribute = getStreamAttribute<Position>(positionStream);
+        enableVertexLayout(&positionAttribute, 1, sizeof(Position));
+    }
+
+    getGlStateCache().bindVertexArray(0);
+    return multiStreamMesh;
+}
+
+void cleanMultiStreamMesh(MultiStreamMesh multiStreamMesh)
+{
+    GLuint vertexArrays[] = { multiStreamMesh.VAO, multiStreamMesh.positionOnlyVAO };
+    for (GLuint vertexArray : vertexArrays)
+        getGlStateCache().onVertexArrayDeleted(vertexArray);
+    glDeleteVertexArrays(2, vertexArrays);
+    for (GLuint VBO : multiStreamMesh.VBO)
+        getGlStateCache().onBufferDeleted(VBO);
+    getGlStateCache().onBufferDeleted(multiStreamMesh.EBO);
+    glDeleteBuffers(vertexStreamCount, multiStreamMesh.VBO);                                                             // Zeros are silently ignored.
+    glDeleteBuffers(1, &multiStreamMesh.EBO);
+}
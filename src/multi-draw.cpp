@@ -0,0 +1,96 @@
+#include "multi-draw.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+#include <iostream>
+
+static_assert(sizeof(InstanceData) % (4 * sizeof(GLfloat)) == 0, "InstanceData has to fill whole RGBA32F texels");
+static_assert(sizeof(TextureReference) == 4 * sizeof(GLuint), "TextureReference has to fill one RGBA32UI texel");
+
+const GLuint drawIdDivisor = 1u << 30;                                                                                   // Larger than any instance count, the instance never advances the draw ID.
+
+bool isMultiDrawIndirectSupported()
+{
+    return GLAD_GL_ARB_draw_indirect && GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+}
+
+DrawDataBuffer::DrawDataBuffer(int capacity, bool hasTextureReferences)
+    : capacity(capacity), drawIdVBO(0), textureReferenceBuffer(0), textureReferenceTexture(0)
+{
+    glGenBuffers(1, &ID);
+    getGlStateCache().bindBuffer(GL_TEXTURE_BUFFER, ID);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &texture);
+    getGlStateCache().bindTexture(drawDataTextureUnit, GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ID);
+    if (hasTextureReferences) {
+        glGenBuffers(1, &textureReferenceBuffer);
+        getGlStateCache().bindBuffer(GL_TEXTURE_BUFFER, textureReferenceBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)capacity * sizeof(TextureReference), nullptr, GL_STREAM_DRAW);
+        glGenTextures(1, &textureReferenceTexture);
+        getGlStateCache().bindTexture(drawTextureReferencesTextureUnit, GL_TEXTURE_BUFFER, textureReferenceTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, textureReferenceBuffer);
+    }
+
+    if (isMultiDrawIndirectSupported()) {
+        std::vector<GLuint> drawIds(capacity);
+        for (int i = 0; i < capacity; i++)
+            drawIds[i] = i;
+        glGenBuffers(1, &drawIdVBO);
+        getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+    }
+}
+
+void DrawDataBuffer::update(const std::vector<InstanceData>& drawData)
+{
+    if ((int)drawData.size() > capacity)
+        std::cout << "::Error: " << drawData.size() << " draws do not fit a draw data buffer of " << capacity << ", the rest is dropped" << std::endl;
+    int drawCount = std::min((int)drawData.size(), capacity);
+    getGlStateCache().bindBuffer(GL_TEXTURE_BUFFER, ID);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);              // Orphans the previous contents so the upload does not wait for draws still reading them.
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, drawCount * sizeof(InstanceData), drawData.data());
+}
+
+void DrawDataBuffer::updateTextureReferences(const std::vector<TextureReference>& textureReferences)
+{
+    if (textureReferenceBuffer == 0) {
+        std::cout << "::Error: draw data buffer was created without texture references" << std::endl;
+        return;
+    }
+    int drawCount = std::min((int)textureReferences.size(), capacity);
+    getGlStateCache().bindBuffer(GL_TEXTURE_BUFFER, textureReferenceBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)capacity * sizeof(TextureReference), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, drawCount * sizeof(TextureReference), textureReferences.data());
+}
+
+void DrawDataBuffer::bind(GLuint textureUnit)
+{
+    getGlStateCache().bindTexture(textureUnit, GL_TEXTURE_BUFFER, texture);
+    if (textureReferenceTexture != 0)
+        getGlStateCache().bindTexture(drawTextureReferencesTextureUnit, GL_TEXTURE_BUFFER, textureReferenceTexture);
+}
+
+void DrawDataBuffer::attach(GLuint VAO)
+{
+    if (drawIdVBO == 0)                                                                                                  // The attribute stays disabled and reads the constant the render queue sets.
+        return;
+    getGlStateCache().bindVertexArray(VAO);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, drawIdVBO);
+    glVertexAttribIPointer(drawIdAttributeLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glEnableVertexAttribArray(drawIdAttributeLocation);
+    glVertexAttribDivisor(drawIdAttributeLocation, drawIdDivisor);
+    getGlStateCache().bindVertexArray(0);
+}
+
+void DrawDataBuffer::deleteDrawDataBuffer()
+{
+    getGlStateCache().onTextureDeleted(texture);
+    getGlStateCache().onTextureDeleted(textureReferenceTexture);
+    GLuint textures[] = { texture, textureReferenceTexture };
+    glDeleteTextures(2, textures);                                                                                       // Name 0 is silently ignored.
+    getGlStateCache().onBufferDeleted(ID);
+    getGlStateCache().onBufferDeleted(drawIdVBO);
+    getGlStateCache().onBufferDeleted(textureReferenceBuffer);
+    GLuint buffers[] = { ID, drawIdVBO, textureReferenceBuffer };
+    glDeleteBuffers(3, buffers);
+}
@@ -0,0 +1,484 @@
+#include "image-decoder.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+const int inflateMaxBits = 15;
+const int inflateLiteralLengthCodeCount = 288;
+const int inflateDistanceCodeCount = 30;
+
+const unsigned short inflateLengthBases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char inflateLengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short inflateDistanceBases[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                                  4097, 6145, 8193, 12289, 16385, 24577 };
+const unsigned char inflateDistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const unsigned char inflateCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+const int adam7Passes[7][4] = {                                                                                          // First column, first row, column step, row step.
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+
+struct InflateHuffmanTable                                                                                               // Canonical code as in RFC 1951 3.2.2, decoded a bit at a time like zlib's puff.
+{
+    short counts[inflateMaxBits + 1];                                                                                    // Number of codes of each length.
+    short symbols[inflateLiteralLengthCodeCount];                                                                        // Ordered by code.
+};
+
+struct Inflater                                                                                                          // zlib stream (RFC 1950) around raw deflate data (RFC 1951), LSB first.
+{
+    const unsigned char* data;
+    size_t size;
+    size_t position = 0;
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    bool isOverrun = false;                                                                                              // Reading past the end, every later bit is 0.
+    std::vector<unsigned char> output;
+    std::string error;
+
+    int getBits(int count)
+    {
+        while (bitCount < count) {
+            uint32_t byte = 0;
+            if (position < size)
+                byte = data[position++];
+            else
+                isOverrun = true;
+            bitBuffer |= byte << bitCount;
+            bitCount += 8;
+        }
+        int value = bitBuffer & ((1u << count) - 1);
+        bitBuffer >>= count;
+        bitCount -= count;
+        return value;
+    }
+};
+
+bool buildInflateTable(InflateHuffmanTable& table, const unsigned char* lengths, int symbolCount)                       // False for an oversubscribed code, incomplete ones are allowed (a single distance code, for example).
+{
+    short offsets[inflateMaxBits + 1];
+    std::fill(table.counts, table.counts + inflateMaxBits + 1, 0);
+    for (int symbol = 0; symbol < symbolCount; symbol++)
+        table.counts[lengths[symbol]]++;
+    int left = 1;
+    for (int length = 1; length <= inflateMaxBits; length++) {
+        left = left * 2 - table.counts[length];
+        if (left < 0)
+            return false;
+    }
+    offsets[1] = 0;
+    for (int length = 1; length < inflateMaxBits; length++)
+        offsets[length + 1] = offsets[length] + table.counts[length];
+    for (int symbol = 0; symbol < symbolCount; symbol++)
+        if (lengths[symbol] != 0)
+            table.symbols[offsets[lengths[symbol]]++] = symbol;
+    return true;
+}
+
+int decodeInflateSymbol(Inflater& inflater, const InflateHuffmanTable& table)                                            // -1 for a code the table does not have.
+{
+    int code = 0, first = 0, index = 0;
+    for (int length = 1; length <= inflateMaxBits; length++) {
+        code |= inflater.getBits(1);
+        int count = table.counts[length];
+        if (code - first < count)
+            return table.symbols[index + code - first];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool inflateCodes(Inflater& inflater, const InflateHuffmanTable& literalLengths, const InflateHuffmanTable& distances)
+{
+    while (true) {
+        int symbol = decodeInflateSymbol(inflater, literalLengths);
+        if (symbol < 0 || inflater.isOverrun) {
+            inflater.error = "invalid or truncated compressed data";
+            return false;
+        }
+        if (symbol < 256) {
+            inflater.output.push_back((unsigned char)symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+        symbol -= 257;
+        if (symbol >= 29) {
+            inflater.error = "invalid length code";
+            return false;
+        }
+        int length = inflateLengthBases[symbol] + inflater.getBits(inflateLengthExtraBits[symbol]);
+        int distanceSymbol = decodeInflateSymbol(inflater, distances);
+        if (distanceSymbol < 0 || distanceSymbol >= inflateDistanceCodeCount) {
+            inflater.error = "invalid distance code";
+            return false;
+        }
+        size_t distance = inflateDistanceBases[distanceSymbol] + inflater.getBits(inflateDistanceExtraBits[distanceSymbol]);
+        if (distance > inflater.output.size()) {
+            inflater.error = "distance too far back";
+            return false;
+        }
+        size_t start = inflater.output.size() - distance;
+        for (int i = 0; i < length; i++)                                                                                 // Byte by byte, the copy may overlap what it writes.
+            inflater.output.push_back(inflater.output[start + i]);
+    }
+}
+
+bool inflateStored(Inflater& inflater)
+{
+    inflater.bitBuffer = 0;                                                                                              // Stored blocks start at a byte boundary.
+    inflater.bitCount = 0;
+    if (inflater.position + 4 > inflater.size) {
+        inflater.error = "truncated stored block";
+        return false;
+    }
+    const unsigned char* header = inflater.data + inflater.position;
+    int length = header[0] | (header[1] << 8);
+    if ((header[2] | (header[3] << 8)) != (~length & 0xFFFF) || inflater.position + 4 + length > inflater.size) {
+        inflater.error = "invalid stored block";
+        return false;
+    }
+    inflater.output.insert(inflater.output.end(), header + 4, header + 4 + length);
+    inflater.position += 4 + length;
+    return true;
+}
+
+bool inflateFixed(Inflater& inflater)
+{
+    static const std::vector<InflateHuffmanTable> tables = []() {                                                        // Literal/length codes, then distance codes, as RFC 1951 3.2.6 defines them.
+        std::vector<InflateHuffmanTable> result(2);
+        unsigned char lengths[inflateLiteralLengthCodeCount];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        buildInflateTable(result[0], lengths, inflateLiteralLengthCodeCount);
+        std::fill(lengths, lengths + inflateDistanceCodeCount, 5);
+        buildInflateTable(result[1], lengths, inflateDistanceCodeCount);
+        return result;
+    }();
+    return inflateCodes(inflater, tables[0], tables[1]);
+}
+
+bool inflateDynamic(Inflater& inflater)
+{
+    int literalLengthCount = inflater.getBits(5) + 257;
+    int distanceCount = inflater.getBits(5) + 1;
+    int codeLengthCount = inflater.getBits(4) + 4;
+    if (literalLengthCount > 286 || distanceCount > inflateDistanceCodeCount) {
+        inflater.error = "invalid dynamic block header";
+        return false;
+    }
+    unsigned char lengths[inflateLiteralLengthCodeCount + inflateDistanceCodeCount] = {};
+    for (int i = 0; i < codeLengthCount; i++)
+        lengths[inflateCodeLengthOrder[i]] = inflater.getBits(3);
+    InflateHuffmanTable codeLengths, literalLengths, distances;
+    if (!buildInflateTable(codeLengths, lengths, 19)) {
+        inflater.error = "invalid code length code";
+        return false;
+    }
+    std::fill(lengths, lengths + 19, 0);
+    for (int index = 0; index < literalLengthCount + distanceCount; ) {
+        int symbol = decodeInflateSymbol(inflater, codeLengths);
+        if (symbol < 0 || inflater.isOverrun) {
+            inflater.error = "invalid code lengths";
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+        int repeated = 0, count;
+        if (symbol == 16) {
+            if (index == 0) {
+                inflater.error = "code length repeat without a previous length";
+                return false;
+            }
+            repeated = lengths[index - 1];
+            count = 3 + inflater.getBits(2);
+        }
+        else if (symbol == 17)
+            count = 3 + inflater.getBits(3);
+        else
+            count = 11 + inflater.getBits(7);
+        if (index + count > literalLengthCount + distanceCount) {
+            inflater.error = "too many code lengths";
+            return false;
+        }
+        std::fill(lengths + index, lengths + index + count, repeated);
+        index += count;
+    }
+    if (lengths[256] == 0) {
+        inflater.error = "no end of block code";
+        return false;
+    }
+    if (!buildInflateTable(literalLengths, lengths, literalLengthCount) || !buildInflateTable(distances, lengths + literalLengthCount, distanceCount)) {
+        inflater.error = "invalid literal/length or distance code";
+        return false;
+    }
+    return inflateCodes(inflater, literalLengths, distances);
+}
+
+bool inflateZlib(Inflater& inflater)                                                                                     // The Adler-32 checksum is not verified, the PNG chunk CRCs are not either.
+{
+    if (inflater.size < 2 || (inflater.data[0] & 15) != 8 || ((inflater.data[0] << 8) | inflater.data[1]) % 31 != 0 || (inflater.data[1] & 0x20)) {
+        inflater.error = "invalid zlib header";
+        return false;
+    }
+    inflater.position = 2;
+    bool isLastBlock = false;
+    while (!isLastBlock) {
+        isLastBlock = inflater.getBits(1);
+        int type = inflater.getBits(2);
+        bool isInflated = false;
+        if (type == 0)
+            isInflated = inflateStored(inflater);
+        else if (type == 1)
+            isInflated = inflateFixed(inflater);
+        else if (type == 2)
+            isInflated = inflateDynamic(inflater);
+        else
+            inflater.error = "invalid block type";
+        if (!isInflated)
+            return false;
+    }
+    return true;
+}
+
+uint32_t readUint32BigEndian(const unsigned char* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+unsigned char getPaethPredictor(int left, int above, int aboveLeft)
+{
+    int estimate = left + above - aboveLeft;
+    int leftDistance = std::abs(estimate - left), aboveDistance = std::abs(estimate - above), aboveLeftDistance = std::abs(estimate - aboveLeft);
+    if (leftDistance <= aboveDistance && leftDistance <= aboveLeftDistance)
+        return left;
+    return aboveDistance <= aboveLeftDistance ? above : aboveLeft;
+}
+
+bool unfilterRows(unsigned char* data, int rowCount, size_t rowSize, int pixelSize)                                      // In place. Every row is a filter type byte followed by rowSize bytes, pixelSize is at least 1 byte.
+{
+    const unsigned char* previous = nullptr;
+    for (int y = 0; y < rowCount; y++) {
+        unsigned char* row = data + y * (rowSize + 1) + 1;
+        int filter = row[-1];
+        for (size_t i = 0; i < rowSize; i++) {
+            int left = i >= (size_t)pixelSize ? row[i - pixelSize] : 0;
+            int above = previous != nullptr ? previous[i] : 0;
+            int aboveLeft = previous != nullptr && i >= (size_t)pixelSize ? previous[i - pixelSize] : 0;
+            if (filter == 1)
+                row[i] += left;
+            else if (filter == 2)
+                row[i] += above;
+            else if (filter == 3)
+                row[i] += (left + above) / 2;
+            else if (filter == 4)
+                row[i] += getPaethPredictor(left, above, aboveLeft);
+            else if (filter != 0)
+                return false;
+        }
+        previous = row;
+    }
+    return true;
+}
+
+struct PngHeader
+{
+    int width = 0;
+    int height = 0;
+    int bitDepth = 0;
+    int colorType = 0;
+    bool isInterlaced = false;
+    std::vector<unsigned char> palette;                                                                                  // RGBA, 256 entries once a PLTE chunk was read.
+    bool hasColorKey = false;
+    int colorKey[3] = {};                                                                                                // Gray or RGB samples at bitDepth, from tRNS.
+};
+
+int getPngChannelCount(int colorType)
+{
+    static const int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+    return channelCounts[colorType];
+}
+
+void getPngPass(const PngHeader& header, int pass, int& startX, int& startY, int& stepX, int& stepY, int& passWidth, int& passHeight)
+{
+    startX = header.isInterlaced ? adam7Passes[pass][0] : 0, startY = header.isInterlaced ? adam7Passes[pass][1] : 0;
+    stepX = header.isInterlaced ? adam7Passes[pass][2] : 1, stepY = header.isInterlaced ? adam7Passes[pass][3] : 1;
+    passWidth = (header.width - startX + stepX - 1) / stepX, passHeight = (header.height - startY + stepY - 1) / stepY;
+}
+
+size_t getPngImageDataSize(const PngHeader& header)                                                                      // Filtered rows of every pass, each with its filter type byte.
+{
+    size_t size = 0;
+    int bitsPerPixel = getPngChannelCount(header.colorType) * header.bitDepth;
+    for (int pass = header.isInterlaced ? 0 : 6; pass < 7; pass++) {                                                       // A non-interlaced image is one pass over every pixel.
+        int startX, startY, stepX, stepY, passWidth, passHeight;
+        getPngPass(header, pass, startX, startY, stepX, stepY, passWidth, passHeight);
+        if (passWidth > 0 && passHeight > 0)                                                                             // Empty passes have no rows, not even filter bytes.
+            size += (size_t)passHeight * (((size_t)passWidth * bitsPerPixel + 7) / 8 + 1);
+    }
+    return size;
+}
+
+void writePngPixels(const PngHeader& header, const unsigned char* row, int width, int targetX, int targetY, int stepX, ImageLevel& result)
+{
+    int channelCount = getPngChannelCount(header.colorType);
+    int bitsPerPixel = channelCount * header.bitDepth;
+    int maxValue = (1 << header.bitDepth) - 1;
+    for (int x = 0; x < width; x++) {
+        int samples[4];
+        for (int channel = 0; channel < channelCount; channel++) {
+            if (header.bitDepth == 16)
+                samples[channel] = (row[x * channelCount * 2 + channel * 2] << 8) | row[x * channelCount * 2 + channel * 2 + 1];
+            else if (header.bitDepth == 8)
+                samples[channel] = row[x * channelCount + channel];
+            else {                                                                                                       // Packed, leftmost pixel in the high bits. Only gray and palette come below 8 bits.
+                int bit = x * bitsPerPixel;
+                samples[channel] = (row[bit / 8] >> (8 - header.bitDepth - bit % 8)) & maxValue;
+            }
+        }
+        unsigned char* target = result.pixels.data() + ((size_t)(result.height - 1 - targetY) * result.width + targetX + x * stepX) * 4;  // Bottom row first.
+        auto to8Bit = [&](int sample) { return (unsigned char)(header.bitDepth == 16 ? sample >> 8 : sample * 255 / maxValue); };
+        if (header.colorType == 3) {
+            int index = std::min(samples[0], 255);
+            std::copy(header.palette.begin() + index * 4, header.palette.begin() + index * 4 + 4, target);
+            continue;
+        }
+        bool isGray = header.colorType == 0 || header.colorType == 4;
+        target[0] = to8Bit(samples[0]);
+        target[1] = to8Bit(isGray ? samples[0] : samples[1]);
+        target[2] = to8Bit(isGray ? samples[0] : samples[2]);
+        if (header.colorType == 4 || header.colorType == 6)
+            target[3] = to8Bit(samples[channelCount - 1]);
+        else {
+            bool isKeyed = header.hasColorKey && samples[0] == header.colorKey[0]
+                           && (isGray || (samples[1] == header.colorKey[1] && samples[2] == header.colorKey[2]));
+            target[3] = isKeyed ? 0 : 255;
+        }
+    }
+}
+
+bool readPngHeader(PngHeader& header, const unsigned char* chunk, uint32_t length, std::string& error)
+{
+    if (length < 13) {
+        error = "invalid IHDR chunk";
+        return false;
+    }
+    header.width = readUint32BigEndian(chunk);
+    header.height = readUint32BigEndian(chunk + 4);
+    header.bitDepth = chunk[8];
+    header.colorType = chunk[9];
+    header.isInterlaced = chunk[12] == 1;
+    bool isBitDepthValid = header.colorType == 0 ? (header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8 || header.bitDepth == 16)
+                           : header.colorType == 3 ? (header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8)
+                           : (header.colorType == 2 || header.colorType == 4 || header.colorType == 6) && (header.bitDepth == 8 || header.bitDepth == 16);
+    if (header.width <= 0 || header.height <= 0 || header.width > (1 << 24) || header.height > (1 << 24) || !isBitDepthValid
+        || chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1) {
+        error = "invalid or unsupported IHDR chunk";
+        return false;
+    }
+    return true;
+}
+
+bool decodePng(const char* data, size_t size, ImageLevel& result)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    PngHeader header;
+    std::vector<unsigned char> compressed;
+    std::string error;
+    bool isHeaderRead = false, isEndReached = false;
+    for (size_t position = 8; !isEndReached && error.empty(); ) {
+        if (position + 12 > size) {
+            error = "truncated chunk";
+            break;
+        }
+        uint32_t length = readUint32BigEndian(bytes + position);
+        const unsigned char* type = bytes + position + 4;
+        const unsigned char* chunk = bytes + position + 8;
+        if (length > size - position - 12) {
+            error = "truncated chunk";
+            break;
+        }
+        position += 12 + length;
+        if (memcmp(type, "IHDR", 4) == 0)
+            isHeaderRead = readPngHeader(header, chunk, length, error);
+        else if (!isHeaderRead)
+            error = "no IHDR chunk";
+        else if (memcmp(type, "PLTE", 4) == 0) {
+            header.palette.assign(256 * 4, 0);
+            for (uint32_t i = 0; i < std::min(length / 3, 256u); i++) {
+                std::copy(chunk + i * 3, chunk + i * 3 + 3, header.palette.begin() + i * 4);
+                header.palette[i * 4 + 3] = 255;
+            }
+        }
+        else if (memcmp(type, "tRNS", 4) == 0) {
+            if (header.colorType == 3) {
+                for (uint32_t i = 0; i < std::min(length, 256u) && !header.palette.empty(); i++)
+                    header.palette[i * 4 + 3] = chunk[i];
+            }
+            else if (header.colorType == 0 && length >= 2) {
+                header.hasColorKey = true;
+                header.colorKey[0] = (chunk[0] << 8) | chunk[1];
+            }
+            else if (header.colorType == 2 && length >= 6) {
+                header.hasColorKey = true;
+                for (int i = 0; i < 3; i++)
+                    header.colorKey[i] = (chunk[i * 2] << 8) | chunk[i * 2 + 1];
+            }
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        else if (memcmp(type, "IEND", 4) == 0)
+            isEndReached = true;
+        else if ((type[0] & 0x20) == 0)                                                                                  // Lowercase first letter: ancillary, safe to skip.
+            error = "unknown critical chunk";
+    }
+    if (error.empty() && !isHeaderRead)
+        error = "no IHDR chunk";
+    if (error.empty() && header.colorType == 3 && header.palette.empty())
+        error = "no PLTE chunk";
+
+    Inflater inflater;
+    inflater.data = compressed.data();
+    inflater.size = compressed.size();
+    size_t imageDataSize = error.empty() ? getPngImageDataSize(header) : 0;
+    if (error.empty()) {
+        inflater.output.reserve(std::min(imageDataSize, compressed.size() * 1032));                                      // Deflate expands at most about 1032 times, a corrupt header cannot ask for more.
+        if (!inflateZlib(inflater))
+            error = inflater.error;
+        else if (inflater.output.size() < imageDataSize)
+            error = "not enough image data";                                                                             // Before the pixels are allocated, so a corrupt header cannot ask for more here either.
+    }
+    if (!error.empty()) {
+        std::cout << "::Error: failed to decode PNG: " << error << std::endl;
+        return false;
+    }
+
+    int bitsPerPixel = getPngChannelCount(header.colorType) * header.bitDepth;
+    int pixelSize = std::max(bitsPerPixel / 8, 1);
+    result.width = header.width;
+    result.height = header.height;
+    result.pixels.assign((size_t)result.width * result.height * 4, 0);
+    size_t offset = 0;
+    for (int pass = header.isInterlaced ? 0 : 6; pass < 7; pass++) {
+        int startX, startY, stepX, stepY, passWidth, passHeight;
+        getPngPass(header, pass, startX, startY, stepX, stepY, passWidth, passHeight);
+        if (passWidth <= 0 || passHeight <= 0)
+            continue;
+        size_t rowSize = ((size_t)passWidth * bitsPerPixel + 7) / 8;
+        unsigned char* rows = inflater.output.data() + offset;
+        if (!unfilterRows(rows, passHeight, rowSize, pixelSize)) {
+            std::cout << "::Error: failed to decode PNG: invalid filter type" << std::endl;
+            return false;
+        }
+        for (int y = 0; y < passHeight; y++)
+            writePngPixels(header, rows + y * (rowSize + 1) + 1, passWidth, startX, startY + y * stepY, stepX, result);
+        offset += passHeight * (rowSize + 1);
+    }
+    return true;
+}
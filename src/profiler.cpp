@@ -0,0 +1,233 @@
+#include "profiler.hpp"
+#include <nlohmann-json/json.hpp>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+struct ProfileZoneRecord
+{
+    const char* name;
+    int frame;
+    int depth;
+    double cpuStart;
+    double cpuEnd;
+    GLuint gpuStartQuery;
+    GLuint gpuEndQuery;
+};
+
+struct ProfileCounterRecord
+{
+    const char* name;
+    int frame;
+    double time;
+    double value;
+};
+
+struct ProfilerFrame                                                                                                     // Zones of one frame whose GPU timestamps may still be in flight.
+{
+    std::vector<ProfileZoneRecord> zones;
+    std::vector<GLuint> queries;
+    int usedQueryCount = 0;
+};
+
+struct ProfileEvent
+{
+    const char* name;
+    int frame;
+    int depth;
+    double cpuStart;
+    double cpuDuration;
+    double gpuStart;
+    double gpuDuration;                                                                                                  // Negative when the GPU result was not ready in time and was dropped.
+};
+
+class Profiler
+{
+public:
+    bool isEnabled = false;
+    int frameIndex = -1;
+    int zoneDepth = 0;
+    int frameZoneIndex = -1;
+    int droppedGpuFrameCount = 0;
+    ProfilerFrame frames[profilerFrameLatency];
+    std::deque<ProfileEvent> events;                                                                                     // Of the last profilerTraceFrameCount frames, oldest first.
+    std::deque<ProfileCounterRecord> counters;
+    std::chrono::steady_clock::time_point cpuStartTime;
+    GLint64 gpuStartTime = 0;
+
+    ProfilerFrame& currentFrame() { return frames[frameIndex % profilerFrameLatency]; }
+};
+
+Profiler profiler;
+
+double getProfilerTime()                                                                                                 // Microseconds since initProfiler().
+{
+    std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - profiler.cpuStartTime;
+    return time.count();
+}
+
+GLuint acquireQuery(ProfilerFrame& frame)
+{
+    if (frame.usedQueryCount == (int)frame.queries.size()) {                                                        // Query objects are only created while the pool grows, afterwards they are reused every profilerFrameLatency frames.
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.queries[frame.usedQueryCount++];
+}
+
+void resolveFrame(ProfilerFrame& frame, bool canWait)
+{
+    if (frame.zones.empty())
+        return;
+
+    GLint isAvailable = GL_TRUE;
+    if (!canWait)
+        glGetQueryObjectiv(frame.queries[frame.usedQueryCount - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);        // Queries complete in order, so the last one being available means all of them are.
+    if (!isAvailable)
+        profiler.droppedGpuFrameCount++;
+
+    for (const ProfileZoneRecord& zone : frame.zones) {
+        ProfileEvent event = { zone.name, zone.frame, zone.depth, zone.cpuStart, zone.cpuEnd - zone.cpuStart, 0.0, -1.0 };
+        if (isAvailable) {
+            GLuint64 gpuStart, gpuEnd;
+            glGetQueryObjectui64v(zone.gpuStartQuery, GL_QUERY_RESULT, &gpuStart);
+            glGetQueryObjectui64v(zone.gpuEndQuery, GL_QUERY_RESULT, &gpuEnd);
+            event.gpuStart = ((GLint64)gpuStart - profiler.gpuStartTime) / 1000.0;
+            event.gpuDuration = (gpuEnd - gpuStart) / 1000.0;
+        }
+        profiler.events.push_back(event);
+    }
+    while (!profiler.events.empty() && profiler.events.front().frame <= profiler.frameIndex - profilerTraceFrameCount)
+        profiler.events.pop_front();
+    frame.zones.clear();
+    frame.usedQueryCount = 0;
+}
+
+int beginZone(const char* name)
+{
+    ProfilerFrame& frame = profiler.currentFrame();
+    ProfileZoneRecord zone = { name, profiler.frameIndex, profiler.zoneDepth++, getProfilerTime(), 0.0, acquireQuery(frame), 0 };
+    glQueryCounter(zone.gpuStartQuery, GL_TIMESTAMP);                                                                    // Timestamps instead of GL_TIME_ELAPSED because elapsed-time queries cannot be nested.
+    frame.zones.push_back(zone);
+    return frame.zones.size() - 1;
+}
+
+void endZone(int zoneIndex)
+{
+    ProfilerFrame& frame = profiler.currentFrame();
+    ProfileZoneRecord& zone = frame.zones[zoneIndex];
+    zone.gpuEndQuery = acquireQuery(frame);
+    glQueryCounter(zone.gpuEndQuery, GL_TIMESTAMP);
+    zone.cpuEnd = getProfilerTime();
+    profiler.zoneDepth--;
+}
+
+void initProfiler()
+{
+    profiler.isEnabled = true;
+    profiler.cpuStartTime = std::chrono::steady_clock::now();
+    glGetInteger64v(GL_TIMESTAMP, &profiler.gpuStartTime);                                                        // Current GPU time, used to place GPU zones on the same timeline as CPU zones.
+}
+
+bool isProfilerEnabled()
+{
+    return profiler.isEnabled;
+}
+
+void beginProfilerFrame()
+{
+    if (!profiler.isEnabled)
+        return;
+
+    profiler.frameIndex++;
+    resolveFrame(profiler.currentFrame(), false);
+    profiler.frameZoneIndex = beginZone("Frame");
+}
+
+void endProfilerFrame()
+{
+    if (!profiler.isEnabled || profiler.frameZoneIndex < 0)
+        return;
+
+    endZone(profiler.frameZoneIndex);
+    profiler.frameZoneIndex = -1;
+}
+
+void addProfilerCounter(const char* name, double value)
+{
+    if (!profiler.isEnabled)
+        return;
+    profiler.counters.push_back({ name, profiler.frameIndex, getProfilerTime(), value });
+    while (profiler.counters.front().frame <= profiler.frameIndex - profilerTraceFrameCount)
+        profiler.counters.pop_front();
+}
+
+void writeChromeTrace(const std::string& tracePath)
+{
+    if (!profiler.isEnabled)
+        return;
+
+    glFinish();
+    for (int i = 1; i <= profilerFrameLatency; i++)                                                                      // Oldest frame first so events stay ordered by frame.
+        resolveFrame(profiler.frames[(profiler.frameIndex + i) % profilerFrameLatency], true);
+
+    using json = nlohmann::json;
+    const int cpuThread = 0, gpuThread = 1;
+    json traceEvents = json::array();
+    traceEvents.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", cpuThread }, { "args", { { "name", "CPU" } } } });
+    traceEvents.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", gpuThread }, { "args", { { "name", "GPU" } } } });
+
+    for (const ProfileEvent& event : profiler.events) {
+        json args = { { "frame", event.frame }, { "depth", event.depth } };
+        traceEvents.push_back({ { "name", event.name }, { "ph", "X" }, { "pid", 0 }, { "tid", cpuThread },
+                                { "ts", event.cpuStart }, { "dur", event.cpuDuration }, { "args", args } });
+        if (event.gpuDuration >= 0.0)
+            traceEvents.push_back({ { "name", event.name }, { "ph", "X" }, { "pid", 0 }, { "tid", gpuThread },
+                                    { "ts", event.gpuStart }, { "dur", event.gpuDuration }, { "args", args } });
+    }
+    for (const ProfileCounterRecord& counter : profiler.counters)
+        traceEvents.push_back({ { "name", counter.name }, { "ph", "C" }, { "pid", 0 }, { "ts", counter.time },
+                                { "args", { { "value", counter.value } } } });
+
+    std::ofstream traceFile(tracePath);
+    if (!traceFile) {
+        std::cout << "::Error: failed to open profiler trace file " << tracePath << std::endl;
+        return;
+    }
+    traceFile << json({ { "traceEvents", traceEvents }, { "displayTimeUnit", "ms" } }).dump();
+    std::cout << "Profiler trace with " << profiler.events.size() << " zones written to " << tracePath;
+    if (profiler.frameIndex >= profilerTraceFrameCount)
+        std::cout << " (the last " << profilerTraceFrameCount << " of " << profiler.frameIndex + 1 << " frames)";
+    if (profiler.droppedGpuFrameCount > 0)
+        std::cout << " (GPU times of " << profiler.droppedGpuFrameCount << " frames were not ready and dropped)";
+    std::cout << std::endl;
+}
+
+void deleteProfiler()
+{
+    for (ProfilerFrame& frame : profiler.frames) {
+        if (!frame.queries.empty())
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+        frame.queries.clear();
+        frame.zones.clear();
+        frame.usedQueryCount = 0;
+    }
+    profiler.events.clear();
+    profiler.counters.clear();
+    profiler.isEnabled = false;
+    profiler.frameIndex = -1;
+}
+
+ProfileZone::ProfileZone(const char* name)
+{
+    zoneIndex = profiler.isEnabled && profiler.frameIndex >= 0 ? beginZone(name) : -1;
+}
+
+ProfileZone::~ProfileZone()
+{
+    if (zoneIndex >= 0 && profiler.isEnabled)
+        endZone(zoneIndex);
+}
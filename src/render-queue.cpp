@@ -0,0 +1,206 @@
+#include "render-queue.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+
+const int programKeyBits = 12;
+const int materialKeyBits = 16;
+const int vertexArrayKeyBits = 11;
+const int depthKeyBits = 24;
+
+uint64_t RenderQueue::encodeSortKey(uint32_t programRank, uint16_t material, uint32_t vertexArrayRank, GLfloat depth, bool isTranslucent)
+{
+    uint64_t quantizedDepth = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * ((1u << depthKeyBits) - 1));
+    uint64_t stateKey = ((uint64_t)programRank << (materialKeyBits + vertexArrayKeyBits))
+                        | ((uint64_t)material << vertexArrayKeyBits)
+                        | vertexArrayRank;
+
+    if (isTranslucent) {                                                                                                 // Blending needs back to front order, so depth goes first and is inverted.
+        uint64_t invertedDepth = ((1u << depthKeyBits) - 1) - quantizedDepth;
+        return (1ull << 63) | (invertedDepth << (63 - depthKeyBits)) | stateKey;
+    }
+    return (stateKey << depthKeyBits) | quantizedDepth;                                                                  // Opaque draws are grouped by state first, then front to back to help early depth rejection.
+}
+
+uint32_t RenderQueue::getRank(std::unordered_map<GLuint, uint32_t>& ranks, GLuint name, uint32_t maxRank)               // GL names can be arbitrarily large, the key stores a small per-frame index instead.
+{
+    auto rank = ranks.find(name);
+    if (rank != ranks.end())
+        return rank->second;
+    uint32_t newRank = std::min((uint32_t)ranks.size(), maxRank);
+    ranks.emplace(name, newRank);
+    return newRank;
+}
+
+void RenderQueue::submit(const RenderCommand& command)
+{
+    uint32_t programRank = getRank(programRanks, command.shaderProgram, (1u << programKeyBits) - 1);
+    uint32_t vertexArrayRank = getRank(vertexArrayRanks, command.VAO, (1u << vertexArrayKeyBits) - 1);
+    sortItems.push_back({ encodeSortKey(programRank, command.material, vertexArrayRank, command.depth, command.isTranslucent), (uint32_t)commands.size() });
+    commands.push_back(command);
+}
+
+void RenderQueue::sortCommands()                                                                                         // LSD radix sort, 8 bits per pass. Passes where every key has the same byte are skipped.
+{
+    size_t count = sortItems.size();
+    sortScratch.resize(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const SortItem& item : sortItems)
+            histogram[(item.key >> shift) & 0xFF]++;
+        if (histogram[(sortItems[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (size_t& bucket : histogram) {
+            size_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+        for (const SortItem& item : sortItems)
+            sortScratch[histogram[(item.key >> shift) & 0xFF]++] = item;
+        sortItems.swap(sortScratch);
+    }
+}
+
+void RenderQueue::setMultiDrawEnabled(bool isEnabled)
+{
+    isMultiDrawEnabled = isEnabled;
+    isIndirect = isEnabled && isMultiDrawIndirectSupported();
+    if (isIndirect && indirectBuffer == 0)
+        glGenBuffers(1, &indirectBuffer);
+}
+
+bool RenderQueue::canMerge(const RenderCommand& first, const RenderCommand& command) const
+{
+    if (command.shaderProgram != first.shaderProgram || command.VAO != first.VAO || command.material != first.material
+        || command.indexType != first.indexType)
+        return false;
+    return isIndirect || (first.instanceCount == 1 && command.instanceCount == 1 && command.drawId == first.drawId);     // glMultiDrawElementsBaseVertex has neither instances nor draw IDs.
+}
+
+void RenderQueue::uploadIndirectCommands()                                                                               // One command per sorted draw, so a run of draws is a contiguous range of the buffer.
+{
+    indirectCommands.resize(sortItems.size());
+    for (size_t i = 0; i < sortItems.size(); i++) {
+        const RenderCommand& command = commands[sortItems[i].commandIndex];
+        indirectCommands[i] = { (GLuint)command.elementsCount, (GLuint)command.instanceCount,
+                                (GLuint)(command.indexOffset / getIndexSize(command.indexType)), command.baseVertex, command.drawId };
+    }
+    GLsizeiptr size = indirectCommands.size() * sizeof(DrawElementsIndirectCommand);
+    indirectBufferSize = std::max(indirectBufferSize, size);
+    getGlStateCache().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectBufferSize, nullptr, GL_STREAM_DRAW);                                  // Orphans last frame's commands.
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, indirectCommands.data());
+}
+
+void RenderQueue::drawRun(size_t firstItem, size_t itemCount)
+{
+    const RenderCommand& command = commands[sortItems[firstItem].commandIndex];
+    if (isIndirect) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, command.indexType, (void*)(firstItem * sizeof(DrawElementsIndirectCommand)), itemCount, 0);
+        return;
+    }
+
+    if (command.drawId != constantDrawId) {                                                                              // Read by VAOs without a draw ID array (see multi-draw.hpp).
+        glVertexAttribI1ui(drawIdAttributeLocation, command.drawId);
+        constantDrawId = command.drawId;
+    }
+    if (itemCount == 1) {
+        if (command.drawId != 0 && GLAD_GL_ARB_base_instance)                                                            // Read by VAOs with a draw ID array.
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.elementsCount, command.indexType, (void*)command.indexOffset,
+                                                          command.instanceCount, command.baseVertex, command.drawId);
+        else if (command.instanceCount == 1)
+            glDrawElementsBaseVertex(GL_TRIANGLES, command.elementsCount, command.indexType, (void*)command.indexOffset, command.baseVertex);
+        else
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.elementsCount, command.indexType, (void*)command.indexOffset,
+                                              command.instanceCount, command.baseVertex);
+        return;
+    }
+
+    multiDrawCounts.clear();
+    multiDrawOffsets.clear();
+    multiDrawBaseVertices.clear();
+    for (size_t i = firstItem; i < firstItem + itemCount; i++) {
+        const RenderCommand& runCommand = commands[sortItems[i].commandIndex];
+        multiDrawCounts.push_back(runCommand.elementsCount);
+        multiDrawOffsets.push_back((const void*)runCommand.indexOffset);
+        multiDrawBaseVertices.push_back(runCommand.baseVertex);
+    }
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, multiDrawCounts.data(), command.indexType, multiDrawOffsets.data(), itemCount,
+                                  multiDrawBaseVertices.data());
+}
+
+void RenderQueue::execute()
+{
+    stats = RenderQueueStats();
+    if (commands.empty())
+        return;
+    sortCommands();
+    if (isIndirect)
+        uploadIndirectCommands();
+
+    GLuint currentProgram = 0, currentVAO = 0;
+    uint16_t currentMaterial = 0;
+    bool isFirst = true;
+    for (size_t firstItem = 0; firstItem < sortItems.size();) {
+        const RenderCommand& command = commands[sortItems[firstItem].commandIndex];
+        size_t endItem = firstItem + 1;
+        while (isMultiDrawEnabled && endItem < sortItems.size() && canMerge(command, commands[sortItems[endItem].commandIndex]))
+            endItem++;
+
+        bool isProgramChanged = isFirst || command.shaderProgram != currentProgram;
+        if (isProgramChanged) {
+            getGlStateCache().useProgram(command.shaderProgram);
+            currentProgram = command.shaderProgram;
+            stats.programBindCount++;
+        }
+        else
+            stats.elidedBindCount++;
+
+        if (isFirst || command.VAO != currentVAO) {
+            getGlStateCache().bindVertexArray(command.VAO);
+            currentVAO = command.VAO;
+            stats.vertexArrayBindCount++;
+        }
+        else
+            stats.elidedBindCount++;
+
+        if (isProgramChanged || command.material != currentMaterial) {                                                   // Material parameters are program state, a new program needs them again.
+            if (materialBinder && command.material != 0) {
+                materialBinder(command.shaderProgram, command.material);
+                stats.materialBindCount++;
+            }
+            currentMaterial = command.material;
+        }
+        else
+            stats.elidedBindCount++;
+        isFirst = false;
+
+        drawRun(firstItem, endItem - firstItem);
+        stats.drawCount += endItem - firstItem;
+        stats.drawCallCount++;
+        firstItem = endItem;
+    }
+    if (constantDrawId != 0) {                                                                                           // Draws outside the queue read draw ID 0.
+        glVertexAttribI1ui(drawIdAttributeLocation, 0);
+        constantDrawId = 0;
+    }
+    clear();
+}
+
+void RenderQueue::clear()
+{
+    commands.clear();
+    sortItems.clear();
+    programRanks.clear();
+    vertexArrayRanks.clear();
+}
+
+void RenderQueue::deleteRenderQueue()
+{
+    if (indirectBuffer != 0) {
+        getGlStateCache().onBufferDeleted(indirectBuffer);
+        glDeleteBuffers(1, &indirectBuffer);
+        indirectBuffer = 0;
+    }
+}
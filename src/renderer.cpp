@@ -1,62 +1,175 @@
 #include "renderer.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+#include <cstddef>
 
-int attributeCount = 0;
+void enableVertexLayout(const VertexAttribute* attributes, int attributeCount, GLsizei stride)
+{
+    for (int i = 0; i < attributeCount; i++) {
+        const VertexAttribute& attribute = attributes[i];
+        if (attribute.isInteger)
+            glVertexAttribIPointer(attribute.location, attribute.componentCount, attribute.type, stride, (void*)attribute.offset);
+        else
+            glVertexAttribPointer(attribute.location, attribute.componentCount, attribute.type, attribute.isNormalized,  // Defines an array of generic vertex attribute data per each attribute.
+                                  stride, (void*)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);                                                                   // Enables the generic vertex attribute array specified by index.
+    }
+}
+
+void enableInstanceAttributeFloat(GLuint location, GLint size, void* pointer, GLsizei stride = sizeof(InstanceData))
+{
+    glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, pointer);
+    glEnableVertexAttribArray(location);
+    glVertexAttribDivisor(location, 1);                                                                          // Advances the attribute once per instance instead of once per vertex.
+}
 
-void enableVertexAttributeFloat(GLint size, void* pointer, GLboolean normalized = GL_FALSE)
+GLenum getIndexType(size_t vertexCount)
 {
-    glVertexAttribPointer(attributeCount, size, GL_FLOAT, normalized, sizeof(Vertex), pointer);        // Defines an array of generic vertex attribute data per each attribute.
-    glEnableVertexAttribArray(attributeCount);                                                                    // Enables the generic vertex attribute array specified by index.
-    attributeCount++;
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;                                                  // Half the index bandwidth and post-transform cache lookups for most meshes.
 }
 
-VertexArrayData getVertexArrayData(std::vector<Vertex> vertices, std::vector <GLuint> indices)                           // Creates memory on the GPU to store vertex data ( via so-called vertex buffer objects (VBO) ) as large batches of data, configures how OpenGL should interpret the said memory, specifies how to send the data to the graphics card.
+GLsizeiptr getIndexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+GLenum uploadIndices(const std::vector<GLuint>& indices, size_t vertexCount)
+{
+    GLenum indexType = getIndexType(vertexCount);
+    if (indexType == GL_UNSIGNED_INT) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        return indexType;
+    }
+    std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+    return indexType;
+}
+
+VertexArrayData createVertexArrayData(const void* vertices, size_t vertexCount, size_t verticesSize, const std::vector<GLuint>& indices,
+                                      const VertexAttribute* attributes, int attributeCount, GLsizei stride)             // Creates memory on the GPU to store vertex data ( via so-called vertex buffer objects (VBO) ) as large batches of data, configures how OpenGL should interpret the said memory, specifies how to send the data to the graphics card.
 {                                                                                                                        // P.S. Sending data to the graphics card from the CPU is relatively slow, so whenever is possible it's best to send as much data as possible at once. Once the data is in the graphics card's memory the vertex shader has almost instant access to the vertices making it extremely fast.
     VertexArrayData vertexArrayData = VertexArrayData(1, 1, 1);
 
     glGenVertexArrays(vertexArrayData.getBoundVAOCount(), vertexArrayData.boundVAO);                            // returns buffer object name in VAO.
     glGenBuffers(vertexArrayData.getBoundEBOCount(), vertexArrayData.boundEBO);                                // returns buffer object name in EBO.
     glGenBuffers(vertexArrayData.getBoundVBOCount(), vertexArrayData.boundVBO);                                // Returns buffer object name in VBO.
-    glBindVertexArray(*vertexArrayData.boundVAO);                                                                  // Binds the vertex array object with name VAO.
+    getGlStateCache().bindVertexArray(*vertexArrayData.boundVAO);                                                                  // Binds the vertex array object with name VAO.
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *vertexArrayData.boundEBO);                                         // set EBO as currently bound GL_ELEMENT_ARRAY_BUFFER (Vertex array indices).
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), &indices[0], GL_STATIC_DRAW);          // Creates and initializes a buffer object's data store.
+    getGlStateCache().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, *vertexArrayData.boundEBO);                                         // set EBO as currently bound GL_ELEMENT_ARRAY_BUFFER (Vertex array indices).
+    vertexArrayData.indexType = uploadIndices(indices, vertexCount);                                                     // Creates and initializes a buffer object's data store.
                                                                                                                          // With GL_STATIC_DRAW data store contents will be modified once and used many times as the source for GL drawing commands.
-    glBindBuffer(GL_ARRAY_BUFFER, *vertexArrayData.boundVBO);                                                // Set VBO as currently bound GL_ARRAY_BUFFER (Vertex attributes).
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, *vertexArrayData.boundVBO);                                                // Set VBO as currently bound GL_ARRAY_BUFFER (Vertex attributes).
+    glBufferData(GL_ARRAY_BUFFER, verticesSize, vertices, GL_STATIC_DRAW);
 
-    enableVertexAttributeFloat( sizeof(Position{}) / sizeof (GLfloat), (void*)0);                            // Position attribute enabled.
-    enableVertexAttributeFloat(sizeof(Color{}) / sizeof (GLfloat), (void*)(sizeof(Position)));               // Color attribute enabled.
-    enableVertexAttributeFloat(sizeof(UV{}) / sizeof (GLfloat), (void*)(sizeof(Color)));                     // UV attribute enabled.
-    enableVertexAttributeFloat(sizeof(Position{}) / sizeof (GLfloat), (void*)(sizeof(UV)));                  // Normals attribute enabled.
+    enableVertexLayout(attributes, attributeCount, stride);
 
     return vertexArrayData;
 }
 
+InstanceBuffer getInstanceBuffer(const VertexArrayData& vertexArrayData, int capacity, bool hasTextureReferences)        // Creates a buffer for up to capacity instances and attaches it to the mesh's VAO next to the per-vertex attributes.
+{
+    InstanceBuffer instanceBuffer = { 0, capacity };
+    glGenBuffers(1, &instanceBuffer.VBO);
+    getGlStateCache().bindVertexArray(*vertexArrayData.boundVAO);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.VBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+
+    for (GLuint column = 0; column < 4; column++)                                                                        // A mat4 attribute is passed as four vec4 attributes in consecutive locations.
+        enableInstanceAttributeFloat(instanceAttributeLocation + column, 4, (void*)(offsetof(InstanceData, model) + column * 4 * sizeof(GLfloat)));
+    enableInstanceAttributeFloat(instanceAttributeLocation + 4, 4, (void*)offsetof(InstanceData, color));
+    if (hasTextureReferences) {                                                                                          // A second per-instance stream, untextured VAOs leave locations 10 and 11 disabled.
+        glGenBuffers(1, &instanceBuffer.textureVBO);
+        getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.textureVBO);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(TextureReference), nullptr, GL_STREAM_DRAW);
+        glVertexAttribIPointer(instanceTextureAttributeLocation, 2, GL_UNSIGNED_INT, sizeof(TextureReference), (void*)offsetof(TextureReference, handle));
+        glEnableVertexAttribArray(instanceTextureAttributeLocation);
+        glVertexAttribDivisor(instanceTextureAttributeLocation, 1);
+        enableInstanceAttributeFloat(instanceTextureAttributeLocation + 1, 1, (void*)offsetof(TextureReference, layer), sizeof(TextureReference));
+    }
+
+    getGlStateCache().bindVertexArray(0);
+    return instanceBuffer;
+}
+
+void drawInstanced(GLuint shaderProgram, GLuint VAO, int ElementsCount, GLenum indexType, const InstanceBuffer& instanceBuffer, const std::vector<InstanceData>& instances,
+                   const std::vector<TextureReference>& textureReferences)
+{
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(VAO);
+    bool hasTextureReferences = instanceBuffer.textureVBO != 0 && textureReferences.size() >= instances.size();
+
+    for (size_t first = 0; first < instances.size(); first += instanceBuffer.capacity) {                                 // One draw call per capacity instances, usually exactly one.
+        int instanceCount = (int)std::min(instances.size() - first, (size_t)instanceBuffer.capacity);
+        getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.VBO);
+        glBufferData(GL_ARRAY_BUFFER, instanceBuffer.capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);       // Orphans the previous contents so the upload does not wait for draws still reading them.
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(InstanceData), &instances[first]);
+        if (hasTextureReferences) {
+            getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, instanceBuffer.textureVBO);
+            glBufferData(GL_ARRAY_BUFFER, instanceBuffer.capacity * sizeof(TextureReference), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(TextureReference), &textureReferences[first]);
+        }
+        glDrawElementsInstanced(GL_TRIANGLES, ElementsCount, indexType, 0, instanceCount);
+    }
+}
+
+GLuint createStreamVertexArray(const StreamBuffer& vertexBuffer, const StreamBuffer& indexBuffer)                       // Creates a VAO reading vertices and indices from stream buffers. Data is written there every frame and drawn with drawStream().
+{
+    GLuint VAO;
+    glGenVertexArrays(1, &VAO);
+    getGlStateCache().bindVertexArray(VAO);
+    getGlStateCache().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.ID);
+    getGlStateCache().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer.ID);
+    enableVertexLayout<Vertex>();
+    getGlStateCache().bindVertexArray(0);
+    return VAO;
+}
+
 void clearAllBuffers()
 {
-    glClearColor(Color::grey().r, Color::grey().g, Color::grey().b, 1.0f);                                                          // State-setting function: glClearColor specifies the red, green, blue, and alpha values used by glClear to clear the color buffers. Values specified by glClearColor are clamped to the range [0,1].
+    getGlStateCache().setClearColor(Color::grey());                                                                      // State-setting function: glClearColor specifies the red, green, blue, and alpha values used by glClear to clear the color buffers. Values specified by glClearColor are clamped to the range [0,1].
     glClear(GL_COLOR_BUFFER_BIT);                                                                                  // State-using function: clears buffers to preset values, previously selected by glClearColor, glClearDepth, and glClearStencil. As many color buffers can be selected to be drawn into as there is in glDrawBuffer.
 }
 
-void draw(GLuint shaderProgram, GLuint VAO, int ElementsCount)
+void draw(GLuint shaderProgram, GLuint VAO, int ElementsCount, GLenum indexType)
 {
-    glUseProgram(shaderProgram);
-
-    // update the uniform color
-    GLfloat timeValue = glfwGetTime();
-    GLfloat normalizedValue = timeValue;
-    GLint vertexColorLocation = glGetUniformLocation(shaderProgram, "uniformColor");
-    glUniform1f(vertexColorLocation, normalizedValue);
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, ElementsCount, indexType, 0);                                      // Primitives is an interpretation scheme used by OpenGL to determine what a stream of vertices represents when being rendered e.g. "GL_POINTS".
+}
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, ElementsCount, GL_UNSIGNED_INT, 0);                            // Primitives is an interpretation scheme used by OpenGL to determine what a stream of vertices represents when being rendered e.g. "GL_POINTS".
+void drawStream(GLuint shaderProgram, GLuint VAO, const StreamAllocation& vertices, const StreamAllocation& indices, int ElementsCount)
+{
+    getGlStateCache().useProgram(shaderProgram);
+    getGlStateCache().bindVertexArray(VAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, ElementsCount, GL_UNSIGNED_INT, (void*)indices.offset,        // Indices are relative to the frame's vertices, baseVertex moves them to where the vertices were streamed to.
+                             vertices.offset / sizeof(Vertex));
 }
 
-void cleanGlResources(VertexArrayData vertexArrayData, GLuint shaderProgram)
+void cleanVertexArrayData(VertexArrayData vertexArrayData)
 {
+    for (int i = 0; i < vertexArrayData.getBoundVAOCount(); i++)
+        getGlStateCache().onVertexArrayDeleted(vertexArrayData.boundVAO[i]);
+    for (int i = 0; i < vertexArrayData.getBoundVBOCount(); i++)
+        getGlStateCache().onBufferDeleted(vertexArrayData.boundVBO[i]);
+    for (int i = 0; i < vertexArrayData.getBoundEBOCount(); i++)
+        getGlStateCache().onBufferDeleted(vertexArrayData.boundEBO[i]);
     glDeleteVertexArrays(vertexArrayData.getBoundVAOCount(), vertexArrayData.boundVAO);
     glDeleteBuffers(vertexArrayData.getBoundVBOCount(), vertexArrayData.boundVBO);
     glDeleteBuffers(vertexArrayData.getBoundEBOCount(), vertexArrayData.boundEBO);
     vertexArrayData.deleteVertexArrayData();
+}
+
+void cleanInstanceBuffer(InstanceBuffer instanceBuffer)
+{
+    getGlStateCache().onBufferDeleted(instanceBuffer.VBO);
+    getGlStateCache().onBufferDeleted(instanceBuffer.textureVBO);
+    GLuint buffers[] = { instanceBuffer.VBO, instanceBuffer.textureVBO };
+    glDeleteBuffers(2, buffers);                                                                                         // Name 0 is silently ignored.
+}
+
+void cleanGlResources(VertexArrayData vertexArrayData, GLuint shaderProgram)
+{
+    cleanVertexArrayData(vertexArrayData);
+    getGlStateCache().onProgramDeleted(shaderProgram);
     glDeleteProgram(shaderProgram);
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "shader-cache.hpp"
+#include "filesystem-utils.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+struct ShaderCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t cacheKey;                                                                                                   // Repeated in the file so a renamed or truncated entry is never loaded.
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+const char shaderCacheMagic[4] = { 'E', 'G', 'S', 'C' };
+const uint32_t shaderCacheVersion = 1;                                                                                   // Bump when the header or key layout changes.
+
+ShaderCacheStats shaderCacheStats;
+
+bool isShaderCacheSupported()
+{
+    static int isSupported = -1;
+    if (isSupported < 0) {
+        GLint formatCount = 0;
+        if (GLAD_GL_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        isSupported = formatCount > 0;
+    }
+    return isSupported;
+}
+
+uint64_t hashShaderCacheData(const char* data, size_t size, uint64_t hash)                                              // 64-bit FNV-1a.
+{
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (uint8_t)data[i]) * 1099511628211ull;
+    return hash;
+}
+
+uint64_t getShaderCacheKey(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum driverString : driverStrings) {
+        const char* value = (const char*)glGetString(driverString);
+        if (value != nullptr)
+            hash = hashShaderCacheData(value, strlen(value) + 1, hash);                                                  // The terminator is hashed too, so "ab" + "c" and "a" + "bc" differ.
+    }
+    for (const ShaderSource* source : { &vertexShaderSource, &fragmentShaderSource }) {
+        for (size_t i = 0; i < source->strings.size(); i++)                                                              // Piece boundaries do not matter, only the concatenated text.
+            hash = hashShaderCacheData(source->strings[i], source->lengths[i], hash);
+        hash = hashShaderCacheData("", 1, hash);
+    }
+    return hash;
+}
+
+std::string getShaderCacheEntryPath(uint64_t cacheKey)
+{
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)cacheKey);
+    return (std::filesystem::path(getShaderCacheDirectory()) / fileName).string();
+}
+
+GLuint readProgramBinary(uint64_t cacheKey)
+{
+    std::ifstream file(getShaderCacheEntryPath(cacheKey), std::ios::binary);
+    if (!file)
+        return 0;
+
+    ShaderCacheHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, shaderCacheMagic, sizeof(shaderCacheMagic)) != 0
+            || header.version != shaderCacheVersion || header.cacheKey != cacheKey)
+        return 0;
+    std::vector<char> binary(header.binarySize);
+    if (!file.read(binary.data(), binary.size()))
+        return 0;
+
+    GLuint shaderProgram = glCreateProgram();
+    glProgramBinary(shaderProgram, header.binaryFormat, binary.data(), binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);                                                             // A rejected binary is reported as a failed link, not as a GL error.
+    if (!success) {
+        glDeleteProgram(shaderProgram);
+        shaderCacheStats.rejectedCount++;
+        return 0;
+    }
+    return shaderProgram;
+}
+
+GLuint loadProgramBinary(uint64_t cacheKey)
+{
+    if (!isShaderCacheSupported())
+        return 0;
+
+    GLuint shaderProgram = readProgramBinary(cacheKey);
+    if (shaderProgram != 0)
+        shaderCacheStats.hitCount++;
+    else
+        shaderCacheStats.missCount++;
+    return shaderProgram;
+}
+
+void saveProgramBinary(GLuint shaderProgram, uint64_t cacheKey)
+{
+    if (!isShaderCacheSupported())
+        return;
+
+    GLint binarySize = 0;
+    glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0)
+        return;
+    std::vector<char> binary(binarySize);
+    GLenum binaryFormat;
+    glGetProgramBinary(shaderProgram, binarySize, &binarySize, &binaryFormat, binary.data());
+
+    ShaderCacheHeader header;
+    memcpy(header.magic, shaderCacheMagic, sizeof(shaderCacheMagic));
+    header.version = shaderCacheVersion;
+    header.cacheKey = cacheKey;
+    header.binaryFormat = binaryFormat;
+    header.binarySize = binarySize;
+
+    std::string entryPath = getShaderCacheEntryPath(cacheKey);
+    std::string temporaryPath = entryPath + ".tmp";                                                                      // Written aside and renamed, so a crash or a second instance never leaves a half written entry.
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), binarySize)) {
+            std::cout << "::Error: failed to write shader cache entry " << temporaryPath << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, entryPath, error);
+    if (error) {
+        std::cout << "::Error: failed to store shader cache entry " << entryPath << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+GLuint createCachedShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource)
+{
+    uint64_t cacheKey = getShaderCacheKey(vertexShaderSource, fragmentShaderSource);
+    GLuint shaderProgram = loadProgramBinary(cacheKey);
+    if (shaderProgram != 0)
+        return shaderProgram;
+
+    shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    GLint success = GL_FALSE;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (success)
+        saveProgramBinary(shaderProgram, cacheKey);
+    return shaderProgram;
+}
+
+const ShaderCacheStats& getShaderCacheStats()
+{
+    return shaderCacheStats;
+}
@@ -0,0 +1,85 @@
+#include "shader-loader.hpp"
+#include "shader-cache.hpp"
+#include "gl-state-cache.hpp"
+
+ShaderLoader::ShaderLoader()
+{
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);                                                                       // Let the implementation pick the number of compiler threads.
+}
+
+ShaderProgramHandle ShaderLoader::load(const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+                                       const ShaderDefines& defines)
+{
+    LoadingProgram loadingProgram = { shaderLoadFailed, {}, 0, nullptr };
+    ShaderSource vertexShaderSource, fragmentShaderSource;
+    if (preprocessShader(vertexShaderAbsolutePath, defines, vertexShaderSource) && preprocessShader(fragmentShaderAbsolutePath, defines, fragmentShaderSource)) {
+        loadingProgram.cacheKey = getShaderCacheKey(vertexShaderSource, fragmentShaderSource);
+        GLuint cachedProgram = loadProgramBinary(loadingProgram.cacheKey);
+        if (cachedProgram != 0) {
+            loadingProgram.state = shaderLoadReady;
+            loadingProgram.program = new ShaderProgram(cachedProgram);
+        }
+        else {
+            loadingProgram.state = shaderLoadPending;
+            loadingProgram.build = submitShaderProgram(vertexShaderSource, fragmentShaderSource);
+            pendingCount++;
+        }
+    }
+
+    programs.push_back(loadingProgram);
+    return programs.size() - 1;
+}
+
+void ShaderLoader::finish(LoadingProgram& loadingProgram)
+{
+    GLuint program = finishShaderProgram(loadingProgram.build);
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success) {
+        saveProgramBinary(program, loadingProgram.cacheKey);
+        loadingProgram.program = new ShaderProgram(program);
+        loadingProgram.state = shaderLoadReady;
+    }
+    else {
+        glDeleteProgram(program);
+        loadingProgram.state = shaderLoadFailed;
+    }
+    pendingCount--;
+}
+
+void ShaderLoader::poll()
+{
+    if (pendingCount == 0)
+        return;
+
+    for (LoadingProgram& loadingProgram : programs)
+        if (loadingProgram.state == shaderLoadPending && isShaderProgramBuildComplete(loadingProgram.build))
+            finish(loadingProgram);
+}
+
+void ShaderLoader::wait(ShaderProgramHandle handle)
+{
+    if (programs[handle].state == shaderLoadPending)
+        finish(programs[handle]);
+}
+
+void ShaderLoader::waitAll()
+{
+    for (LoadingProgram& loadingProgram : programs)                                                                      // In submission order, the driver finishes them roughly in that order too.
+        if (loadingProgram.state == shaderLoadPending)
+            finish(loadingProgram);
+}
+
+void ShaderLoader::deleteShaderLoader()
+{
+    waitAll();
+    for (LoadingProgram& loadingProgram : programs) {
+        if (loadingProgram.program == nullptr)
+            continue;
+        getGlStateCache().onProgramDeleted(loadingProgram.program->ID);
+        glDeleteProgram(loadingProgram.program->ID);
+        delete loadingProgram.program;
+    }
+    programs.clear();
+}
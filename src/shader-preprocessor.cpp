@@ -0,0 +1,186 @@
+#include "shader-preprocessor.hpp"
+#include "shader-cache.hpp"
+#include "gl-state-cache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+const int maxShaderIncludeDepth = 32;
+
+struct PreprocessorState
+{
+    const ShaderDefines* defines;
+    std::vector<std::string> files;                                                                                      // Index in this list is the source string number used in #line.
+    std::vector<std::string> includeStack;
+    std::vector<std::string> onceFiles;
+    ShaderSource* result;
+};
+
+std::string getPermutationKey(const ShaderDefines& defines)
+{
+    std::vector<std::string> entries;
+    for (const ShaderDefine& define : defines)
+        entries.push_back(define.value.empty() ? define.name : define.name + "=" + define.value);
+    std::sort(entries.begin(), entries.end());
+
+    std::string key;
+    for (const std::string& entry : entries)
+        key += (key.empty() ? "" : ";") + entry;
+    return key;
+}
+
+bool startsWithDirective(const char* line, const char* lineEnd, const char* directive, const char*& position)           // Skips leading blanks, position ends up right after the directive.
+{
+    while (line < lineEnd && (*line == ' ' || *line == '\t'))
+        line++;
+    size_t length = strlen(directive);
+    if ((size_t)(lineEnd - line) < length || memcmp(line, directive, length) != 0)
+        return false;
+    position = line + length;
+    return position == lineEnd || strchr(" \t\r\"", *position) != nullptr;                                                // #includeX is another word, not #include.
+}
+
+bool hasVersionDirective(const char* data, const char* dataEnd)
+{
+    const char* position;
+    for (const char* line = data; line < dataEnd; ) {
+        const char* lineEnd = (const char*)memchr(line, '\n', dataEnd - line);
+        if (startsWithDirective(line, lineEnd == nullptr ? dataEnd : lineEnd, "#version", position))
+            return true;
+        line = lineEnd == nullptr ? dataEnd : lineEnd + 1;
+    }
+    return false;
+}
+
+void appendDefines(PreprocessorState& state, int nextLineNumber)
+{
+    for (const ShaderDefine& define : *state.defines)
+        state.result->appendGenerated("#define " + define.name + (define.value.empty() ? "" : " " + define.value) + "\n");
+    state.result->appendGenerated("#line " + std::to_string(nextLineNumber) + " 0\n");
+}
+
+bool preprocessFile(PreprocessorState& state, const std::string& path)                                                   // Appends slices of the mapped file, only the lines that are replaced become generated text.
+{
+    std::string normalizedPath = std::filesystem::path(path).lexically_normal().string();
+    if (std::find(state.onceFiles.begin(), state.onceFiles.end(), normalizedPath) != state.onceFiles.end())
+        return true;
+    if (std::find(state.includeStack.begin(), state.includeStack.end(), normalizedPath) != state.includeStack.end()
+            || (int)state.includeStack.size() >= maxShaderIncludeDepth) {
+        std::cout << "::Error: recursive #include of " << normalizedPath << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(normalizedPath))
+        return false;
+    state.result->files.push_back(file);
+
+    int fileIndex = state.files.size();
+    state.files.push_back(normalizedPath);
+    state.includeStack.push_back(normalizedPath);
+    if (fileIndex > 0)
+        state.result->appendGenerated("#line 1 " + std::to_string(fileIndex) + "\n");
+
+    const char* fileEnd = file->getData() + file->getSize();
+    if (fileIndex == 0 && !state.defines->empty() && !hasVersionDirective(file->getData(), fileEnd))                    // Without #version the defines go first.
+        appendDefines(state, 1);
+    const char* runStart = file->getData();                                                                              // Start of the lines not appended yet.
+    int lineNumber = 0;
+    for (const char* line = file->getData(); line < fileEnd; ) {
+        const char* lineEnd = (const char*)memchr(line, '\n', fileEnd - line);
+        const char* nextLine = lineEnd == nullptr ? fileEnd : lineEnd + 1;
+        if (lineEnd == nullptr)
+            lineEnd = fileEnd;
+        lineNumber++;
+
+        const char* position;
+        if (startsWithDirective(line, lineEnd, "#include", position)) {
+            const char* open = (const char*)memchr(position, '"', lineEnd - position);
+            const char* close = open == nullptr ? nullptr : (const char*)memchr(open + 1, '"', lineEnd - open - 1);
+            if (close == nullptr) {
+                std::cout << "::Error: " << normalizedPath << ":" << lineNumber << ": malformed #include" << std::endl;
+                return false;
+            }
+            state.result->append(runStart, line - runStart);
+            std::filesystem::path includePath = std::filesystem::path(normalizedPath).parent_path() / std::string(open + 1, close);
+            if (!preprocessFile(state, includePath.string()))
+                return false;
+            state.result->appendGenerated("#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n");
+            runStart = nextLine;
+        }
+        else if (startsWithDirective(line, lineEnd, "#pragma once", position)) {
+            state.onceFiles.push_back(normalizedPath);
+            state.result->append(runStart, line - runStart);
+            state.result->appendGenerated("\n");                                                                        // Keeps the line count.
+            runStart = nextLine;
+        }
+        else if (fileIndex == 0 && startsWithDirective(line, lineEnd, "#version", position)) {                           // #version has to stay first, the defines follow it.
+            state.result->append(runStart, nextLine - runStart);
+            if (nextLine == fileEnd)
+                state.result->appendGenerated("\n");
+            appendDefines(state, lineNumber + 1);
+            runStart = nextLine;
+        }
+        line = nextLine;
+    }
+    state.result->append(runStart, fileEnd - runStart);
+    if (file->getSize() > 0 && fileEnd[-1] != '\n')
+        state.result->appendGenerated("\n");                                                                            // A following #line has to start on its own line.
+    state.includeStack.pop_back();
+    return true;
+}
+
+bool preprocessShader(const std::string& shaderAbsolutePath, const ShaderDefines& defines, ShaderSource& result,
+                      std::vector<std::string>* dependencies)
+{
+    PreprocessorState state;
+    state.defines = &defines;
+    ShaderSource source;
+    state.result = &source;
+    bool isSuccess = preprocessFile(state, shaderAbsolutePath);
+    if (dependencies != nullptr)
+        *dependencies = state.files;
+    if (!isSuccess)
+        return false;
+    result = std::move(source);
+    return true;
+}
+
+ShaderProgram* ShaderVariantCache::getVariant(const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+                                              const ShaderDefines& defines)
+{
+    std::string key = vertexShaderAbsolutePath + "|" + fragmentShaderAbsolutePath + "|" + getPermutationKey(defines);
+    auto variant = variants.find(key);
+    if (variant != variants.end())
+        return variant->second;
+
+    ShaderProgram* program = nullptr;
+    ShaderSource vertexShaderSource, fragmentShaderSource;
+    if (preprocessShader(vertexShaderAbsolutePath, defines, vertexShaderSource)
+            && preprocessShader(fragmentShaderAbsolutePath, defines, fragmentShaderSource)) {
+        GLuint programID = createCachedShaderProgram(vertexShaderSource, fragmentShaderSource);
+        GLint success = GL_FALSE;
+        glGetProgramiv(programID, GL_LINK_STATUS, &success);
+        if (success)
+            program = new ShaderProgram(programID);
+        else
+            glDeleteProgram(programID);
+    }
+    if (program == nullptr)
+        std::cout << "::Error: shader variant [" << getPermutationKey(defines) << "] failed to build" << std::endl;
+    variants[key] = program;
+    return program;
+}
+
+void ShaderVariantCache::deleteShaderVariants()
+{
+    for (auto& variant : variants) {
+        if (variant.second == nullptr)
+            continue;
+        getGlStateCache().onProgramDeleted(variant.second->ID);
+        glDeleteProgram(variant.second->ID);
+        delete variant.second;
+    }
+    variants.clear();
+}
@@ -1,107 +1,278 @@
 #include "shader-program.hpp"
+#include "gl-state-cache.hpp"
+#include "uniform-buffer.hpp"
+#include "shader-cache.hpp"
+#include "shader-preprocessor.hpp"
 
 #include <iostream> 
-#include <fstream>
-#include <sstream>
 #include <cstring>
 #include <map>
 
 std::map<GLuint , std::string> shaderTypeName
 {
     { GL_VERTEX_SHADER, "Vertex shader" },
-    { GL_FRAGMENT_SHADER, "Fragment shader" }
+    { GL_FRAGMENT_SHADER, "Fragment shader" },
+    { GL_COMPUTE_SHADER, "Compute shader" }
 };
 
-unsigned int createShader(GLenum shaderType, const char* shaderSource)                                                   // Creates glsl shader needed type from given shader source code.
+ShaderSource::ShaderSource(const char* text)
 {
-	unsigned int shader = glCreateShader(shaderType);                                                               // Creates an empty shader object and returns a non-zero value by which it can be referenced.
-	glShaderSource(shader, 1, &shaderSource, nullptr);                                                 // Replaces the source code in a shader object.
+    append(text, strlen(text));
+}
+
+void ShaderSource::append(const char* text, size_t length)
+{
+    if (length == 0)
+        return;
+    strings.push_back(text);
+    lengths.push_back(length);
+}
+
+void ShaderSource::appendGenerated(std::string text)
+{
+    generatedText.push_back(std::move(text));
+    append(generatedText.back().data(), generatedText.back().size());
+}
+
+std::string ShaderSource::toString() const
+{
+    std::string result;
+    for (size_t i = 0; i < strings.size(); i++)
+        result.append(strings[i], lengths[i]);
+    return result;
+}
+
+GLuint compileShader(GLenum shaderType, const ShaderSource& shaderSource)                                                // Submits the shader for compilation without waiting for it.
+{
+	GLuint shader = glCreateShader(shaderType);                                                                     // Creates an empty shader object and returns a non-zero value by which it can be referenced.
+	glShaderSource(shader, shaderSource.strings.size(), shaderSource.strings.data(), shaderSource.lengths.data());   // Replaces the source code in a shader object, GL copies the pieces so they can be released right after.
     glCompileShader(shader);                                                                                             // Compiles a shader object with compilation status stored as part of the shader object's state (GL_COMPILE_STATUS).
+	return shader;
+}
 
+bool checkShaderCompileStatus(GLuint shader, GLenum shaderType)                                                          // Blocks until the shader is compiled, unless isShaderProgramBuildComplete() returned true before.
+{
     int  success;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);                                                    // Reads parameter GL_COMPILE_STATUS value from shader into success.
 	if (!success) {
         char infoLog[512];
 		glGetShaderInfoLog(shader, 512, nullptr, infoLog);                                                 // Returns the shader object's information log modified when the shader is compiled.
 		std::cout << "::" << shaderTypeName[shaderType] << ": compilation failed\n" << infoLog << std::endl;
-		return 0;
 	}
+	return success;
+}
 
-	return shader;
+ShaderProgramBuild submitShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource)
+{
+    ShaderProgramBuild build;
+	build.vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+	build.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+	build.program = glCreateProgram();                                                                                   // Creates shader program object and get its ID.
+
+	glAttachShader(build.program, build.vertexShader);                                                    // Any number of shader objects can be attached at once as long as they have a different shader type.
+	glAttachShader(build.program, build.fragmentShader);
+	if (GLAD_GL_ARB_get_program_binary)
+		glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);                                // Lets the shader cache read the linked binary back.
+	glLinkProgram(build.program);                                                                                // This step puts all shaders together and matches each output to each input.
+	return build;                                                                                                        // Linking shaders that failed to compile simply fails the link, the logs are printed by finishShaderProgram().
 }
 
-GLuint createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)                             // Creates shader program with given vertex shader source code and fragment shader source code.
+bool isShaderProgramBuildComplete(const ShaderProgramBuild& build)
 {
-	unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
-	unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-	unsigned int shaderProgram = glCreateProgram();                                                                      // Creates shader program object and get its ID.
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+        return true;                                                                                                     // Without the extension every status query may block, so the build counts as complete and finishing it waits.
+
+    GLint isComplete = GL_FALSE;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &isComplete);                                                // Never blocks, unlike GL_LINK_STATUS.
+    return isComplete;
+}
 
-	glAttachShader(shaderProgram, vertexShader);                                                          // Any number of shader objects can be attached at once as long as they have a different shader type.
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);                                                                                // This step puts all shaders together and matches each output to each input.
-                                                                                                                         // The status of the link operation will be stored as part of the program object's state (GL_LINK_STATUS), and can fail for a number of reasons.
-    int  success;                                                                                                        // more information can be obtained at https://registry.khronos.org/OpenGL-Refpages/gl4/html/glLinkProgram.xhtml
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+GLuint finishShaderProgram(const ShaderProgramBuild& build)
+{
+    int  success;                                                                                                        // The status of the link operation will be stored as part of the program object's state (GL_LINK_STATUS), and can fail for a number of reasons.
+	glGetProgramiv(build.program, GL_LINK_STATUS, &success);                                              // more information can be obtained at https://registry.khronos.org/OpenGL-Refpages/gl4/html/glLinkProgram.xhtml
 	if (!success) {
+        checkShaderCompileStatus(build.vertexShader, GL_VERTEX_SHADER);
+        checkShaderCompileStatus(build.fragmentShader, GL_FRAGMENT_SHADER);
         char infoLog[512];
-		glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
+		glGetProgramInfoLog(build.program, 512, nullptr, infoLog);
 		std::cout << "::Error: shader program compilation failed\n" << infoLog << std::endl;
 	}
 
-	glDetachShader(shaderProgram, vertexShader);
-	glDetachShader(shaderProgram, fragmentShader);
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	glDetachShader(build.program, build.vertexShader);
+	glDetachShader(build.program, build.fragmentShader);
+	glDeleteShader(build.vertexShader);
+	glDeleteShader(build.fragmentShader);
 
-	return shaderProgram;
+	return build.program;
 }
 
-const char* readShaderFromFile(const std::string &shaderPath)
+GLuint createShaderProgram(const ShaderSource& vertexShaderSource, const ShaderSource& fragmentShaderSource)                             // Creates shader program with given vertex shader source code and fragment shader source code.
 {
-	std::ifstream file(shaderPath);
-	if (!file) {
-        char infoLog[512];
-		std::cout << "::Error: shader file reading failed. " << strerror_s(infoLog, errno);               // TODO change all std::cout to log system?
-		return nullptr;
-	}
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-	file.close();
+	return finishShaderProgram(submitShaderProgram(vertexShaderSource, fragmentShaderSource));
+}
 
-	std::string stringBuffer = buffer.str();
-    int bufferLength = stringBuffer.length();
-	char* result = new char[bufferLength];
-	memcpy(result, stringBuffer.c_str(), bufferLength * sizeof(char) + 1);
-	return result;
+GLuint createComputeShaderProgram(const ShaderSource& computeShaderSource)
+{
+    GLuint computeShader = compileShader(GL_COMPUTE_SHADER, computeShaderSource);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, computeShader);
+    glLinkProgram(program);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        checkShaderCompileStatus(computeShader, GL_COMPUTE_SHADER);
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
+        std::cout << "::Error: compute shader program compilation failed\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        program = 0;
+    }
+    else
+        glDetachShader(program, computeShader);
+    glDeleteShader(computeShader);
+    return program;
 }
 
 ShaderProgram::ShaderProgram(const std::string &vertexShaderAbsolutePath, const std::string &fragmentShaderAbsolutePath)
 {
-    const char* vertexShaderSource = readShaderFromFile(vertexShaderAbsolutePath);
-    const char* fragmentShaderSource = readShaderFromFile(fragmentShaderAbsolutePath);
-
-    if (vertexShaderSource == nullptr || fragmentShaderSource == nullptr)
+    ShaderSource vertexShaderSource, fragmentShaderSource;
+    if (!preprocessShader(vertexShaderAbsolutePath, {}, vertexShaderSource) || !preprocessShader(fragmentShaderAbsolutePath, {}, fragmentShaderSource))
         ID = 0;
     else
-        ID = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+        ID = createCachedShaderProgram(vertexShaderSource, fragmentShaderSource);
+
+    if (ID != 0) {
+        introspectUniforms();
+        bindUniformBlocks(ID);
+    }
+}
+
+ShaderProgram::ShaderProgram(GLuint linkedProgram) : ID(linkedProgram)
+{
+    if (ID != 0) {
+        introspectUniforms();
+        bindUniformBlocks(ID);
+    }
 }
 
-void ShaderProgram::setBool(const std::string &name, bool value) const
+void ShaderProgram::introspectUniforms()                                                                                 // Reads every active uniform once after linking, so setters never ask GL for locations.
 {
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    size_t tableSize = 4;
+    while (tableSize < (size_t)uniformCount * 2)                                                                         // At most half full, probe sequences stay short.
+        tableSize *= 2;
+    uniforms.assign(tableSize, Uniform());
+
+    std::vector<char> nameBuffer(maxNameLength + 1);
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(ID, i, nameBuffer.size(), nullptr, &size, &type, nameBuffer.data());
+        GLint location = glGetUniformLocation(ID, nameBuffer.data());
+        if (location < 0)                                                                                                // Members of uniform blocks have no location.
+            continue;
 
+        std::string name = nameBuffer.data();
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)                                             // Arrays are reported as "name[0]", they are set through their base name.
+            name.resize(name.size() - 3);
+
+        UniformName uniformName(name.c_str());
+        size_t slot = uniformName.hash & (uniforms.size() - 1);
+        while (uniforms[slot].isUsed)
+            slot = (slot + 1) & (uniforms.size() - 1);
+        uniforms[slot] = { true, uniformName.hash, name, location, type, false, {} };
+    }
 }
 
-void ShaderProgram::setInt(const std::string &name, int value) const
+ShaderProgram::Uniform* ShaderProgram::findUniform(const UniformName& name)
 {
+    if (uniforms.empty())
+        return nullptr;
 
+    size_t mask = uniforms.size() - 1;
+    for (size_t slot = name.hash & mask; uniforms[slot].isUsed; slot = (slot + 1) & mask)
+        if (uniforms[slot].hash == name.hash && uniforms[slot].name == name.name)
+            return &uniforms[slot];
+    return nullptr;
 }
 
-void ShaderProgram::setFloat(const std::string &name, float value) const
+ShaderProgram::Uniform* ShaderProgram::findChangedUniform(const UniformName& name, const void* value, size_t valueSize)  // Returns the uniform when the new value has to be sent to GL, nullptr when it is unchanged or inactive.
 {
+    Uniform* uniform = findUniform(name);
+    if (uniform == nullptr || (uniform->hasValue && memcmp(uniform->value, value, valueSize) == 0))
+        return nullptr;
 
+    memcpy(uniform->value, value, valueSize);
+    uniform->hasValue = true;
+    use();                                                                                                               // glUniform* writes to the program in use.
+    return uniform;
 }
 
-void ShaderProgram::use()
+void ShaderProgram::replaceProgram(GLuint linkedProgram)
 {
+    if (ID != 0) {
+        getGlStateCache().onProgramDeleted(ID);
+        glDeleteProgram(ID);
+    }
+    ID = linkedProgram;
+    uniforms.clear();
+    introspectUniforms();
+    bindUniformBlocks(ID);
+}
+
+bool ShaderProgram::hasUniform(const UniformName& name)
+{
+    return findUniform(name) != nullptr;
+}
 
-}
\ No newline at end of file
+void ShaderProgram::setBool(const UniformName& name, bool value)
+{
+    setInt(name, value ? 1 : 0);
+}
+
+void ShaderProgram::setInt(const UniformName& name, int value)
+{
+    if (Uniform* uniform = findChangedUniform(name, &value, sizeof(value)))
+        glUniform1i(uniform->location, value);
+}
+
+void ShaderProgram::setFloat(const UniformName& name, float value)
+{
+    if (Uniform* uniform = findChangedUniform(name, &value, sizeof(value)))
+        glUniform1f(uniform->location, value);
+}
+
+void ShaderProgram::setVec2(const UniformName& name, float x, float y)
+{
+    const float value[2] = { x, y };
+    if (Uniform* uniform = findChangedUniform(name, value, sizeof(value)))
+        glUniform2fv(uniform->location, 1, value);
+}
+
+void ShaderProgram::setVec3(const UniformName& name, const Position& value)
+{
+    if (Uniform* uniform = findChangedUniform(name, &value, sizeof(value)))
+        glUniform3f(uniform->location, value.x, value.y, value.z);
+}
+
+void ShaderProgram::setVec4(const UniformName& name, const Color& value)
+{
+    if (Uniform* uniform = findChangedUniform(name, &value, sizeof(value)))
+        glUniform4f(uniform->location, value.r, value.g, value.b, value.a);
+}
+
+void ShaderProgram::setMat4(const UniformName& name, const Matrix4& value)
+{
+    if (Uniform* uniform = findChangedUniform(name, value.m, sizeof(value.m)))
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, value.m);                                      // Matrix4 is column-major already, no transpose.
+}
+
+void ShaderProgram::use()
+{
+    getGlStateCache().useProgram(ID);
+}
@@ -0,0 +1,160 @@
+#include "shader-watcher.hpp"
+#include "shader-cache.hpp"
+#include "filesystem-utils.hpp"
+#include <filesystem>
+#include <iostream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+std::string getFileName(const std::string& path)
+{
+    return std::filesystem::path(path).filename().string();
+}
+
+long long getModificationTime(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : (long long)time.time_since_epoch().count();
+}
+
+ShaderWatcher::ShaderWatcher()
+{
+    shadersDirectory = getAbsolutePath(PathNodeType::shadersDirectory);
+#ifdef __linux__
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyDescriptor >= 0 && inotify_add_watch(inotifyDescriptor, shadersDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {   // IN_MOVED_TO catches editors that save into a temporary file and rename it.
+        close(inotifyDescriptor);
+        inotifyDescriptor = -1;
+    }
+    if (inotifyDescriptor < 0)
+        std::cout << "::Error: inotify is unavailable for " << shadersDirectory << ", polling shader files instead" << std::endl;
+#endif
+    lastPollTime = std::chrono::steady_clock::now();
+}
+
+bool ShaderWatcher::preprocess(WatchedProgram& watchedProgram, ShaderSource& vertexShaderSource, ShaderSource& fragmentShaderSource)    // Also refreshes the dependencies, an edit may have added or removed an #include.
+{
+    std::vector<std::string> vertexDependencies, fragmentDependencies;
+    bool isVertexShaderRead = preprocessShader(watchedProgram.vertexShaderPath, watchedProgram.defines, vertexShaderSource, &vertexDependencies);
+    bool isFragmentShaderRead = preprocessShader(watchedProgram.fragmentShaderPath, watchedProgram.defines, fragmentShaderSource, &fragmentDependencies);
+
+    watchedProgram.dependencies = { watchedProgram.vertexShaderPath, watchedProgram.fragmentShaderPath };                 // Even when reading failed, so fixing the file triggers a rebuild.
+    watchedProgram.dependencies.insert(watchedProgram.dependencies.end(), vertexDependencies.begin(), vertexDependencies.end());
+    watchedProgram.dependencies.insert(watchedProgram.dependencies.end(), fragmentDependencies.begin(), fragmentDependencies.end());
+    watchedProgram.modificationTimes.clear();
+    for (const std::string& dependency : watchedProgram.dependencies)
+        watchedProgram.modificationTimes.push_back(getModificationTime(dependency));
+    return isVertexShaderRead && isFragmentShaderRead;
+}
+
+void ShaderWatcher::watch(ShaderProgram* program, const std::string& vertexShaderAbsolutePath, const std::string& fragmentShaderAbsolutePath,
+                          const ShaderDefines& defines)
+{
+    WatchedProgram watchedProgram = { program, vertexShaderAbsolutePath, fragmentShaderAbsolutePath, defines, {}, false, false, {}, 0, {} };
+    ShaderSource vertexShaderSource, fragmentShaderSource;
+    preprocess(watchedProgram, vertexShaderSource, fragmentShaderSource);
+    programs.push_back(watchedProgram);
+}
+
+bool ShaderWatcher::dependsOn(const WatchedProgram& watchedProgram, const std::string& fileName)
+{
+    for (const std::string& dependency : watchedProgram.dependencies)
+        if (getFileName(dependency) == fileName)
+            return true;
+    return false;
+}
+
+void ShaderWatcher::readChanges()
+{
+#ifdef __linux__
+    if (inotifyDescriptor >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0) {                                         // Non-blocking, fails with EAGAIN once the queue is empty.
+            for (char* eventData = buffer; eventData < buffer + length; ) {
+                const inotify_event* event = (const inotify_event*)eventData;
+                if (event->len > 0)
+                    for (WatchedProgram& watchedProgram : programs)
+                        if (dependsOn(watchedProgram, event->name))
+                            watchedProgram.isChanged = true;
+                eventData += sizeof(inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - lastPollTime < shaderWatchPollInterval)
+        return;
+    lastPollTime = now;
+
+    for (WatchedProgram& watchedProgram : programs)
+        for (size_t i = 0; i < watchedProgram.dependencies.size(); i++)
+            if (getModificationTime(watchedProgram.dependencies[i]) != watchedProgram.modificationTimes[i])
+                watchedProgram.isChanged = true;
+}
+
+void ShaderWatcher::submitBuild(WatchedProgram& watchedProgram)
+{
+    watchedProgram.isChanged = false;
+    ShaderSource vertexShaderSource, fragmentShaderSource;
+    if (!preprocess(watchedProgram, vertexShaderSource, fragmentShaderSource))
+        return;
+
+    watchedProgram.cacheKey = getShaderCacheKey(vertexShaderSource, fragmentShaderSource);
+    GLuint cachedProgram = loadProgramBinary(watchedProgram.cacheKey);                                                   // Reverting an edit usually hits the cache.
+    if (cachedProgram != 0) {
+        watchedProgram.program->replaceProgram(cachedProgram);
+        reloadCount++;
+        return;
+    }
+    watchedProgram.build = submitShaderProgram(vertexShaderSource, fragmentShaderSource);
+    watchedProgram.isBuilding = true;
+}
+
+void ShaderWatcher::finishBuild(WatchedProgram& watchedProgram)
+{
+    GLuint program = finishShaderProgram(watchedProgram.build);
+    watchedProgram.isBuilding = false;
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    if (!success || watchedProgram.isChanged) {                                                                          // A newer edit arrived while building, that one is built next.
+        if (!success)
+            std::cout << "::Error: reloading " << getFileName(watchedProgram.vertexShaderPath) << " + "
+                      << getFileName(watchedProgram.fragmentShaderPath) << " failed, the previous program stays in use" << std::endl;
+        glDeleteProgram(program);
+        return;
+    }
+    saveProgramBinary(program, watchedProgram.cacheKey);
+    watchedProgram.program->replaceProgram(program);
+    reloadCount++;
+    std::cout << "Reloaded " << getFileName(watchedProgram.vertexShaderPath) << " + " << getFileName(watchedProgram.fragmentShaderPath) << std::endl;
+}
+
+void ShaderWatcher::update()
+{
+    readChanges();
+    for (WatchedProgram& watchedProgram : programs) {
+        if (watchedProgram.isBuilding && isShaderProgramBuildComplete(watchedProgram.build))
+            finishBuild(watchedProgram);
+        if (watchedProgram.isChanged && !watchedProgram.isBuilding)
+            submitBuild(watchedProgram);
+    }
+}
+
+void ShaderWatcher::deleteShaderWatcher()
+{
+    for (WatchedProgram& watchedProgram : programs)
+        if (watchedProgram.isBuilding)
+            glDeleteProgram(finishShaderProgram(watchedProgram.build));
+    programs.clear();
+#ifdef __linux__
+    if (inotifyDescriptor >= 0)
+        close(inotifyDescriptor);
+    inotifyDescriptor = -1;
+#endif
+}
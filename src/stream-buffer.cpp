@@ -0,0 +1,108 @@
+#include "stream-buffer.hpp"
+#include "gl-state-cache.hpp"
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr regionSize) : target(target), regionSize(regionSize)
+{
+    isPersistent = GLAD_GL_ARB_buffer_storage != 0;
+    glGenBuffers(1, &ID);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);                                                                              // GL_COPY_WRITE_BUFFER is bound instead of target so that e.g. the element buffer of the current VAO is left alone.
+
+    if (isPersistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;                         // Coherent mapping: CPU writes become visible to the GPU without explicit flushes.
+        glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * streamBufferRegionCount, nullptr, flags);             // Immutable storage, required for a mapping that stays valid while the GPU uses the buffer.
+        mappedData = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * streamBufferRegionCount, flags);
+        if (mappedData == nullptr) {
+            std::cout << "::Error: persistent mapping of a stream buffer failed, falling back to glBufferSubData" << std::endl;
+            isPersistent = false;
+            getGlStateCache().onBufferDeleted(ID);
+            glDeleteBuffers(1, &ID);
+            glGenBuffers(1, &ID);
+            getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        }
+    }
+
+    if (!isPersistent) {
+        glBufferData(GL_COPY_WRITE_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+        stagingData.resize(regionSize);
+    }
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamAllocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)                                           // Reserves size bytes of the current frame's region. Alignment does not have to be a power of two (e.g. sizeof(Vertex) for base vertices).
+{
+    GLsizeiptr regionStart = isPersistent ? regionIndex * regionSize : 0;
+    GLsizeiptr offset = (regionStart + regionUsedSize + alignment - 1) / alignment * alignment - regionStart;           // The offset in the whole buffer is what has to be aligned.
+    if (offset + size > regionSize) {
+        std::cout << "::Error: stream buffer region of " << regionSize << " bytes is too small for " << size << " more bytes" << std::endl;
+        return { nullptr, 0, 0 };
+    }
+    regionUsedSize = offset + size;
+
+    if (isPersistent)
+        return { mappedData + regionStart + offset, regionStart + offset, size };
+    return { stagingData.data() + offset, offset, size };
+}
+
+void StreamBuffer::flush()                                                                                               // Makes the data written since the last flush visible to the GPU. Has to be called before drawing from it, a no-op for persistent buffers.
+{
+    if (isPersistent || regionUsedSize == regionFlushedSize)
+        return;
+
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, regionFlushedSize, regionUsedSize - regionFlushedSize, stagingData.data() + regionFlushedSize);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    regionFlushedSize = regionUsedSize;
+}
+
+void StreamBuffer::waitForRegion(int region)
+{
+    GLsync fence = regionFences[region];
+    if (fence == nullptr)
+        return;
+
+    GLenum waitResult = glClientWaitSync(fence, 0, 0);
+    if (waitResult == GL_TIMEOUT_EXPIRED) {                                                                              // The GPU is more than streamBufferRegionCount - 1 frames behind, the CPU has to wait.
+        stallCount++;
+        do
+            waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        while (waitResult == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    regionFences[region] = nullptr;
+}
+
+void StreamBuffer::endFrame()                                                                                            // Retires the current region after the frame's draw calls were issued and switches to the next one.
+{
+    if (isPersistent) {
+        regionFences[regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);                         // Signaled once the GPU has executed every command that reads this region.
+        regionIndex = (regionIndex + 1) % streamBufferRegionCount;
+        waitForRegion(regionIndex);
+    }
+    else {
+        flush();
+        getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferData(GL_COPY_WRITE_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);                          // Orphaning: the driver hands out fresh storage while pending draws keep reading the old one.
+        getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    regionUsedSize = 0;
+    regionFlushedSize = 0;
+}
+
+void StreamBuffer::deleteStreamBuffer()
+{
+    for (GLsync& fence : regionFences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (mappedData != nullptr) {
+        getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mappedData = nullptr;
+    }
+    getGlStateCache().onBufferDeleted(ID);
+    glDeleteBuffers(1, &ID);
+    ID = 0;
+}
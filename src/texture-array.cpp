@@ -0,0 +1,164 @@
+#include "texture-array.hpp"
+#include "compressed-texture.hpp"
+#include "gl-state-cache.hpp"
+#include "ktx2-file.hpp"
+#include "mapped-file.hpp"
+#include <algorithm>
+#include <iostream>
+
+const GLuint textureArrayUploadUnit = 0;                                                                                 // Unit the glTex* calls go through, any unit works.
+
+int getMaxTextureArrayLayers()
+{
+    static const int maxLayers = []() {
+        GLint result = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &result);
+        return (int)result;
+    }();
+    return maxLayers;
+}
+
+int clampLayerCapacity(int layerCapacity)                                                                                // GL 3.3 only guarantees 256 layers.
+{
+    int maxLayers = getMaxTextureArrayLayers();
+    if (layerCapacity <= maxLayers)
+        return layerCapacity;
+    std::cout << "::Error: texture array of " << layerCapacity << " layers exceeds GL_MAX_ARRAY_TEXTURE_LAYERS (" << maxLayers << "), clamped" << std::endl;
+    return maxLayers;
+}
+
+bool isBindlessTextureSupported()
+{
+    return GLAD_GL_ARB_bindless_texture;
+}
+
+TextureArray::TextureArray(int width, int height, BlockFormat format, int requestedLayerCapacity)
+    : width(width), height(height), levelCount(getMipLevelCount(width, height)), layerCapacity(clampLayerCapacity(requestedLayerCapacity)), format(format),
+      storageFormat(isBlockFormatSupported(format) ? format : blockFormatRGBA8)
+{
+    GLenum internalFormat = getGlInternalFormat(storageFormat);
+    glGenTextures(1, &ID);
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    getGlStateCache().selectTexture(textureArrayUploadUnit, GL_TEXTURE_2D_ARRAY, ID);
+    if (GLAD_GL_ARB_texture_storage)
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, internalFormat, width, height, layerCapacity);
+    else {
+        for (int level = 0; level < levelCount; level++) {
+            int levelWidth = std::max(width >> level, 1), levelHeight = std::max(height >> level, 1);
+            if (storageFormat != blockFormatRGBA8)
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, levelWidth, levelHeight, layerCapacity, 0,
+                                       getCompressedSize(storageFormat, levelWidth, levelHeight) * layerCapacity, nullptr);
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight, layerCapacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    if (isBindlessTextureSupported()) {                                                                                  // Last, a texture's parameters are frozen once it has a handle. Its contents are not.
+        bindlessHandle = glGetTextureHandleARB(ID);
+        glMakeTextureHandleResidentARB(bindlessHandle);
+    }
+}
+
+bool TextureArray::canAddLayer(int layerWidth, int layerHeight, int layerLevelCount) const
+{
+    if (layerCount == layerCapacity) {
+        std::cout << "::Error: texture array of " << layerCapacity << " layers is full" << std::endl;
+        return false;
+    }
+    if (layerWidth != width || layerHeight != height || layerLevelCount != levelCount) {
+        std::cout << "::Error: a " << layerWidth << "x" << layerHeight << " texture with " << layerLevelCount << " levels does not fit a texture array of "
+                  << width << "x" << height << " with " << levelCount << " levels" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TextureArray::uploadLevel(int layer, int level, int levelWidth, int levelHeight, const unsigned char* data, size_t size)
+{
+    ImageLevel decoded;
+    if (storageFormat != format) {
+        if (!decompressImage(format, data, size, levelWidth, levelHeight, decoded))
+            return false;
+        data = decoded.pixels.data();
+    }
+    else if (size < getCompressedSize(format, levelWidth, levelHeight)) {
+        std::cout << "::Error: level " << level << " of a texture array layer is too short" << std::endl;
+        return false;
+    }
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);                                                             // data is client memory.
+    getGlStateCache().selectTexture(textureArrayUploadUnit, GL_TEXTURE_2D_ARRAY, ID);
+    if (storageFormat != blockFormatRGBA8)
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, getGlInternalFormat(storageFormat),
+                                  getCompressedSize(storageFormat, levelWidth, levelHeight), data);
+    else
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    return true;
+}
+
+int TextureArray::addLayer(const std::vector<ImageLevel>& levels)
+{
+    if (levels.empty() || !canAddLayer(levels[0].width, levels[0].height, levels.size()))
+        return -1;
+    for (int level = 0; level < levelCount; level++)
+        if (!uploadLevel(layerCount, level, levels[level].width, levels[level].height, levels[level].pixels.data(), levels[level].pixels.size()))
+            return -1;
+    return layerCount++;
+}
+
+int TextureArray::loadLayer(const std::string& absolutePath)
+{
+    if (isKtx2Path(absolutePath)) {
+        MappedFile file;
+        Ktx2Image image;
+        if (!file.open(absolutePath) || !readKtx2(file.getData(), file.getSize(), image)) {
+            std::cout << "::Error: failed to load texture " << absolutePath << std::endl;
+            return -1;
+        }
+        if (image.format != format) {
+            std::cout << "::Error: " << absolutePath << " is " << getBlockFormatInfo(image.format).name << ", the texture array holds "
+                      << getBlockFormatInfo(format).name << std::endl;
+            return -1;
+        }
+        if (!canAddLayer(image.levels[0].width, image.levels[0].height, image.levels.size()))
+            return -1;
+        for (int level = 0; level < levelCount; level++) {
+            const Ktx2Level& levelData = image.levels[level];
+            if (!uploadLevel(layerCount, level, levelData.width, levelData.height, levelData.data, levelData.size))
+                return -1;
+        }
+        return layerCount++;
+    }
+
+    ImageLevel image;
+    if (!decodeImageFile(absolutePath, image))
+        return -1;
+    if (!canAddLayer(image.width, image.height, getMipLevelCount(image.width, image.height)))                           // Before the slow part.
+        return -1;
+    std::vector<ImageLevel> levels = generateMipChain(std::move(image));
+    for (ImageLevel& level : levels)
+        level.pixels = compressImage(level, format);
+    return addLayer(levels);
+}
+
+TextureReference TextureArray::getReference(int layer) const
+{
+    return getTextureReference(bindlessHandle, layer);
+}
+
+void TextureArray::bind(GLuint textureUnit)
+{
+    getGlStateCache().bindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, ID);
+}
+
+void TextureArray::deleteTextureArray()
+{
+    if (bindlessHandle != 0)
+        glMakeTextureHandleNonResidentARB(bindlessHandle);
+    getGlStateCache().onTextureDeleted(ID);
+    glDeleteTextures(1, &ID);
+}
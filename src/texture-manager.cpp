@@ -0,0 +1,455 @@
+#include "texture-manager.hpp"
+#include "compressed-texture.hpp"
+#include "gl-state-cache.hpp"
+#include "ktx2-file.hpp"
+#include "mapped-file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+const GLuint textureUploadUnit = 0;                                                                                      // Unit the glTex* calls go through, any unit works.
+const GLsizeiptr minUploadBytesPerFrame = 64 << 10;                                                                      // Fits the whole tail of a texture.
+
+TextureManager::TextureManager(int workerCount, GLsizeiptr memoryBudget, GLsizeiptr uploadBytesPerFrame)
+    : uploadBuffer(GL_PIXEL_UNPACK_BUFFER, std::max(uploadBytesPerFrame, minUploadBytesPerFrame)), memoryBudget(memoryBudget)
+{
+    const unsigned char white[] = { 255, 255, 255, 255 };
+    glGenTextures(1, &placeholderTexture);
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    getGlStateCache().selectTexture(textureUploadUnit, GL_TEXTURE_2D, placeholderTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    for (int i = 0; i < std::max(workerCount, 1); i++)
+        workers.emplace_back(&TextureManager::runWorker, this);
+}
+
+void lowerWorkerPriority()                                                                                               // Decoding only gets the time the render thread leaves, on few cores it would otherwise preempt frames.
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, gettid(), 10);                                                                             // Linux threads have their own nice value.
+#endif
+}
+
+bool readKtx2Levels(const std::string& absolutePath, BlockFormat& format, std::vector<ImageLevel>& levels)
+{
+    MappedFile file;
+    Ktx2Image image;
+    if (!file.open(absolutePath) || !readKtx2(file.getData(), file.getSize(), image)) {
+        std::cout << "::Error: failed to load texture " << absolutePath << std::endl;
+        return false;
+    }
+    if ((int)image.levels.size() != getMipLevelCount(image.levels[0].width, image.levels[0].height)) {
+        std::cout << "::Error: " << absolutePath << " has no full mip chain, it cannot be streamed" << std::endl;
+        return false;
+    }
+    bool isKept = image.format == blockFormatRGBA8 || (isBlockFormatSupported(image.format) && GLAD_GL_ARB_copy_image);
+    format = isKept ? image.format : blockFormatRGBA8;
+    levels.resize(image.levels.size());
+    for (int level = 0; level < (int)image.levels.size(); level++) {
+        const Ktx2Level& levelData = image.levels[level];
+        levels[level].width = levelData.width;
+        levels[level].height = levelData.height;
+        if (isKept)
+            levels[level].pixels.assign(levelData.data, levelData.data + levelData.size);
+        else if (!decompressImage(image.format, levelData.data, levelData.size, levelData.width, levelData.height, levels[level]))
+            return false;
+    }
+    return true;
+}
+
+void TextureManager::runWorker()
+{
+    lowerWorkerPriority();
+    while (true) {
+        DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return isStopping || !decodeJobs.empty(); });
+            if (isStopping)
+                return;
+            job = std::move(decodeJobs.front());
+            decodeJobs.pop_front();
+        }
+
+        DecodeResult result;
+        result.handle = job.handle;
+        result.format = blockFormatRGBA8;
+        if (isKtx2Path(job.path))
+            result.isDecoded = readKtx2Levels(job.path, result.format, result.levels);
+        else {
+            ImageLevel image;
+            result.isDecoded = decodeImageFile(job.path, image);
+            if (result.isDecoded)
+                result.levels = generateMipChain(std::move(image));
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        decodeResults.push_back(std::move(result));
+    }
+}
+
+void TextureManager::submitDecode(TextureHandle handle)
+{
+    textures[handle].isDecoding = true;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        decodeJobs.push_back({ handle, textures[handle].path });
+    }
+    queueCondition.notify_one();
+}
+
+TextureHandle TextureManager::load(const std::string& absolutePath)
+{
+    Texture texture;
+    texture.path = absolutePath;
+    textures.push_back(std::move(texture));
+    TextureHandle handle = textures.size() - 1;
+    submitDecode(handle);
+    return handle;
+}
+
+void TextureManager::onDecoded(DecodeResult& result)
+{
+    Texture& texture = textures[result.handle];
+    texture.isDecoding = false;
+    if (!result.isDecoded) {
+        if (texture.levelCount == 0)                                                                                     // A failed decode after eviction keeps the resident levels.
+            texture.state = textureLoadFailed;
+        return;
+    }
+
+    if (texture.levelCount == 0) {
+        texture.format = result.format;
+        texture.levelCount = result.levels.size();
+        texture.residentLevel = texture.levelCount;
+        texture.tailLevel = texture.levelCount - 1;
+        while (texture.tailLevel > 0 && std::max(result.levels[texture.tailLevel - 1].width, result.levels[texture.tailLevel - 1].height) <= textureTailSize)
+            texture.tailLevel--;
+        stats.decodedCount++;
+    }
+    else if ((int)result.levels.size() != texture.levelCount || result.format != texture.format) {
+        std::cout << "::Error: " << texture.path << " changed its size since it was first loaded, it is not streamed further" << std::endl;
+        return;
+    }
+    int firstMissingLevel = texture.residentLevel < texture.levelCount ? texture.residentLevel : texture.levelCount;
+    for (int level = firstMissingLevel; level < texture.levelCount; level++)                                            // Already resident, only the dimensions are kept.
+        std::vector<unsigned char>().swap(result.levels[level].pixels);
+    texture.levels = std::move(result.levels);
+}
+
+GLsizeiptr TextureManager::getLevelSize(const Texture& texture, int level) const
+{
+    return getCompressedSize(texture.format, texture.levels[level].width, texture.levels[level].height);
+}
+
+GLsizeiptr TextureManager::getStorageSize(const Texture& texture) const
+{
+    GLsizeiptr size = 0;
+    if (texture.ID != 0)
+        for (int level = texture.storageLevel; level < texture.levelCount; level++)
+            size += getLevelSize(texture, level);
+    return size;
+}
+
+bool TextureManager::isLevelDecoded(const Texture& texture, int level) const
+{
+    return !texture.levels[level].pixels.empty();
+}
+
+bool TextureManager::isStreaming(const Texture& texture) const
+{
+    return texture.state != textureLoadFailed && texture.levelCount > 0 && texture.residentLevel > 0;
+}
+
+void TextureManager::copyLevel(GLuint source, int sourceLevel, GLuint target, int targetLevel, int width, int height)
+{
+    if (GLAD_GL_ARB_copy_image) {
+        glCopyImageSubData(source, GL_TEXTURE_2D, sourceLevel, 0, 0, 0, target, GL_TEXTURE_2D, targetLevel, 0, 0, 0, width, height, 1);
+        return;
+    }
+    if (copyFramebuffers[0] == 0)
+        glGenFramebuffers(2, copyFramebuffers);
+    GLint previousFramebuffers[2];
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffers[0]);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffers[1]);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFramebuffers[0]);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, sourceLevel);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, copyFramebuffers[1]);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, targetLevel);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffers[0]);                                                     // Both as they were, the state cache stays right.
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffers[1]);
+}
+
+GLuint TextureManager::createStorage(const Texture& texture, int firstLevel)
+{
+    GLuint ID;
+    int glLevelCount = texture.levelCount - firstLevel;
+    GLenum internalFormat = getGlInternalFormat(texture.format);
+    glGenTextures(1, &ID);
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    getGlStateCache().selectTexture(textureUploadUnit, GL_TEXTURE_2D, ID);
+    if (GLAD_GL_ARB_texture_storage)                                                                                    // Immutable, every level is allocated at once and never revalidated.
+        glTexStorage2D(GL_TEXTURE_2D, glLevelCount, internalFormat, texture.levels[firstLevel].width, texture.levels[firstLevel].height);
+    else {
+        for (int level = firstLevel; level < texture.levelCount; level++) {
+            const ImageLevel& image = texture.levels[level];
+            if (texture.format != blockFormatRGBA8)
+                glCompressedTexImage2D(GL_TEXTURE_2D, level - firstLevel, internalFormat, image.width, image.height, 0, getLevelSize(texture, level), nullptr);
+            else
+                glTexImage2D(GL_TEXTURE_2D, level - firstLevel, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, glLevelCount - 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return ID;
+}
+
+void TextureManager::replaceStorage(Texture& texture, GLuint newID, int newStorageLevel)
+{
+    for (int level = std::max(texture.residentLevel, newStorageLevel); level < texture.levelCount; level++)
+        copyLevel(texture.ID, level - texture.storageLevel, newID, level - newStorageLevel, texture.levels[level].width, texture.levels[level].height);
+    residentBytes -= getStorageSize(texture);
+    getGlStateCache().onTextureDeleted(texture.ID);
+    glDeleteTextures(1, &texture.ID);
+    texture.ID = newID;
+    texture.storageLevel = newStorageLevel;
+    residentBytes += getStorageSize(texture);
+}
+
+void TextureManager::uploadTail(Texture& texture, GLsizeiptr& frameBytes)
+{
+    GLsizeiptr tailSize = 0;
+    for (int level = texture.tailLevel; level < texture.levelCount; level++)
+        tailSize += getLevelSize(texture, level);
+    if (tailSize > frameBytes)
+        return;
+
+    std::vector<GLintptr> offsets;
+    for (int level = texture.tailLevel; level < texture.levelCount; level++) {
+        StreamAllocation allocation = uploadBuffer.allocate(getLevelSize(texture, level));
+        memcpy(allocation.data, texture.levels[level].pixels.data(), allocation.size);
+        offsets.push_back(allocation.offset);
+    }
+    uploadBuffer.flush();
+    texture.ID = createStorage(texture, texture.tailLevel);
+    texture.storageLevel = texture.tailLevel;
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer.ID);
+    for (int level = texture.tailLevel; level < texture.levelCount; level++) {
+        ImageLevel& image = texture.levels[level];
+        void* offset = (void*)offsets[level - texture.tailLevel];
+        if (texture.format != blockFormatRGBA8)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level - texture.tailLevel, 0, 0, image.width, image.height, getGlInternalFormat(texture.format),
+                                      getLevelSize(texture, level), offset);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, level - texture.tailLevel, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+        std::vector<unsigned char>().swap(image.pixels);
+    }
+
+    texture.residentLevel = texture.tailLevel;
+    texture.state = textureLoadReady;
+    residentBytes += tailSize;
+    frameBytes -= tailSize;
+    stats.uploadedLevelCount += texture.levelCount - texture.tailLevel;
+    stats.uploadedBytes += tailSize;
+}
+
+bool TextureManager::uploadRows(Texture& texture, GLsizeiptr& frameBytes)
+{
+    int level = texture.residentLevel - 1;
+    ImageLevel& image = texture.levels[level];
+    int blockSize = getBlockFormatInfo(texture.format).blockSize;
+    int levelRowCount = (image.height + blockSize - 1) / blockSize;
+    GLsizeiptr rowSize = getCompressedSize(texture.format, image.width, blockSize);
+    if (texture.streamingID == 0) {
+        if (!makeRoom(getLevelSize(texture, level), texture.lastUsedFrame)) {                                            // The old texture it replaces is not counted, it is deleted when the level is complete.
+            for (int pendingLevel = 0; pendingLevel <= level; pendingLevel++)                                          // Decoded again once there is room, instead of holding the pixels meanwhile.
+                std::vector<unsigned char>().swap(texture.levels[pendingLevel].pixels);
+            return false;
+        }
+        texture.streamingID = createStorage(texture, level);
+        texture.uploadedRowCount = 0;
+        residentBytes += getLevelSize(texture, level);
+    }
+
+    int rowCount = (int)std::min((GLsizeiptr)(levelRowCount - texture.uploadedRowCount), frameBytes / rowSize);
+    if (rowCount == 0)
+        return true;
+    StreamAllocation allocation = uploadBuffer.allocate(rowCount * rowSize);
+    memcpy(allocation.data, image.pixels.data() + texture.uploadedRowCount * rowSize, allocation.size);
+    uploadBuffer.flush();
+    getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer.ID);
+    getGlStateCache().selectTexture(textureUploadUnit, GL_TEXTURE_2D, texture.streamingID);
+    int y = texture.uploadedRowCount * blockSize, height = std::min(rowCount * blockSize, image.height - y);
+    if (texture.format != blockFormatRGBA8)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width, height, getGlInternalFormat(texture.format), allocation.size, (void*)allocation.offset);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)allocation.offset);
+    texture.uploadedRowCount += rowCount;
+    frameBytes -= allocation.size;
+    stats.uploadedBytes += allocation.size;
+
+    if (texture.uploadedRowCount < levelRowCount)
+        return true;
+    residentBytes -= getLevelSize(texture, level);
+    replaceStorage(texture, texture.streamingID, level);
+    texture.streamingID = 0;
+    texture.residentLevel = level;
+    std::vector<unsigned char>().swap(image.pixels);
+    stats.uploadedLevelCount++;
+    return false;
+}
+
+GLsizeiptr TextureManager::getEvictableSize(uint64_t usedBeforeFrame) const
+{
+    GLsizeiptr size = 0;
+    for (const Texture& texture : textures)
+        if (texture.ID != 0 && texture.lastUsedFrame < usedBeforeFrame)
+            for (int level = texture.streamingID != 0 ? texture.residentLevel - 1 : texture.storageLevel; level < texture.tailLevel; level++)
+                size += getLevelSize(texture, level);
+    return size;
+}
+
+bool TextureManager::makeRoom(GLsizeiptr size, uint64_t usedBeforeFrame)
+{
+    while (residentBytes + size > memoryBudget) {
+        Texture* leastRecentlyUsed = nullptr;
+        for (Texture& texture : textures)
+            if (texture.ID != 0 && (texture.streamingID != 0 || texture.storageLevel < texture.tailLevel) && texture.lastUsedFrame < usedBeforeFrame
+                && (leastRecentlyUsed == nullptr || texture.lastUsedFrame < leastRecentlyUsed->lastUsedFrame))
+                leastRecentlyUsed = &texture;
+        if (leastRecentlyUsed == nullptr)
+            return false;
+        evictLevel(*leastRecentlyUsed);
+    }
+    return true;
+}
+
+void TextureManager::evictLevel(Texture& texture)
+{
+    if (texture.streamingID != 0) {                                                                                      // The level still streaming in goes first, it is not drawn yet.
+        getGlStateCache().onTextureDeleted(texture.streamingID);
+        glDeleteTextures(1, &texture.streamingID);
+        texture.streamingID = 0;
+        residentBytes -= getLevelSize(texture, texture.residentLevel - 1);
+    }
+    else {
+        texture.residentLevel++;
+        replaceStorage(texture, createStorage(texture, texture.residentLevel), texture.residentLevel);
+    }
+    for (int level = 0; level < texture.residentLevel; level++)
+        std::vector<unsigned char>().swap(texture.levels[level].pixels);
+    stats.evictedLevelCount++;
+}
+
+void TextureManager::update()
+{
+    std::vector<DecodeResult> results;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        results.swap(decodeResults);
+    }
+    for (DecodeResult& result : results)
+        onDecoded(result);
+    makeRoom(0, UINT64_MAX);                                                                                             // Only evicts after the budget was lowered.
+
+    std::vector<TextureHandle> streamingTextures;
+    for (int handle = 0; handle < (int)textures.size(); handle++)
+        if (isStreaming(textures[handle]))
+            streamingTextures.push_back(handle);
+    std::stable_sort(streamingTextures.begin(), streamingTextures.end(), [this](TextureHandle left, TextureHandle right) {
+        const Texture& leftTexture = textures[left];
+        const Texture& rightTexture = textures[right];
+        bool isLeftEmpty = leftTexture.residentLevel == leftTexture.levelCount, isRightEmpty = rightTexture.residentLevel == rightTexture.levelCount;
+        if (isLeftEmpty != isRightEmpty)                                                                                 // Textures without any level get their tail first.
+            return isLeftEmpty;
+        return leftTexture.lastUsedFrame > rightTexture.lastUsedFrame;
+    });
+
+    GLsizeiptr frameBytes = uploadBuffer.getRegionSize();
+    for (TextureHandle handle : streamingTextures) {
+        Texture& texture = textures[handle];
+        if (texture.residentLevel == texture.levelCount) {
+            uploadTail(texture, frameBytes);
+            continue;
+        }
+        bool isFrameFull = false;
+        while (!isFrameFull && isStreaming(texture) && isLevelDecoded(texture, texture.residentLevel - 1))
+            isFrameFull = uploadRows(texture, frameBytes);
+        if (isFrameFull)
+            break;
+        if (isStreaming(texture) && !texture.isDecoding && !isLevelDecoded(texture, texture.residentLevel - 1)
+            && residentBytes + getLevelSize(texture, texture.residentLevel - 1) <= memoryBudget + getEvictableSize(texture.lastUsedFrame))
+            submitDecode(handle);
+    }
+
+    if (frameBytes < uploadBuffer.getRegionSize()) {
+        getGlStateCache().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);                                                         // Later glTexImage2D calls with client memory would read from the buffer otherwise.
+        uploadBuffer.endFrame();
+    }
+    frameIndex++;
+}
+
+void TextureManager::bind(TextureHandle handle, GLuint textureUnit)
+{
+    Texture& texture = textures[handle];
+    texture.lastUsedFrame = frameIndex;
+    getGlStateCache().bindTexture(textureUnit, GL_TEXTURE_2D, texture.ID != 0 ? texture.ID : placeholderTexture);
+}
+
+bool TextureManager::isIdle()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!decodeJobs.empty() || !decodeResults.empty())
+            return false;
+    }
+    for (const Texture& texture : textures)
+        if (texture.isDecoding || (isStreaming(texture) && isLevelDecoded(texture, texture.residentLevel - 1)))
+            return false;
+    return true;
+}
+
+void TextureManager::setMemoryBudget(GLsizeiptr newMemoryBudget)
+{
+    memoryBudget = newMemoryBudget;
+}
+
+void TextureManager::deleteTextureManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        isStopping = true;
+    }
+    queueCondition.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    for (Texture& texture : textures) {
+        for (GLuint ID : { texture.ID, texture.streamingID })
+            if (ID != 0) {
+                getGlStateCache().onTextureDeleted(ID);
+                glDeleteTextures(1, &ID);
+            }
+    }
+    textures.clear();
+    getGlStateCache().onTextureDeleted(placeholderTexture);
+    glDeleteTextures(1, &placeholderTexture);
+    if (copyFramebuffers[0] != 0)
+        glDeleteFramebuffers(2, copyFramebuffers);
+    uploadBuffer.deleteStreamBuffer();
+}
@@ -0,0 +1,133 @@
+#include "uniform-buffer.hpp"
+#include "gl-state-cache.hpp"
+#include <cstring>
+#include <iostream>
+
+const char* uniformBlockNames[uniformBlockBindingCount] = { "FrameUniforms", "MaterialUniforms" };
+
+FrameUniforms getFrameUniforms(const Matrix4& view, const Matrix4& projection, int width, int height, GLfloat time, GLfloat deltaTime)
+{
+    FrameUniforms frameUniforms = {};
+    frameUniforms.view = view;
+    frameUniforms.projection = projection;
+    frameUniforms.viewProjection = projection * view;
+    frameUniforms.viewport[2] = (GLfloat)width;
+    frameUniforms.viewport[3] = (GLfloat)height;
+    frameUniforms.time = time;
+    frameUniforms.deltaTime = deltaTime;
+    return frameUniforms;
+}
+
+const char* getUniformBlockName(UniformBlockBinding binding)
+{
+    return uniformBlockNames[binding];
+}
+
+void bindUniformBlocks(GLuint shaderProgram)
+{
+    for (int binding = 0; binding < uniformBlockBindingCount; binding++) {
+        GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, uniformBlockNames[binding]);
+        if (blockIndex != GL_INVALID_INDEX)                                                                              // Programs only declare the blocks they use.
+            glUniformBlockBinding(shaderProgram, blockIndex, binding);
+    }
+}
+
+bool validateUniformBlock(GLuint shaderProgram, UniformBlockBinding binding, GLsizeiptr expectedSize)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, uniformBlockNames[binding]);
+    if (blockIndex == GL_INVALID_INDEX)
+        return true;
+
+    GLint blockSize = 0;
+    glGetActiveUniformBlockiv(shaderProgram, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+    if (blockSize != expectedSize) {
+        std::cout << "::Error: uniform block " << uniformBlockNames[binding] << " is " << blockSize << " bytes in GLSL but "
+                  << expectedSize << " bytes in C++" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+GLsizeiptr getUniformBufferAlignment()
+{
+    static GLint alignment = 0;
+    if (alignment == 0)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment;
+}
+
+GLsizeiptr alignUniformSize(GLsizeiptr size)
+{
+    GLsizeiptr alignment = getUniformBufferAlignment();
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+FrameUniformBuffer::FrameUniformBuffer() : streamBuffer(GL_UNIFORM_BUFFER, alignUniformSize(sizeof(FrameUniforms)) * 4)   // Room for a few updates per frame, e.g. one per render pass.
+{
+}
+
+void FrameUniformBuffer::update(const FrameUniforms& frameUniforms)
+{
+    StreamAllocation allocation = streamBuffer.allocate(sizeof(FrameUniforms), getUniformBufferAlignment());
+    if (allocation.data == nullptr)
+        return;
+
+    memcpy(allocation.data, &frameUniforms, sizeof(FrameUniforms));
+    streamBuffer.flush();
+    getGlStateCache().bindUniformBufferRange(frameUniformBinding, streamBuffer.ID, allocation.offset, allocation.size);
+}
+
+UniformBlockArena::UniformBlockArena(GLsizeiptr blockSize, int capacity)
+    : blockSize(blockSize), slotSize(alignUniformSize(blockSize)), capacity(capacity)
+{
+    glGenBuffers(1, &ID);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    glBufferData(GL_COPY_WRITE_BUFFER, slotSize * capacity, nullptr, GL_DYNAMIC_DRAW);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    freeSlots.reserve(capacity);
+    for (int slot = capacity - 1; slot >= 0; slot--)                                                                     // Reversed so that slots are handed out from the start of the buffer.
+        freeSlots.push_back(slot);
+}
+
+UniformBlockHandle UniformBlockArena::allocate(const void* data)
+{
+    if (freeSlots.empty()) {
+        std::cout << "::Error: uniform block arena with " << capacity << " slots is full" << std::endl;
+        return invalidUniformBlock;
+    }
+    UniformBlockHandle handle = freeSlots.back();
+    freeSlots.pop_back();
+    update(handle, data);
+    return handle;
+}
+
+void UniformBlockArena::update(UniformBlockHandle handle, const void* data)                                            // Rare (material edits), so a plain glBufferSubData is good enough.
+{
+    if (handle < 0 || handle >= capacity)
+        return;
+
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, handle * slotSize, blockSize, data);
+    getGlStateCache().bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void UniformBlockArena::release(UniformBlockHandle handle)
+{
+    if (handle >= 0 && handle < capacity)
+        freeSlots.push_back(handle);
+}
+
+void UniformBlockArena::bind(UniformBlockHandle handle, UniformBlockBinding binding)
+{
+    if (handle >= 0 && handle < capacity)
+        getGlStateCache().bindUniformBufferRange(binding, ID, handle * slotSize, blockSize);
+}
+
+void UniformBlockArena::deleteUniformBlockArena()
+{
+    getGlStateCache().onBufferDeleted(ID);
+    glDeleteBuffers(1, &ID);
+    ID = 0;
+    freeSlots.clear();
+}
@@ -0,0 +1,200 @@
+#include "image-decoder.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* Tests of the in-tree JPEG and PNG decoders (image-decoder.hpp) against the files in tests/data, whose directory is
+the only argument. Every image there has a .pam next to it (P7, RGB_ALPHA, top row first) with the pixels libjpeg and
+libpng decode from it: PNG must match exactly, JPEG within a few levels since IDCT and chroma upsampling rounding are
+not specified. Truncated and corrupted copies of every file must fail or decode to a complete image, never crash or
+read out of bounds. Registered with CTest, run with ctest in the build directory. */
+
+const int jpegMaxErrorBound = 4;                                                                                         // Per channel, libjpeg's islow IDCT and fancy upsampling against ours.
+const double jpegMeanErrorBound = 0.5;
+const int corruptCopyCount = 64;                                                                                         // Per file, with up to 8 random bytes replaced each.
+const int truncatedLengthCount = 16;                                                                                     // Per file, spread over the whole length.
+
+const char* pngNames[] = { "gray-1", "gray-4-transparent", "gray-16", "gray-alpha-8-interlaced", "rgb-8-transparent-interlaced",
+                           "rgb-16-interlaced", "rgb-8-fixed-huffman", "palette-2-interlaced", "palette-8-transparent", "rgba-16",
+                           "rgba-8-stored" };
+const char* jpegNames[] = { "baseline-444", "baseline-420", "baseline-422-restart", "grayscale", "progressive-420", "progressive-444-restart" };
+
+std::string dataDirectory;
+
+bool readFile(const std::string& path, std::string& result)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    result = stream.str();
+    return true;
+}
+
+bool readPam(const std::string& path, ImageLevel& result)                                                                // Only the header fields tests/data uses.
+{
+    std::string data;
+    if (!readFile(path, data))
+        return false;
+    size_t end = data.find("ENDHDR\n");
+    if (end == std::string::npos)
+        return false;
+    std::istringstream header(data.substr(0, end));
+    std::string key;
+    while (header >> key) {
+        if (key == "WIDTH")
+            header >> result.width;
+        else if (key == "HEIGHT")
+            header >> result.height;
+    }
+    size_t rowSize = (size_t)result.width * 4, offset = end + 7;
+    if (result.width <= 0 || result.height <= 0 || data.size() != offset + rowSize * result.height)
+        return false;
+    result.pixels.resize(rowSize * result.height);
+    for (int y = 0; y < result.height; y++)                                                                              // Flipped to the decoders' bottom row first.
+        memcpy(&result.pixels[(result.height - 1 - y) * rowSize], &data[offset + y * rowSize], rowSize);
+    return true;
+}
+
+bool testReference(const std::string& name, const char* extension, int maxErrorBound, double meanErrorBound)
+{
+    ImageLevel image, reference;
+    if (!decodeImageFile(dataDirectory + "/" + name + extension, image) || !readPam(dataDirectory + "/" + name + ".pam", reference)) {
+        printf("::Error: %s%s or its reference could not be read\n", name.c_str(), extension);
+        return false;
+    }
+    if (image.width != reference.width || image.height != reference.height || image.pixels.size() != reference.pixels.size()) {
+        printf("::Error: %s%s decodes to %dx%d, expected %dx%d\n", name.c_str(), extension, image.width, image.height, reference.width,
+               reference.height);
+        return false;
+    }
+    int maxError = 0;
+    double errorSum = 0.0;
+    for (size_t i = 0; i < image.pixels.size(); i++) {
+        int error = std::abs(image.pixels[i] - reference.pixels[i]);
+        maxError = std::max(maxError, error);
+        errorSum += error;
+    }
+    double meanError = errorSum / image.pixels.size();
+    printf("%-36s %dx%d, max error %d, mean error %.4f\n", (name + extension).c_str(), image.width, image.height, maxError, meanError);
+    if (maxError <= maxErrorBound && meanError <= meanErrorBound)
+        return true;
+    printf("::Error: %s%s exceeds its bound\n", name.c_str(), extension);
+    return false;
+}
+
+bool isConsistent(bool isDecoded, const ImageLevel& image)                                                               // A decoded image has every pixel.
+{
+    return !isDecoded || (image.width > 0 && image.height > 0 && image.pixels.size() == (size_t)image.width * image.height * 4);
+}
+
+bool testCorruptInput(const std::string& name, const char* extension, bool isTruncationFatal)
+{
+    std::string data;
+    if (!readFile(dataDirectory + "/" + name + extension, data)) {
+        printf("::Error: %s%s could not be read\n", name.c_str(), extension);
+        return false;
+    }
+    std::streambuf* output = std::cout.rdbuf(nullptr);                                                                   // The decoders report every failure, expected here.
+    int inconsistentCount = 0, truncatedDecodeCount = 0, rejectedCount = 0;
+    for (int i = 0; i < truncatedLengthCount; i++) {
+        size_t length = data.size() * i / truncatedLengthCount;
+        std::string truncated = data.substr(0, length);                                                                  // Its own allocation, so reads past the end are caught by sanitizers.
+        ImageLevel image;
+        bool isDecoded = decodeImage(truncated.data(), truncated.size(), image);
+        inconsistentCount += !isConsistent(isDecoded, image);
+        truncatedDecodeCount += isDecoded;
+    }
+    uint32_t random = 12345;
+    for (int i = 0; i < corruptCopyCount; i++) {
+        std::string corrupt = data;
+        int byteCount = 1 + i % 8;
+        for (int j = 0; j < byteCount; j++) {
+            random = random * 1664525u + 1013904223u;
+            corrupt[8 + (random >> 8) % (corrupt.size() - 8)] = (char)(random >> 24);                                    // Past the signature, so the format is still detected.
+        }
+        ImageLevel image;
+        bool isDecoded = decodeImage(corrupt.data(), corrupt.size(), image);
+        inconsistentCount += !isConsistent(isDecoded, image);
+        rejectedCount += !isDecoded;
+    }
+    std::cout.rdbuf(output);
+    printf("%-36s %d of %d corrupt copies rejected, %d of %d truncated copies decoded\n", (name + extension).c_str(), rejectedCount,
+           corruptCopyCount, truncatedDecodeCount, truncatedLengthCount);
+    if (inconsistentCount == 0 && (!isTruncationFatal || truncatedDecodeCount == 0))
+        return true;
+    printf("::Error: %s%s decoded %d incomplete images and %d truncated ones\n", name.c_str(), extension, inconsistentCount,
+           truncatedDecodeCount);
+    return false;
+}
+
+bool testInvalidInput()                                                                                                  // No data, no signature, and signatures with nothing after them.
+{
+    const char pngSignature[] = "\x89PNG\r\n\x1A\n";
+    const char jpegSignature[] = "\xFF\xD8\xFF";
+    const char garbage[] = "not an image at all, just some text";
+    std::streambuf* output = std::cout.rdbuf(nullptr);
+    ImageLevel image;
+    int acceptedCount = decodeImage(nullptr, 0, image) + decodeImage(garbage, sizeof(garbage) - 1, image) +
+                        decodeImage(pngSignature, sizeof(pngSignature) - 1, image) + decodeImage(jpegSignature, sizeof(jpegSignature) - 1, image) +
+                        decodeImageFile(dataDirectory + "/missing.png", image);
+    std::cout.rdbuf(output);
+    printf("%-36s %d accepted\n", "invalid input", acceptedCount);
+    if (acceptedCount == 0)
+        return true;
+    printf("::Error: invalid input was decoded\n");
+    return false;
+}
+
+bool testOversizedHeader()                                                                                               // Valid files whose headers claim the largest dimensions, rejected before allocating for them.
+{
+    std::string png, jpeg;
+    if (!readFile(dataDirectory + "/rgba-8-stored.png", png) || !readFile(dataDirectory + "/baseline-444.jpg", jpeg)) {
+        printf("::Error: oversized header sources could not be read\n");
+        return false;
+    }
+    const char pngDimensions[] = { 0, 1, 0, 0, 0, 1, 0, 0 };                                                             // 1 << 24 both ways, after the signature, IHDR length and type.
+    png.replace(16, sizeof(pngDimensions), pngDimensions, sizeof(pngDimensions));
+    size_t frame = jpeg.find("\xFF\xC0");
+    if (frame == std::string::npos) {
+        printf("::Error: baseline-444.jpg has no baseline frame header\n");
+        return false;
+    }
+    jpeg.replace(frame + 5, 4, "\xFF\xFF\xFF\xFF");                                                                      // 65535 both ways, after the marker, length and precision.
+    std::streambuf* output = std::cout.rdbuf(nullptr);
+    ImageLevel image;
+    int acceptedCount = decodeImage(png.data(), png.size(), image) + decodeImage(jpeg.data(), jpeg.size(), image);
+    std::cout.rdbuf(output);
+    printf("%-36s %d accepted\n", "oversized header", acceptedCount);
+    if (acceptedCount == 0)
+        return true;
+    printf("::Error: an oversized header was decoded\n");
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        printf("Usage: %s <tests/data directory>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    dataDirectory = argv[1];
+    bool isPassed = true;
+    for (const char* name : pngNames)
+        isPassed &= testReference(name, ".png", 0, 0.0);
+    for (const char* name : jpegNames)
+        isPassed &= testReference(name, ".jpg", jpegMaxErrorBound, jpegMeanErrorBound);
+    for (const char* name : pngNames)
+        isPassed &= testCorruptInput(name, ".png", true);                                                                // Without IEND or with short IDAT data.
+    for (const char* name : jpegNames)
+        isPassed &= testCorruptInput(name, ".jpg", false);                                                               // Missing scan data may decode as zeros, as in libjpeg.
+    isPassed &= testInvalidInput();
+    isPassed &= testOversizedHeader();
+    return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
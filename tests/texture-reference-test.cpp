@@ -0,0 +1,71 @@
+#include "multi-draw.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/* Tests of the TextureReference stream (renderer.hpp) as the TEXTURE_ARRAY and BINDLESS_TEXTURE variants of
+vertexShader.glsl and fragmentShader.glsl read it: bindless handles survive the split into the uvec2 that GLSL turns
+back into a sampler (low half in x), handle 0 stays 0 so the bound array is used, layers survive the RGBA32UI draw
+data texel as float bits, and InstanceData keeps its 80 bytes without it. No GL context, so the sampling itself is
+left to the texture-array bench scene on a driver with GL_ARB_bindless_texture. Registered with CTest, run with ctest
+in the build directory. */
+
+const GLuint64 bindlessHandles[] = { 0, 1, 0xFFFFFFFFull, 0x100000000ull, 0x0000000100000002ull, 0x123456789ABCDEF0ull, 0xFFFFFFFFFFFFFFFFull };
+const int maxTestedLayer = 2048;                                                                                         // The largest GL_MAX_ARRAY_TEXTURE_LAYERS of common drivers.
+
+bool checkCount(const char* name, int mismatchCount)
+{
+    printf("%-28s %d mismatches\n", name, mismatchCount);
+    if (mismatchCount == 0)
+        return true;
+    printf("::Error: %s has mismatches\n", name);
+    return false;
+}
+
+GLuint64 getShaderHandle(const TextureReference& reference)                                                              // What sampler2DArray(uvec2) receives: x is the low half, y the high half.
+{
+    GLuint texel[4];
+    memcpy(texel, &reference, sizeof(texel));                                                                            // The RGBA32UI draw data texel and the attribute at instanceTextureAttributeLocation alike.
+    return (GLuint64)texel[0] | ((GLuint64)texel[1] << 32);
+}
+
+bool testLayout()                                                                                                        // Offsets the attribute pointers and the shaders assume.
+{
+    int mismatchCount = (sizeof(InstanceData) != 80) + (drawDataTexelCount != 5) + (sizeof(TextureReference) != 4 * sizeof(GLuint))
+                        + (offsetof(TextureReference, handle) != 0) + (offsetof(TextureReference, layer) != 2 * sizeof(GLuint));
+    return checkCount("stream layout", mismatchCount);
+}
+
+bool testBindlessHandles()
+{
+    int mismatchCount = 0;
+    for (GLuint64 handle : bindlessHandles) {
+        TextureReference reference = getTextureReference(handle, 3);
+        mismatchCount += getShaderHandle(reference) != handle;
+        mismatchCount += (handle == 0) != (reference.handle[0] == 0 && reference.handle[1] == 0);                        // The fragment shader falls back to albedoArray on a zero handle only.
+    }
+    return checkCount("bindless handle round trip", mismatchCount);
+}
+
+bool testLayers()
+{
+    int mismatchCount = 0;
+    for (int layer = 0; layer <= maxTestedLayer; layer++) {
+        TextureReference reference = getTextureReference(0x123456789ABCDEF0ull, layer);
+        GLuint texel[4];
+        memcpy(texel, &reference, sizeof(texel));
+        GLfloat decodedLayer;
+        memcpy(&decodedLayer, &texel[2], sizeof(decodedLayer));                                                          // uintBitsToFloat in the DRAW_DATA variant.
+        mismatchCount += decodedLayer != (GLfloat)layer || getShaderHandle(reference) != 0x123456789ABCDEF0ull;
+    }
+    return checkCount("layer round trip", mismatchCount);
+}
+
+int main()
+{
+    bool isPassed = testLayout();
+    isPassed &= testBindlessHandles();
+    isPassed &= testLayers();
+    return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
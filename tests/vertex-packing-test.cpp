@@ -0,0 +1,94 @@
+#include "geometry/vertex-packing.hpp"
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+
+/* Precision tests of geometry/vertex-packing.hpp against the bounds its header states: half floats round trip exactly
+and keep 11 significant bits, unorm16 positions are within half a step (extent / 131070) of the source, octahedral
+normals in 10 bits are within 0.25 degrees. Registered with CTest, run with ctest in the build directory. */
+
+const GLfloat halfRelativeErrorBound = 1.0f / 2048.0f;                                                                   // Half a unit in the last place of an 11-bit significand.
+const GLfloat normalAngleErrorBoundDegrees = 0.25f;
+const int normalSampleCount = 200000;
+const int positionSampleCount = 100000;
+const double pi = 3.14159265358979323846;                                                                               // M_PI is not standard C++.
+
+bool checkBound(const char* name, double error, double bound)
+{
+    printf("%-28s max error %.8g, bound %.8g\n", name, error, bound);
+    if (error <= bound)
+        return true;
+    printf("::Error: %s exceeds its bound\n", name);
+    return false;
+}
+
+bool testHalfRoundTrip()                                                                                                 // Every half survives half -> float -> half, NaNs stay NaN.
+{
+    int mismatchCount = 0;
+    for (uint32_t bits = 0; bits <= 0xFFFF; bits++) {
+        GLhalf half = (GLhalf)bits;
+        GLfloat value = halfToFloat(half);
+        bool isNan = (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+        if (isNan ? !std::isnan(value) || !std::isnan(halfToFloat(floatToHalf(value))) : floatToHalf(value) != half)
+            mismatchCount++;
+    }
+    return checkBound("half round trip mismatches", mismatchCount, 0);
+}
+
+bool testHalfPrecision()                                                                                                 // Floats in the normal half range, relative to the value.
+{
+    double maxError = 0.0;
+    for (GLfloat value = 1.0f / 16384.0f; value <= 65504.0f; value *= 1.0001f) {
+        GLfloat rounded = halfToFloat(floatToHalf(value));
+        maxError = std::max(maxError, std::fabs((double)rounded - value) / value);
+    }
+    return checkBound("half relative error", maxError, halfRelativeErrorBound);
+}
+
+bool testPositionPrecision()                                                                                             // Relative to the extent of the bounds, on every axis.
+{
+    MeshBounds bounds = { Position(-37.5f, 2.0f, -0.25f), Position(112.0f, 2.5f, 1000.0f) };
+    Position extent = bounds.getExtent();
+    double maxError = 0.0;
+    srand(1);
+    for (int i = 0; i < positionSampleCount; i++) {
+        GLfloat t[3];
+        for (GLfloat& value : t)
+            value = rand() / (GLfloat)RAND_MAX;
+        Vertex vertex(Position(bounds.min.x + t[0] * extent.x, bounds.min.y + t[1] * extent.y, bounds.min.z + t[2] * extent.z), Color::white(), UV(),
+                      Position(0.0f, 0.0f, 1.0f));
+        Vertex unpacked = unpackVertex(packVertex(vertex, bounds), bounds);
+        maxError = std::max({ maxError, std::fabs((double)unpacked.position.x - vertex.position.x) / extent.x,
+                              std::fabs((double)unpacked.position.y - vertex.position.y) / extent.y,
+                              std::fabs((double)unpacked.position.z - vertex.position.z) / extent.z });
+    }
+    return checkBound("unorm16 position error", maxError, 1.0 / 131070.0 + 8.0 * FLT_EPSILON);                         // Half a step, plus float rounding in the decode.
+}
+
+bool testNormalPrecision()                                                                                               // Angle between a normal and its decoded packed form, over a Fibonacci sphere and the axes.
+{
+    std::vector<Position> normals = { Position(1.0f, 0.0f, 0.0f), Position(-1.0f, 0.0f, 0.0f), Position(0.0f, 1.0f, 0.0f),
+                                      Position(0.0f, -1.0f, 0.0f), Position(0.0f, 0.0f, 1.0f), Position(0.0f, 0.0f, -1.0f) };
+    const double goldenAngle = pi * (3.0 - std::sqrt(5.0));
+    for (int i = 0; i < normalSampleCount; i++) {
+        double z = 1.0 - 2.0 * (i + 0.5) / normalSampleCount, radius = std::sqrt(1.0 - z * z);
+        normals.push_back(Position(radius * std::cos(goldenAngle * i), radius * std::sin(goldenAngle * i), z));
+    }
+    double maxAngle = 0.0;
+    for (const Position& normal : normals) {
+        Vertex vertex(Position(), Color::white(), UV(), normal);
+        Position decoded = unpackVertex(packVertexHalf(vertex)).normals;
+        double cosine = std::clamp((double)normal.x * decoded.x + (double)normal.y * decoded.y + (double)normal.z * decoded.z, -1.0, 1.0);
+        maxAngle = std::max(maxAngle, std::acos(cosine) * 180.0 / pi);
+    }
+    return checkBound("octahedral normal degrees", maxAngle, normalAngleErrorBoundDegrees);
+}
+
+int main()
+{
+    bool isPassed = testHalfRoundTrip();
+    isPassed &= testHalfPrecision();
+    isPassed &= testPositionPrecision();
+    isPassed &= testNormalPrecision();
+    return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
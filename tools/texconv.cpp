@@ -0,0 +1,92 @@
+#include "block-compression.hpp"
+#include "image-decoder.hpp"
+#include "ktx2-file.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+/* Offline texture converter. Decodes a JPEG or PNG, builds its mip chain in linear space and writes it block-compressed
+into a KTX2 file, which TextureManager streams and loadKtx2Texture uploads without decoding anything at run time.
+Prints the size against RGBA8 and the PSNR of level 0 after a round trip through the encoder.
+Usage: ENginger_texconv input.jpg|input.png output.ktx2 [--format bc1|bc3|bc5|bc7|rgba8]
+bc1 for opaque color, bc3 for color with alpha, bc5 for two-channel data (normal map XY), bc7 (default) for the best
+quality at twice the size of bc1. */
+
+struct ConvertOptions
+{
+    std::string inputPath;
+    std::string outputPath;
+    BlockFormat format = blockFormatBC7;
+};
+
+bool parseOptions(int argc, char* argv[], ConvertOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc) {
+            if (!findBlockFormat(argv[++i], options.format)) {
+                std::cout << "::Error: unknown format " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (options.inputPath.empty())
+            options.inputPath = argument;
+        else if (options.outputPath.empty())
+            options.outputPath = argument;
+        else {
+            std::cout << "::Error: unknown or incomplete argument " << argument << std::endl;
+            return false;
+        }
+    }
+    if (options.outputPath.empty()) {
+        std::cout << "Usage: ENginger_texconv input.jpg|input.png output.ktx2 [--format bc1|bc3|bc5|bc7|rgba8]" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double getPsnr(const ImageLevel& source, const ImageLevel& decoded, BlockFormat format)                                  // Over the channels the format stores.
+{
+    int channelCount = format == blockFormatBC5 ? 2 : format == blockFormatBC1 ? 3 : 4;
+    double squaredError = 0.0;
+    for (size_t pixel = 0; pixel < source.pixels.size() / 4; pixel++)
+        for (int channel = 0; channel < channelCount; channel++) {
+            double difference = (double)source.pixels[pixel * 4 + channel] - decoded.pixels[pixel * 4 + channel];
+            squaredError += difference * difference;
+        }
+    double meanSquaredError = squaredError / (source.pixels.size() / 4 * channelCount);
+    return meanSquaredError == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+int main(int argc, char* argv[])
+{
+    ConvertOptions options;
+    if (!parseOptions(argc, argv, options))
+        return EXIT_FAILURE;
+    ImageLevel image;
+    if (!decodeImageFile(options.inputPath, image))
+        return EXIT_FAILURE;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ImageLevel> levels = generateMipChain(std::move(image));
+    size_t sourceSize = 0, compressedSize = 0;
+    double psnr = 0.0;
+    for (int level = 0; level < (int)levels.size(); level++) {
+        std::vector<unsigned char> blocks = compressImage(levels[level], options.format);
+        ImageLevel decoded;
+        if (level == 0 && decompressImage(options.format, blocks.data(), blocks.size(), levels[0].width, levels[0].height, decoded))
+            psnr = getPsnr(levels[0], decoded, options.format);
+        sourceSize += levels[level].pixels.size();
+        compressedSize += blocks.size();
+        levels[level].pixels.swap(blocks);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!writeKtx2File(options.outputPath, options.format, levels))
+        return EXIT_FAILURE;
+
+    printf("%s: %dx%d, %d levels, %s, %zu KB (%zu KB as rgba8), PSNR %.2f dB, %.2f s\n", options.outputPath.c_str(), levels[0].width,
+           levels[0].height, (int)levels.size(), getBlockFormatInfo(options.format).name, compressedSize >> 10, sourceSize >> 10, psnr, seconds);
+    return EXIT_SUCCESS;
+}